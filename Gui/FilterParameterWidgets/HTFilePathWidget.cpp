@@ -76,6 +76,7 @@ void HTFilePathWidget::setupGui()
   connect(getFilter(), SIGNAL(preflightExecuted()), this, SLOT(afterPreflight()));
 
   m_FileModel = new HTFileInfoModel(this);
+  connect(m_FileModel, &HTFileInfoModel::folderFetched, this, &HTFilePathWidget::onFolderFetched);
   m_Ui->fileInfoTreeView->setModel(m_FileModel);
 
   // Update Widget from FP
@@ -183,24 +184,21 @@ void HTFilePathWidget::filterNeedsInputParameters(AbstractFilter* filter)
 // -----------------------------------------------------------------------------
 void HTFilePathWidget::syncFileModel()
 {
-  // Asynchronously request file information from HyperThought
-  m_InfoRequest = new HTFileInfoRequest(getHyperThoughtConnection(), getSourcePath(), true);
-  connect(m_InfoRequest, &HTFileInfoRequest::infoReceived, this, &HTFilePathWidget::onFileInfoReceived);
-
-  m_InfoRequest->exec();
+  m_FileModel->setSource(getHyperThoughtConnection(), getSourcePath());
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void HTFilePathWidget::onFileInfoReceived(const HTFileInfoTree& fileInfoTree)
+void HTFilePathWidget::onFolderFetched(const QModelIndex& folder)
 {
-  m_FileModel->setFileInfoTree(fileInfoTree);
   updateItemSelection();
-  emit parametersChanged();
 
-  delete m_InfoRequest;
-  m_InfoRequest = nullptr;
+  // Preflight again once the source folder has been listed
+  if(!folder.isValid())
+  {
+    emit parametersChanged();
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -293,12 +291,12 @@ void HTFilePathWidget::onSelectionChanged(const QItemSelection& current, const Q
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileInfoTree HTFilePathWidget::getRequestedInfoTree() const
+HTFileInfoTree::ConstPointer HTFilePathWidget::getRequestedInfoTree() const
 {
   HTConnection* htConnection = getHyperThoughtConnection();
   if(nullptr == htConnection)
   {
-    return {};
+    return nullptr;
   }
 
   HTFilePath filePath = getFilePath();
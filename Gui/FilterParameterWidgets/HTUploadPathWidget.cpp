@@ -76,6 +76,7 @@ void HTUploadPathWidget::setupGui()
   connect(getFilter(), SIGNAL(preflightExecuted()), this, SLOT(afterPreflight()));
 
   m_FileModel = new HTFileInfoModel(this);
+  connect(m_FileModel, &HTFileInfoModel::folderFetched, this, &HTUploadPathWidget::onFolderFetched);
   m_FileModel->setMode(HTFileInfoModel::Mode::Directory);
   m_Ui->fileInfoTreeView->setModel(m_FileModel);
 
@@ -189,24 +190,21 @@ void HTUploadPathWidget::filterNeedsInputParameters(AbstractFilter* filter)
 // -----------------------------------------------------------------------------
 void HTUploadPathWidget::syncFileModel()
 {
-  // Asynchronously request file information from HyperThought
-  m_InfoRequest = new HTFileInfoRequest(getHyperThoughtConnection(), getSourcePath(), true);
-  connect(m_InfoRequest, &HTFileInfoRequest::infoReceived, this, &HTUploadPathWidget::onFileInfoReceived);
-
-  m_InfoRequest->exec();
+  m_FileModel->setSource(getHyperThoughtConnection(), getSourcePath());
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void HTUploadPathWidget::onFileInfoReceived(const HTFileInfoTree& fileInfoTree)
+void HTUploadPathWidget::onFolderFetched(const QModelIndex& folder)
 {
-  m_FileModel->setFileInfoTree(fileInfoTree);
   updateItemSelection();
-  emit parametersChanged();
 
-  delete m_InfoRequest;
-  m_InfoRequest = nullptr;
+  // Preflight again once the source folder has been listed
+  if(!folder.isValid())
+  {
+    emit parametersChanged();
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -303,12 +301,12 @@ void HTUploadPathWidget::onSelectionChanged(const QItemSelection& current, const
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileInfoTree HTUploadPathWidget::getRequestedInfoTree() const
+HTFileInfoTree::ConstPointer HTUploadPathWidget::getRequestedInfoTree() const
 {
   HTConnection* htConnection = getHyperThoughtConnection();
   if(nullptr == htConnection)
   {
-    return {};
+    return nullptr;
   }
 
   HTFilePath filePath = getFilePath();
@@ -127,17 +127,17 @@ private:
   void updateFP();
 
   /**
-   * @brief Begins an asynchronous request for HyperThought file info.
-   * Updates the file info model when complete.
+   * @brief Lists the current source on demand in the file info model.
+   * Only the top-level folder is requested up front. Other folders are requested as they are expanded.
    */
   void syncFileModel();
 
   /**
-   * @brief Called when the file info request is completed.
-   * Updates the HyperThought file info cache for the current source with the returned values.
-   * @param fileInfoTree
+   * @brief Called when a folder listing has been inserted into the file info model.
+   * Selects the current path once the folders leading to it have been listed.
+   * @param folder
    */
-  void onFileInfoReceived(const HTFileInfoTree& fileInfoTree);
+  void onFolderFetched(const QModelIndex& folder);
 
   /**
    * @brief Updates the file info model from the HyperThought file info cache.
@@ -175,7 +175,7 @@ private:
    * @brief Returns the corresponding HyperThought file info tree for the current source.
    * @return
    */
-  HTFileInfoTree getRequestedInfoTree() const;
+  HTFileInfoTree::ConstPointer getRequestedInfoTree() const;
 
   /**
    * @brief Returns the selected HyperThought file info.
@@ -193,5 +193,4 @@ private:
   // Variables
   QSharedPointer<Ui::HTUploadPathWidget> m_Ui;
   HTFileInfoModel* m_FileModel;
-  HTFileInfoRequest* m_InfoRequest = nullptr;
 };
@@ -0,0 +1,101 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "HTBufferedReply.h"
+
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+HTBufferedReply::HTBufferedReply(const QNetworkReply* source, const QByteArray& body, QObject* parent)
+: QNetworkReply(parent)
+, m_Body(body)
+{
+  setRequest(source->request());
+  setUrl(source->url());
+  setOperation(source->operation());
+  setError(source->error(), source->errorString());
+
+  for(int code = QNetworkRequest::HttpStatusCodeAttribute; code < QNetworkRequest::User; code++)
+  {
+    QNetworkRequest::Attribute attribute = static_cast<QNetworkRequest::Attribute>(code);
+    QVariant value = source->attribute(attribute);
+    if(value.isValid())
+    {
+      setAttribute(attribute, value);
+    }
+  }
+
+  // Raw headers also set the known headers they correspond to
+  for(const RawHeaderPair& header : source->rawHeaderPairs())
+  {
+    setRawHeader(header.first, header.second);
+  }
+
+  open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+  setFinished(true);
+}
+
+// -----------------------------------------------------------------------------
+HTBufferedReply::~HTBufferedReply() = default;
+
+// -----------------------------------------------------------------------------
+void HTBufferedReply::abort()
+{
+}
+
+// -----------------------------------------------------------------------------
+qint64 HTBufferedReply::bytesAvailable() const
+{
+  return (m_Body.size() - m_Offset) + QNetworkReply::bytesAvailable();
+}
+
+// -----------------------------------------------------------------------------
+bool HTBufferedReply::isSequential() const
+{
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+qint64 HTBufferedReply::readData(char* data, qint64 maxSize)
+{
+  qint64 remaining = m_Body.size() - m_Offset;
+  if(remaining <= 0)
+  {
+    return -1;
+  }
+
+  qint64 count = (maxSize < remaining) ? maxSize : remaining;
+  std::memcpy(data, m_Body.constData() + m_Offset, static_cast<size_t>(count));
+  m_Offset += count;
+  return count;
+}
@@ -0,0 +1,93 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <QtNetwork/QNetworkReply>
+
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
+
+/**
+ * @class HTBufferedReply HTBufferedReply.h HyperThoughtUtilities/HyperThoughtConnection/HTBufferedReply.h
+ * @brief The HTBufferedReply class is a finished QNetworkReply that replays a copy of another reply.
+ * It has the source reply's request, error, attributes and headers, and returns the given body from read().
+ * HTRequestScheduler uses it to hand one response to every request that shared the network call.
+ */
+class HyperThoughtUtilities_EXPORT HTBufferedReply : public QNetworkReply
+{
+  Q_OBJECT
+
+public:
+  /**
+   * @brief Constructor
+   * @param source Finished reply to copy
+   * @param body Response body read from the source reply
+   * @param parent
+   */
+  HTBufferedReply(const QNetworkReply* source, const QByteArray& body, QObject* parent = nullptr);
+
+  /**
+   * @brief Destructor
+   */
+  ~HTBufferedReply() override;
+
+  /**
+   * @brief Does nothing. The reply has already finished.
+   */
+  void abort() override;
+
+  /**
+   * @brief Returns the number of body bytes that have not been read yet.
+   * @return
+   */
+  qint64 bytesAvailable() const override;
+
+  /**
+   * @brief Returns true. The body can only be read once.
+   * @return
+   */
+  bool isSequential() const override;
+
+protected:
+  /**
+   * @brief Copies up to maxSize bytes of the remaining body into data.
+   * @param data
+   * @param maxSize
+   * @return
+   */
+  qint64 readData(char* data, qint64 maxSize) override;
+
+private:
+  QByteArray m_Body;
+  qint64 m_Offset = 0;
+};
@@ -35,13 +35,20 @@
 
 #include <cstdlib>
 #include <ctime>
+#include <iterator>
+#include <map>
 
 #include <QNetworkAccessManager>
 #include <QNetworkCookie>
+#include <QtCore/QAbstractEventDispatcher>
 #include <QtCore/QByteArray>
-#include <QtCore/QEventLoop>
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QFile>
 #include <QtCore/QJsonDocument>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
 #include <QtCore/QUrl>
 #include <QtCore/QUrlQuery>
 
@@ -49,14 +56,20 @@
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesFilters/OpenHyperThoughtConnection.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesFilters/util/HTUtils.h"
 
-// -----------------------------------------------------------------------------
-inline void waitForResponse(QNetworkReply* reply)
+namespace
+{
+QMutex& sessionTicketMutex()
+{
+  static QMutex mutex;
+  return mutex;
+}
+
+std::map<QString, QByteArray>& sessionTickets()
 {
-  QEventLoop loop;
-  QObject::connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), &loop, &QEventLoop::quit);
-  QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-  loop.exec();
+  static std::map<QString, QByteArray> tickets;
+  return tickets;
 }
+} // namespace
 
 // -----------------------------------------------------------------------------
 HTConnection* HTConnection::GetExistingConnection(const AbstractFilter* filter)
@@ -84,11 +97,52 @@ HTConnection* HTConnection::GetExistingConnection(const AbstractFilter* filter)
   return nullptr;
 }
 
+// -----------------------------------------------------------------------------
+std::shared_ptr<HTConnection> HTConnection::GetConnection(const QString& apiAccess)
+{
+  static QMutex registryMutex;
+  static std::map<QString, std::weak_ptr<HTConnection>> registry;
+
+  QMutexLocker locker(&registryMutex);
+
+  // Drop the entries of connections that have been released
+  for(auto iter = registry.begin(); iter != registry.end();)
+  {
+    iter = iter->second.expired() ? registry.erase(iter) : std::next(iter);
+  }
+
+  std::shared_ptr<HTConnection> connection = registry[apiAccess].lock();
+  if(nullptr == connection)
+  {
+    connection = std::shared_ptr<HTConnection>(new HTConnection(apiAccess), &HTConnection::ReleaseConnection);
+    registry[apiAccess] = connection;
+  }
+  return connection;
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::ReleaseConnection(HTConnection* connection)
+{
+  // deleteLater() only runs once the owning thread's event loop gets to it, which may never happen
+  QThread* owner = connection->thread();
+  if(owner == QThread::currentThread() || owner->isFinished() || nullptr == QAbstractEventDispatcher::instance(owner))
+  {
+    delete connection;
+    return;
+  }
+
+  connection->flushState();
+  connection->deleteLater();
+}
+
 // -----------------------------------------------------------------------------
 HTConnection::HTConnection()
 : QObject(nullptr)
 , m_NetworkManager(nullptr)
+, m_Scheduler(new HTRequestScheduler())
+, m_Http2Enabled(false)
 {
+  startNetworkThread();
 }
 
 #if 0
@@ -122,10 +176,14 @@ HTConnection::HTConnection(const QString& encodedAccessToken, QObject* parent)
 , m_Status(Status::Disconnected)
 , m_NetworkManager(new QNetworkAccessManager())
 , m_CookieJar(new QNetworkCookieJar())
+, m_Scheduler(new HTRequestScheduler())
+, m_Http2Enabled(false)
 {
   setupNetworkManager();
   decodeApiAccess(encodedAccessToken);
   createDoDCookie();
+  setHttp2Enabled(true);
+  startNetworkThread();
 
   // Test Code
   // requestProjectFileInfo(",", "c1aab5fc-0fd0-4604-a347-ca136e1d58a1");
@@ -139,21 +197,175 @@ HTConnection::HTConnection(const HTConnection& rhs)
 , m_AuthorizationInfo(rhs.m_AuthorizationInfo)
 , m_NetworkManager(new QNetworkAccessManager())
 , m_CookieJar(new QNetworkCookieJar())
+, m_Scheduler(new HTRequestScheduler())
+, m_Http2Enabled(false)
 {
   setupNetworkManager();
   createDoDCookie();
+  m_FileInfoCache.setCacheDirectory(createCacheDirectoryPath());
+  setHttp2Enabled(rhs.isHttp2Enabled());
+  startNetworkThread();
 }
 
 // -----------------------------------------------------------------------------
-HTConnection::~HTConnection() = default;
+HTConnection::~HTConnection()
+{
+  flushState();
+
+  // The network manager and scheduler are deleted once the thread's event loop exits
+  m_NetworkThread->quit();
+  m_NetworkThread->wait();
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::flushState()
+{
+  m_FileInfoCache.flush();
+
+  QString metricsFile = qEnvironmentVariable("HT_METRICS_FILE");
+  if(!metricsFile.isEmpty())
+  {
+    writeMetrics(metricsFile);
+  }
+}
 
 // -----------------------------------------------------------------------------
 void HTConnection::setupNetworkManager()
 {
   m_NetworkManager->setCookieJar(m_CookieJar);
-  m_NetworkManager->setParent(this);
 
-  connect(m_NetworkManager, &QNetworkAccessManager::sslErrors, this, &HTConnection::onSslErrors);
+  // SSL errors must be ignored before the signal returns, so handle them on the network thread
+  connect(m_NetworkManager, &QNetworkAccessManager::sslErrors, this, &HTConnection::onSslErrors, Qt::DirectConnection);
+  connect(m_NetworkManager, &QNetworkAccessManager::encrypted, this, &HTConnection::onEncrypted, Qt::DirectConnection);
+  connect(m_NetworkManager, &QNetworkAccessManager::finished, this, &HTConnection::onReplyFinished, Qt::DirectConnection);
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::startNetworkThread()
+{
+  m_NetworkThread = new QThread(this);
+  m_NetworkThread->setObjectName("HTConnection Network");
+
+  m_Scheduler->moveToThread(m_NetworkThread);
+  connect(m_NetworkThread, &QThread::finished, m_Scheduler, &QObject::deleteLater);
+  if(nullptr != m_NetworkManager)
+  {
+    m_NetworkManager->moveToThread(m_NetworkThread);
+    connect(m_NetworkThread, &QThread::finished, m_NetworkManager, &QObject::deleteLater);
+  }
+
+  m_NetworkThread->start();
+
+  if(Status::Connected == m_Status)
+  {
+    warmUp();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::warmUp()
+{
+  QUrl baseUrl(getBaseUrl());
+  if(nullptr == m_NetworkManager || baseUrl.host().isEmpty())
+  {
+    return;
+  }
+
+  QNetworkAccessManager* networkManager = m_NetworkManager;
+  QString host = baseUrl.host();
+  if(baseUrl.scheme() == "https")
+  {
+    // Use the same configuration as real requests so that the pooled connection matches them
+    QSslConfiguration conf = createDefaultNetworkRequest().sslConfiguration();
+    if(isHttp2Enabled())
+    {
+      // The pooled connection only speaks HTTP/2 if it was offered during the handshake
+      conf.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+    }
+    quint16 port = static_cast<quint16>(baseUrl.port(443));
+    QMetaObject::invokeMethod(networkManager, [networkManager, host, port, conf]() { networkManager->connectToHostEncrypted(host, port, conf); }, Qt::QueuedConnection);
+  }
+  else
+  {
+    quint16 port = static_cast<quint16>(baseUrl.port(80));
+    QMetaObject::invokeMethod(networkManager, [networkManager, host, port]() { networkManager->connectToHost(host, port); }, Qt::QueuedConnection);
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool HTConnection::isHttp2Enabled() const
+{
+  return m_Http2Enabled;
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::setHttp2Enabled(bool enabled)
+{
+  m_Http2Enabled = enabled;
+  m_Scheduler->setMaxActive(HTRequestScheduler::Lane::MetaData, enabled ? k_Http2MetaDataLimit : HTRequestScheduler::k_DefaultMetaDataLimit);
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::onReplyFinished(QNetworkReply* reply)
+{
+  // Upload URLs may point at other hosts with their own protocol support
+  if(!isHttp2Enabled() || reply->url().host() != QUrl(getBaseUrl()).host())
+  {
+    return;
+  }
+
+  bool http2Used = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+  bool http2Failed = http2Used && (reply->error() == QNetworkReply::ProtocolFailure || reply->error() == QNetworkReply::ProtocolUnknownError);
+
+  // Without HTTP/2 in the ALPN negotiation the reply silently used HTTP/1.1
+  bool http2Refused = !http2Used && reply->error() == QNetworkReply::NoError && reply->request().attribute(QNetworkRequest::Http2AllowedAttribute).toBool();
+  if(http2Failed || http2Refused)
+  {
+    setHttp2Enabled(false);
+    emit http2Disabled(reply->url().host());
+  }
+}
+
+// -----------------------------------------------------------------------------
+QNetworkRequest HTConnection::applyHttpVersion(const QNetworkRequest& request) const
+{
+  QNetworkRequest versionedRequest(request);
+  if(!isHttp2Enabled())
+  {
+    versionedRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+  }
+  return versionedRequest;
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::onEncrypted(QNetworkReply* reply)
+{
+  QByteArray ticket = reply->sslConfiguration().sessionTicket();
+  if(!ticket.isEmpty())
+  {
+    SetSessionTicket(SessionKey(reply->url()), ticket);
+  }
+}
+
+// -----------------------------------------------------------------------------
+QString HTConnection::SessionKey(const QUrl& url)
+{
+  return QString("%1:%2").arg(url.host()).arg(url.port(443));
+}
+
+// -----------------------------------------------------------------------------
+QByteArray HTConnection::SessionTicket(const QString& key)
+{
+  QMutexLocker locker(&sessionTicketMutex());
+  auto iter = sessionTickets().find(key);
+  return (iter != sessionTickets().end()) ? iter->second : QByteArray();
+}
+
+// -----------------------------------------------------------------------------
+void HTConnection::SetSessionTicket(const QString& key, const QByteArray& ticket)
+{
+  QMutexLocker locker(&sessionTicketMutex());
+  sessionTickets()[key] = ticket;
 }
 
 // -----------------------------------------------------------------------------
@@ -202,9 +414,31 @@ void HTConnection::decodeApiAccess(const QString& apiAccess)
   m_RequiredInfo.nonce = HTUtils::generateNonce();
   m_RequiredInfo.responseType = "code";
 
+  m_FileInfoCache.setCacheDirectory(createCacheDirectoryPath());
+
   setStatus(Status::Connected);
 }
 
+// -----------------------------------------------------------------------------
+QString HTConnection::createCacheDirectoryPath() const
+{
+  if(m_RequiredInfo.baseUrl.isEmpty() || m_RequiredInfo.clientId.isEmpty())
+  {
+    return QString();
+  }
+
+  QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if(cacheLocation.isEmpty())
+  {
+    return QString();
+  }
+
+  // Each server and user gets its own directory without storing the client ID in plain text
+  QByteArray key = QString("%1\n%2").arg(m_RequiredInfo.baseUrl, m_RequiredInfo.clientId).toUtf8();
+  QString dirName = QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+  return QDir(cacheLocation).filePath(QString("HyperThought/%1").arg(dirName));
+}
+
 // -----------------------------------------------------------------------------
 bool HTConnection::isValid() const
 {
@@ -318,9 +552,6 @@ void HTConnection::refreshAccessToken()
   QNetworkReply* reply = m_NetworkManager->post(request, json);
   connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &HTConnection::onAccessTokenErr);
   connect(reply, &QNetworkReply::finished, this, &HTConnection::onAccessTokenResponse);
-
-  // Required for running during execute.
-  waitForResponse(reply);
 }
 #endif
 
@@ -388,43 +619,43 @@ void HTConnection::onAccessTokenResponse()
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::get(const QNetworkRequest& request)
 {
-  return m_NetworkManager->get(request);
+  return m_NetworkManager->get(applyHttpVersion(request));
 }
 
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::post(const QNetworkRequest& request, QIODevice* data)
 {
-  return m_NetworkManager->post(request, data);
+  return m_NetworkManager->post(applyHttpVersion(request), data);
 }
 
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::post(const QNetworkRequest& request, const QByteArray& data)
 {
-  return m_NetworkManager->post(request, data);
+  return m_NetworkManager->post(applyHttpVersion(request), data);
 }
 
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::put(const QNetworkRequest& request, QIODevice* data)
 {
-  return m_NetworkManager->put(request, data);
+  return m_NetworkManager->put(applyHttpVersion(request), data);
 }
 
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::put(const QNetworkRequest& request, const QByteArray& data)
 {
-  return m_NetworkManager->put(request, data);
+  return m_NetworkManager->put(applyHttpVersion(request), data);
 }
 
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::patch(const QNetworkRequest& request, QIODevice* data)
 {
-  return m_NetworkManager->sendCustomRequest(request, "PATCH", data);
+  return m_NetworkManager->sendCustomRequest(applyHttpVersion(request), "PATCH", data);
 }
 
 // -----------------------------------------------------------------------------
 QNetworkReply* HTConnection::patch(const QNetworkRequest& request, const QByteArray& data)
 {
-  return m_NetworkManager->sendCustomRequest(request, "PATCH", data);
+  return m_NetworkManager->sendCustomRequest(applyHttpVersion(request), "PATCH", data);
 }
 
 // -----------------------------------------------------------------------------
@@ -441,8 +672,19 @@ QNetworkRequest HTConnection::createDefaultNetworkRequest() const
   // Certificate Authority public key.
   QSslConfiguration conf = request.sslConfiguration();
   conf.setPeerVerifyMode(QSslSocket::VerifyNone);
+
+  // Resume the TLS session of an earlier connection to the same host when possible
+  conf.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+  QByteArray sessionTicket = SessionTicket(SessionKey(QUrl(getBaseUrl())));
+  if(!sessionTicket.isEmpty())
+  {
+    conf.setSessionTicket(sessionTicket);
+  }
   request.setSslConfiguration(conf);
 
+  // Many small listing and metadata requests share one multiplexed connection over HTTP/2
+  request.setAttribute(QNetworkRequest::Http2AllowedAttribute, isHttp2Enabled());
+
   return request;
 }
 
@@ -471,15 +713,60 @@ void HTConnection::setStatus(Status status)
   {
     m_Status = status;
     emit statusChanged(status);
+
+    // The network thread warms up its own connection once it has started
+    if(Status::Connected == status && nullptr != m_NetworkThread)
+    {
+      warmUp();
+    }
   }
 }
 
+// -----------------------------------------------------------------------------
+QThread* HTConnection::getNetworkThread() const
+{
+  return m_NetworkThread;
+}
+
 // -----------------------------------------------------------------------------
 QNetworkAccessManager* HTConnection::getNetworkManager() const
 {
   return m_NetworkManager;
 }
 
+// -----------------------------------------------------------------------------
+HTRequestScheduler* HTConnection::getScheduler() const
+{
+  return m_Scheduler;
+}
+
+// -----------------------------------------------------------------------------
+const HTMetrics& HTConnection::getMetrics() const
+{
+  return m_Scheduler->getMetrics();
+}
+
+// -----------------------------------------------------------------------------
+bool HTConnection::writeMetrics(const QString& filePath) const
+{
+  QFile file(filePath);
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    qDebug() << "Could not write HyperThought metrics to" << filePath;
+    return false;
+  }
+
+  if(filePath.endsWith(".json", Qt::CaseInsensitive))
+  {
+    file.write(QJsonDocument(getMetrics().toJson()).toJson());
+  }
+  else
+  {
+    file.write(getMetrics().toText().toUtf8());
+  }
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 void HTConnection::onSslErrors(QNetworkReply* reply, const QList<QSslError>& errs)
 {
@@ -514,13 +801,16 @@ void HTConnection::setCallbackUrl(const QString& callback)
 #endif
 
 // -----------------------------------------------------------------------------
-QString HTConnection::getBaseUrl() const
+bool HTConnection::isServerUrl(const QUrl& url) const
 {
-  return m_RequiredInfo.baseUrl;
+  // Default ports are filled in so that an explicit :443 matches a URL without a port
+  const QUrl baseUrl(getBaseUrl());
+  const int defaultPort = (baseUrl.scheme() == "https") ? 443 : 80;
+  return url.scheme() == baseUrl.scheme() && url.host() == baseUrl.host() && url.port(defaultPort) == baseUrl.port(defaultPort);
 }
 
 // -----------------------------------------------------------------------------
-void HTConnection::takeFileCache(const HTConnection& other)
+QString HTConnection::getBaseUrl() const
 {
-  m_FileInfoCache = std::move(other.getFileCache());
+  return m_RequiredInfo.baseUrl;
 }
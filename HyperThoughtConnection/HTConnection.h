@@ -33,6 +33,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -40,6 +41,7 @@
 #include <QtCore/QJsonObject>
 #include <QtCore/QObject>
 #include <QtCore/QString>
+#include <QtCore/QUrl>
 #include <QtCore/QVector>
 #include <QtNetwork/QNetworkCookieJar>
 #include <QtNetwork/QNetworkReply>
@@ -48,12 +50,14 @@
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileCache.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTRequestScheduler.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
 
 class QFile;
 class QNetworkAccessManager;
 class QNetworkRequest;
 class QNetworkReply;
+class QThread;
 
 class AbstractFilter;
 class HTFileInfo;
@@ -64,6 +68,10 @@ class HTAbstractRequest;
  * @brief The HTConnection class contains a connection with a target
  * HyperThought server for the purpose of downloading, uploading, and tagging
  * data.
+ *
+ * Each connection runs its QNetworkAccessManager and HTRequestScheduler on a dedicated network thread.
+ * Requests may be created and executed from any thread. Their network calls and callbacks run on the
+ * network thread, so synchronous requests block their calling thread without spinning an event loop.
  */
 class HyperThoughtUtilities_EXPORT HTConnection : public QObject
 {
@@ -81,6 +89,8 @@ public:
   };
   Q_ENUM(Status);
 
+  static constexpr size_t k_Http2MetaDataLimit = 32;
+
   /**
    * @brief Retrieves the last created HTConnection already created in the given filter's pipeline.
    * @param filter
@@ -88,6 +98,16 @@ public:
    */
   static HTConnection* GetExistingConnection(const AbstractFilter* filter);
 
+  /**
+   * @brief Returns the live connection for the given API Access string, creating it if none exists.
+   * Connections are shared for as long as anything holds a reference to them, so repeated preflights
+   * keep the same network manager, pooled sockets, and in-memory file cache.
+   * This method is thread-safe.
+   * @param apiAccess
+   * @return
+   */
+  static std::shared_ptr<HTConnection> GetConnection(const QString& apiAccess);
+
   /**
    * @brief Constructs an invalid HTConnection.
    */
@@ -162,14 +182,60 @@ public:
    */
   HTFileCache& getFileCacheRef();
 
+  /**
+   * @brief Returns true if requests may use HTTP/2. Returns false otherwise.
+   * HTTP/2 is enabled by default and is turned off automatically when the server does not
+   * negotiate it or an HTTP/2 request fails with a protocol error.
+   * @return
+   */
+  bool isHttp2Enabled() const;
+
+  /**
+   * @brief Sets whether requests may use HTTP/2. Metadata requests are multiplexed over a single
+   * HTTP/2 connection, so the scheduler allows more of them in flight while HTTP/2 is enabled.
+   * @param enabled
+   */
+  void setHttp2Enabled(bool enabled);
+
+  /**
+   * @brief Returns the scheduler that queues and limits the requests sent over this connection.
+   * @return
+   */
+  HTRequestScheduler* getScheduler() const;
+
+  /**
+   * @brief Returns the metrics recorded for every request sent over this connection.
+   * @return
+   */
+  const HTMetrics& getMetrics() const;
+
+  /**
+   * @brief Writes the recorded metrics to the given file. Files ending in .json receive the JSON
+   * dump and every other file receives the text dump.
+   * If the HT_METRICS_FILE environment variable is set, the metrics are also written to that file
+   * when the connection is destroyed.
+   * @param filePath
+   * @return True if the file was written. False otherwise.
+   */
+  bool writeMetrics(const QString& filePath) const;
+
+  /**
+   * @brief Returns the thread the network manager and scheduler live in.
+   * @return
+   */
+  QThread* getNetworkThread() const;
+
   /**
    * @brief Returns a pointer to the QNetworkAccessManager.
+   * The manager lives in the network thread and must only be used from there.
    * @return
    */
   QNetworkAccessManager* getNetworkManager() const;
 
   /**
    * @brief Perform a GET request. Returns a QNetworkReply pointer.
+   * This and the other request methods must be called from the network thread,
+   * typically from a send function passed to the scheduler.
    * Wrapper for getNetworkManager()->get(const QNetworkRequest&);
    * @param request
    * @return
@@ -232,14 +298,20 @@ public:
 
   /**
    * @brief Creates and returns a default network request for accessing HyperThought server.
+   * HTTP/2 is allowed while isHttp2Enabled() returns true.
+   * The request does not set Accept-Encoding. Qt then offers gzip and deflate and decompresses the
+   * response while it streams in. Requests that set Accept-Encoding themselves receive the raw body.
    * @return
    */
   QNetworkRequest createDefaultNetworkRequest() const;
 
   /**
-   * @brief Moves the cache from the given connection to this one.
+   * @brief Returns true if the URL has the scheme, host, and port of the HyperThought server.
+   * Returns false otherwise. Requests carrying the access token must only be sent to such URLs.
+   * @param url
+   * @return
    */
-  void takeFileCache(const HTConnection& other);
+  bool isServerUrl(const QUrl& url) const;
 
 signals:
   /**
@@ -270,6 +342,13 @@ signals:
    */
   void statusChanged(Status newStatus);
 
+  /**
+   * @brief This signal is emitted when HTTP/2 is turned off because a reply from the given host
+   * showed that it is not negotiated or not working. Emitted from the network thread.
+   * @param host
+   */
+  void http2Disabled(const QString& host);
+
 protected:
   /**
    * @brief Returns the core HyperThought URL.
@@ -290,11 +369,84 @@ protected:
   QString getAccessToken() const;
 
 private:
+  /**
+   * @brief Releases a connection returned by GetConnection() once the last reference is dropped.
+   * The connection is deleted right away on its own thread or if its thread cannot run deleteLater().
+   * Otherwise the file cache and metrics are written before the deletion is deferred to its thread.
+   * @param connection
+   */
+  static void ReleaseConnection(HTConnection* connection);
+
+  /**
+   * @brief Writes the pending file cache trees to disk and the metrics to HT_METRICS_FILE if it is set.
+   */
+  void flushState();
+
   /**
    * @brief Sets the cookie jar, parent, and SSL error connection for the network manager.
    */
   void setupNetworkManager();
 
+  /**
+   * @brief Starts the network thread and moves the network manager and scheduler into it.
+   * They are deleted on that thread when the connection is destroyed.
+   */
+  void startNetworkThread();
+
+  /**
+   * @brief Opens a connection to the HyperThought server ahead of the first request so that
+   * DNS lookup and the TCP and TLS handshakes are already done when it is sent.
+   * The network manager keeps the connection open for the requests that follow.
+   */
+  void warmUp();
+
+  /**
+   * @brief Falls back to HTTP/1.1 when a reply from the HyperThought server shows that HTTP/2 is not
+   * negotiated or not working. Called on the network thread.
+   * @param reply
+   */
+  void onReplyFinished(QNetworkReply* reply);
+
+  /**
+   * @brief Returns a copy of the request that follows the current HTTP/2 setting.
+   * Requests built before a fallback, including retries, are sent over HTTP/1.1 afterwards.
+   * @param request
+   * @return
+   */
+  QNetworkRequest applyHttpVersion(const QNetworkRequest& request) const;
+
+  /**
+   * @brief Stores the TLS session ticket of an encrypted reply for later handshakes with the same host.
+   * Called on the network thread.
+   * @param reply
+   */
+  void onEncrypted(QNetworkReply* reply);
+
+  /**
+   * @brief Returns the key TLS session tickets are stored under for the given URL.
+   * @param url
+   * @return
+   */
+  static QString SessionKey(const QUrl& url);
+
+  /**
+   * @brief Returns the TLS session ticket stored for the given key or an empty QByteArray.
+   * Tickets are shared by every connection in the process so that new network managers resume
+   * the TLS session of earlier ones instead of performing a full handshake.
+   * This method is thread-safe.
+   * @param key
+   * @return
+   */
+  static QByteArray SessionTicket(const QString& key);
+
+  /**
+   * @brief Stores the TLS session ticket for the given key.
+   * This method is thread-safe.
+   * @param key
+   * @param ticket
+   */
+  static void SetSessionTicket(const QString& key, const QByteArray& ticket);
+
   /**
    * @brief Creates the DoD Banner cookie using the host address
    * This method requires the access token to have been parsed before use.
@@ -307,6 +459,13 @@ private:
    */
   void decodeApiAccess(const QString& apiAccess);
 
+  /**
+   * @brief Returns the directory the file info cache is persisted to for this server and user.
+   * Returns an empty string if the connection is not valid or no cache location is available.
+   * @return
+   */
+  QString createCacheDirectoryPath() const;
+
   /**
    * @brief Slot connection for the access token QNetworkReply.
    * @param err
@@ -363,6 +522,9 @@ private:
   // Network handling
   QNetworkAccessManager* m_NetworkManager;
   QNetworkCookieJar* m_CookieJar;
+  HTRequestScheduler* m_Scheduler;
+  QThread* m_NetworkThread = nullptr;
+  std::atomic<bool> m_Http2Enabled;
 
   HTFileCache m_FileInfoCache;
 };
@@ -33,58 +33,663 @@
 
 #include "HTFileCache.h"
 
+#include <atomic>
+#include <functional>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+
+namespace
+{
+const quint32 k_FileMagic = 0x48544643; // "HTFC"
+const QString k_FileSuffix = ".htcache";
+
+/**
+ * @class FunctionTask
+ * @brief Runs a function on a QThreadPool thread.
+ */
+class FunctionTask : public QRunnable
+{
+public:
+  explicit FunctionTask(std::function<void()> function)
+  : m_Function(std::move(function))
+  {
+  }
+
+  void run() override
+  {
+    m_Function();
+  }
+
+private:
+  std::function<void()> m_Function;
+};
+
+/**
+ * @brief Returns the ID of the folder at the end of the path. Returns an empty string for the scope root.
+ * @param folderPath
+ * @return
+ */
+QString FolderId(const HTFilePath& folderPath)
+{
+  const QStringList fragments = folderPath.getPath().split(',', QString::SkipEmptyParts);
+  return fragments.isEmpty() ? QString() : fragments.last();
+}
+} // namespace
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
 HTFileCache::HTFileCache()
 {
+  m_WritePool.setMaxThreadCount(1);
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileCache::~HTFileCache() = default;
+HTFileCache::HTFileCache(const HTFileCache& other)
+{
+  m_WritePool.setMaxThreadCount(1);
+
+  // Both caches share the trees until either one changes them
+  QMutexLocker locker(&other.m_Mutex);
+  m_CacheDirectory = other.m_CacheDirectory;
+  m_MaxAge = other.m_MaxAge;
+  m_UserInfoTree = other.m_UserInfoTree;
+  m_GroupInfoMap = other.m_GroupInfoMap;
+  m_ProjectInfoMap = other.m_ProjectInfoMap;
+  m_ReadFiles = other.m_ReadFiles;
+  m_ListingValidators = other.m_ListingValidators;
+}
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-bool HTFileCache::hasFileInfo(const HTFilePath& path) const
+HTFileCache::~HTFileCache()
 {
-  HTFileInfoTree fileInfoTree = getFileInfoTree(path);
-  return fileInfoTree.contains(path);
+  flush();
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileInfo HTFileCache::getFileInfo(const HTFilePath& path) const
+HTFileCache& HTFileCache::operator=(const HTFileCache& other)
 {
-  HTFileInfoTree fileInfoTree = getFileInfoTree(path);
-  return fileInfoTree.find(path);
+  if(this == &other)
+  {
+    return *this;
+  }
+
+  // Copy first so that both mutexes are never held at once
+  HTFileCache copy(other);
+
+  QMutexLocker locker(&m_Mutex);
+  m_CacheDirectory = std::move(copy.m_CacheDirectory);
+  m_MaxAge = copy.m_MaxAge;
+  m_UserInfoTree = std::move(copy.m_UserInfoTree);
+  m_GroupInfoMap = std::move(copy.m_GroupInfoMap);
+  m_ProjectInfoMap = std::move(copy.m_ProjectInfoMap);
+  m_ReadFiles = std::move(copy.m_ReadFiles);
+  m_ListingValidators = std::move(copy.m_ListingValidators);
+  return *this;
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileInfoTree HTFileCache::getFileInfoTree(const HTFilePath& source) const
+const HTFileInfoTree::ConstPointer& HTFileCache::EmptyTree()
 {
-  switch(source.getScopeType())
+  static const HTFileInfoTree::ConstPointer emptyTree = std::make_shared<const HTFileInfoTree>();
+  return emptyTree;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+QString HTFileCache::getCacheDirectory() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_CacheDirectory;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::setCacheDirectory(const QString& dirPath)
+{
+  // Files of the previous directory are complete if it is set again later.
+  // The write thread locks the mutex, so it must not be held while waiting.
+  flush();
+
+  QMutexLocker locker(&m_Mutex);
+  if(dirPath == m_CacheDirectory)
+  {
+    return;
+  }
+
+  m_CacheDirectory = dirPath;
+  m_UserInfoTree.reset();
+  m_GroupInfoMap.clear();
+  m_ProjectInfoMap.clear();
+  m_ReadFiles.clear();
+  m_ListingValidators.clear();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+qint64 HTFileCache::getMaxAge() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_MaxAge;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::setMaxAge(qint64 seconds)
+{
+  QMutexLocker locker(&m_Mutex);
+  m_MaxAge = seconds;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::clear()
+{
+  // A write that already started finishes before the files are removed
+  {
+    QMutexLocker writeLocker(&m_WriteMutex);
+    m_PendingWrites.clear();
+  }
+  flush();
+
+  QMutexLocker locker(&m_Mutex);
+  m_UserInfoTree.reset();
+  m_GroupInfoMap.clear();
+  m_ProjectInfoMap.clear();
+  m_ReadFiles.clear();
+  m_ListingValidators.clear();
+
+  if(m_CacheDirectory.isEmpty())
+  {
+    return;
+  }
+
+  QDir cacheDir(m_CacheDirectory);
+  const QStringList fileNames = cacheDir.entryList({"*" + k_FileSuffix}, QDir::Files);
+  for(const QString& fileName : fileNames)
+  {
+    cacheDir.remove(fileName);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+QString HTFileCache::ScopeKey(HTFilePath::ScopeType scope, const QString& id)
+{
+  switch(scope)
+  {
+  case HTFilePath::ScopeType::User:
+    return "user";
+  case HTFilePath::ScopeType::Group:
+    return "group-" + QString::fromLatin1(QUrl::toPercentEncoding(id));
+  case HTFilePath::ScopeType::Project:
+    return "project-" + QString::fromLatin1(QUrl::toPercentEncoding(id));
+  }
+  return QString();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+QString HTFileCache::getCacheFilePath(HTFilePath::ScopeType scope, const QString& id) const
+{
+  if(m_CacheDirectory.isEmpty())
+  {
+    return QString();
+  }
+
+  return QDir(m_CacheDirectory).filePath(ScopeKey(scope, id) + k_FileSuffix);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Pointer HTFileCache::readTree(const QString& filePath, ValidatorMap& validators) const
+{
+  QFile file(filePath);
+  if(!file.exists() || !file.open(QIODevice::ReadOnly))
+  {
+    return nullptr;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_9);
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  QDateTime savedAt;
+  in >> magic >> version >> savedAt;
+
+  bool isValid = (in.status() == QDataStream::Ok) && (k_FileMagic == magic) && (k_FormatVersion == version);
+  isValid = isValid && savedAt.isValid() && (savedAt.secsTo(QDateTime::currentDateTimeUtc()) <= m_MaxAge);
+
+  HTFileInfoTree::Pointer infoTree;
+  if(isValid)
+  {
+    infoTree = std::make_shared<HTFileInfoTree>();
+    in >> *infoTree;
+
+    quint32 validatorCount = 0;
+    in >> validatorCount;
+    for(quint32 i = 0; i < validatorCount && in.status() == QDataStream::Ok; i++)
+    {
+      QString url;
+      ListingValidators listingValidators;
+      in >> url >> listingValidators.eTag >> listingValidators.lastModified;
+      validators[url] = listingValidators;
+    }
+    isValid = (in.status() == QDataStream::Ok);
+  }
+
+  if(!isValid)
+  {
+    file.close();
+    file.remove();
+    validators.clear();
+    return nullptr;
+  }
+
+  return infoTree;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+QByteArray HTFileCache::SerializeTree(const HTFileInfoTree& infoTree, const ValidatorMap& validators)
+{
+  QByteArray contents;
+  QDataStream out(&contents, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_9);
+  out << k_FileMagic << k_FormatVersion << QDateTime::currentDateTimeUtc();
+  out << infoTree;
+
+  out << static_cast<quint32>(validators.size());
+  for(const auto& listingValidators : validators)
+  {
+    out << listingValidators.first << listingValidators.second.eTag << listingValidators.second.lastModified;
+  }
+  return contents;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::WriteCacheFile(const QString& filePath, const QByteArray& contents)
+{
+  const QString cacheDirectory = QFileInfo(filePath).absolutePath();
+  if(!QDir().mkpath(cacheDirectory))
+  {
+    qDebug() << "Could not create HyperThought cache directory" << cacheDirectory;
+    return;
+  }
+
+  // Write to a temporary file so that a partially written cache is never read
+  QSaveFile file(filePath);
+  if(!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit())
+  {
+    qDebug() << "Could not write HyperThought cache file" << filePath;
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::scheduleWrite(HTFilePath::ScopeType scope, const QString& id)
+{
+  const QString filePath = getCacheFilePath(scope, id);
+  if(filePath.isEmpty())
+  {
+    return;
+  }
+
+  QMutexLocker locker(&m_WriteMutex);
+  m_PendingWrites[filePath] = {scope, id};
+  if(!m_WriteScheduled)
+  {
+    m_WriteScheduled = true;
+    m_WritePool.start(new FunctionTask([this]() { writePendingTrees(); }));
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::writePendingTrees()
+{
+  QMutexLocker writeLocker(&m_WriteMutex);
+
+  // Changes made during the delay are written together with the ones that scheduled the write
+  if(!m_FlushRequested)
+  {
+    m_WriteCondition.wait(&m_WriteMutex, k_WriteDelayMs);
+  }
+
+  while(!m_PendingWrites.empty())
+  {
+    std::map<QString, PendingWrite> pendingWrites;
+    pendingWrites.swap(m_PendingWrites);
+    writeLocker.unlock();
+
+    for(const auto& pendingWrite : pendingWrites)
+    {
+      const QString& filePath = pendingWrite.first;
+      QByteArray contents;
+      {
+        // Holding a reference to the tree while it is written would make every change in the
+        // meantime copy it, so it is serialized under the lock and only the disk write is not
+        QMutexLocker locker(&m_Mutex);
+        const PendingWrite& pending = pendingWrite.second;
+        if(getCacheFilePath(pending.scope, pending.id) != filePath)
+        {
+          continue;
+        }
+        HTFileInfoTree::Pointer* slot = findLoadedSlot(pending.scope, pending.id);
+        if(nullptr != slot)
+        {
+          auto iter = m_ListingValidators.find(ScopeKey(pending.scope, pending.id));
+          contents = SerializeTree(**slot, (iter != m_ListingValidators.end()) ? iter->second : ValidatorMap());
+        }
+      }
+
+      if(contents.isEmpty())
+      {
+        QFile::remove(filePath);
+      }
+      else
+      {
+        WriteCacheFile(filePath, contents);
+      }
+    }
+
+    writeLocker.relock();
+  }
+  m_WriteScheduled = false;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::flush()
+{
+  {
+    QMutexLocker writeLocker(&m_WriteMutex);
+    m_FlushRequested = true;
+    m_WriteCondition.wakeAll();
+  }
+  m_WritePool.waitForDone();
+
+  QMutexLocker writeLocker(&m_WriteMutex);
+  m_FlushRequested = false;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Pointer* HTFileCache::findLoadedSlot(HTFilePath::ScopeType scope, const QString& id) const
+{
+  MapType* infoMap = nullptr;
+  switch(scope)
   {
   case HTFilePath::ScopeType::User:
-    return m_UserInfoTree;
+    return (nullptr != m_UserInfoTree) ? &m_UserInfoTree : nullptr;
   case HTFilePath::ScopeType::Group:
-    return getGroupTree(source.getSourceId());
+    infoMap = &m_GroupInfoMap;
+    break;
   case HTFilePath::ScopeType::Project:
-    return getProjectTree(source.getSourceId());
+    infoMap = &m_ProjectInfoMap;
+    break;
   }
 
-  return HTFileInfoTree();
+  auto iter = infoMap->find(id);
+  return (iter != infoMap->end() && nullptr != iter->second) ? &iter->second : nullptr;
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void HTFileCache::setFileInfoTree(const HTFilePath& source, const HTFileInfoTree& infoTree)
+HTFileInfoTree::Pointer* HTFileCache::findSlot(HTFilePath::ScopeType scope, const QString& id) const
+{
+  HTFileInfoTree::Pointer* slot = findLoadedSlot(scope, id);
+  if(nullptr != slot)
+  {
+    return slot;
+  }
+
+  // Each cache file is read at most once
+  const QString filePath = getCacheFilePath(scope, id);
+  if(filePath.isEmpty() || !m_ReadFiles.insert(filePath).second)
+  {
+    return nullptr;
+  }
+
+  ValidatorMap validators;
+  HTFileInfoTree::Pointer infoTree = readTree(filePath, validators);
+  if(nullptr == infoTree)
+  {
+    return nullptr;
+  }
+  m_ListingValidators[ScopeKey(scope, id)] = std::move(validators);
+
+  switch(scope)
+  {
+  case HTFilePath::ScopeType::User:
+    m_UserInfoTree = infoTree;
+    return &m_UserInfoTree;
+  case HTFilePath::ScopeType::Group:
+    return &(m_GroupInfoMap[id] = infoTree);
+  case HTFilePath::ScopeType::Project:
+    return &(m_ProjectInfoMap[id] = infoTree);
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileInfoTree& HTFileCache::DetachTree(HTFileInfoTree::Pointer& slot)
+{
+  // New references are only handed out with the mutex held, so a tree nobody else holds stays private
+  if(slot.use_count() > 1)
+  {
+    slot = std::make_shared<HTFileInfoTree>(*slot);
+  }
+  else
+  {
+    // Pairs with the release of the last reader's reference
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return *slot;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool HTFileCache::hasFileInfo(const HTFilePath& path) const
+{
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree* fileInfoTree = findFileInfoTree(path);
+  return (nullptr != fileInfoTree) && fileInfoTree->contains(path);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileInfo HTFileCache::getFileInfo(const HTFilePath& path) const
+{
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree* fileInfoTree = findFileInfoTree(path);
+  if(nullptr == fileInfoTree)
+  {
+    return HTFileInfo();
+  }
+  return fileInfoTree->find(path);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool HTFileCache::getFolderContents(const HTFilePath& folderPath, std::vector<HTFileInfo>& files) const
+{
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree* fileInfoTree = findFileInfoTree(folderPath);
+  if(nullptr == fileInfoTree)
+  {
+    return false;
+  }
+
+  // Folders are found by their ID. Crawls below the scope root are merged into the scope's tree,
+  // so the tree's root always holds the scope root's contents.
+  const QString folderId = FolderId(folderPath);
+  const HTFileInfoTree::Node* folderNode = folderId.isEmpty() ? &fileInfoTree->getRoot() : fileInfoTree->findNodeById(folderId);
+  if(nullptr == folderNode)
+  {
+    return false;
+  }
+
+  files.reserve(files.size() + folderNode->size());
+  for(const HTFileInfoTree::Node* child : folderNode->children)
+  {
+    files.push_back(child->fileInfo);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+const HTFileInfoTree* HTFileCache::findFileInfoTree(const HTFilePath& source) const
+{
+  const HTFileInfoTree::Pointer* slot = findSlot(source.getScopeType(), source.getSourceId());
+  return (nullptr != slot) ? slot->get() : nullptr;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileInfoTree::ConstPointer HTFileCache::getFileInfoTree(const HTFilePath& source) const
+{
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree::Pointer* slot = findSlot(source.getScopeType(), source.getSourceId());
+  return (nullptr != slot) ? *slot : EmptyTree();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileInfoTree::ConstPointer HTFileCache::getFileInfoTree(const HTFilePath& source, ValidatorMap& validators) const
+{
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree::Pointer* slot = findSlot(source.getScopeType(), source.getSourceId());
+  if(nullptr == slot)
+  {
+    validators.clear();
+    return EmptyTree();
+  }
+
+  auto iter = m_ListingValidators.find(ScopeKey(source.getScopeType(), source.getSourceId()));
+  validators = (iter != m_ListingValidators.end()) ? iter->second : ValidatorMap();
+  return *slot;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTFileCache::ValidatorMap HTFileCache::getListingValidators(const HTFilePath& source) const
+{
+  QMutexLocker locker(&m_Mutex);
+  if(nullptr == findSlot(source.getScopeType(), source.getSourceId()))
+  {
+    return ValidatorMap();
+  }
+
+  auto iter = m_ListingValidators.find(ScopeKey(source.getScopeType(), source.getSourceId()));
+  return (iter != m_ListingValidators.end()) ? iter->second : ValidatorMap();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::setFileInfoTree(const HTFilePath& source, const HTFileInfoTree::Pointer& infoTree)
+{
+  setFileInfoTree(source, infoTree, ValidatorMap());
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::setFileInfoTree(const HTFilePath& source, const HTFileInfoTree::Pointer& infoTree, const ValidatorMap& validators)
+{
+  QMutexLocker locker(&m_Mutex);
+  storeTree(source, infoTree, validators);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool HTFileCache::mergeFolder(const HTFilePath& folderPath, const HTFileInfoTree& contents, const ValidatorMap& validators, HTFileInfoTree::ChangeSet& changes, bool recursive)
+{
+  QMutexLocker locker(&m_Mutex);
+  HTFileInfoTree::Pointer* slot = findSlot(folderPath.getScopeType(), folderPath.getSourceId());
+  const QString folderId = FolderId(folderPath);
+  if(nullptr == slot || (!folderId.isEmpty() && nullptr == (*slot)->findNodeById(folderId)))
+  {
+    return false;
+  }
+
+  // Unchanged listings, such as revalidated ones, leave the tree and the snapshots readers hold alone
+  if(!(*slot)->folderMatches(folderId, contents, recursive))
+  {
+    DetachTree(*slot).mergeFolder(folderId, contents, changes, recursive);
+  }
+
+  const QString scopeKey = ScopeKey(folderPath.getScopeType(), folderPath.getSourceId());
+  ValidatorMap& storedValidators = m_ListingValidators[scopeKey];
+  bool validatorsChanged = false;
+  for(const auto& listing : validators)
+  {
+    ListingValidators& stored = storedValidators[listing.first];
+    if(stored.eTag != listing.second.eTag || stored.lastModified != listing.second.lastModified)
+    {
+      stored = listing.second;
+      validatorsChanged = true;
+    }
+  }
+
+  if(!changes.isEmpty() || validatorsChanged)
+  {
+    scheduleWrite(folderPath.getScopeType(), folderPath.getSourceId());
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::storeTree(const HTFilePath& source, const HTFileInfoTree::Pointer& infoTree, const ValidatorMap& validators)
 {
   switch(source.getScopeType())
   {
@@ -98,6 +703,70 @@ void HTFileCache::setFileInfoTree(const HTFilePath& source, const HTFileInfoTree
     m_ProjectInfoMap[source.getSourceId()] = infoTree;
     break;
   }
+
+  // Validators only describe the tree they were stored with
+  const QString scopeKey = ScopeKey(source.getScopeType(), source.getSourceId());
+  if(nullptr == infoTree || validators.empty())
+  {
+    m_ListingValidators.erase(scopeKey);
+  }
+  else
+  {
+    m_ListingValidators[scopeKey] = validators;
+  }
+
+  // The in-memory tree is newer than anything on disk
+  const QString filePath = getCacheFilePath(source.getScopeType(), source.getSourceId());
+  if(!filePath.isEmpty())
+  {
+    m_ReadFiles.insert(filePath);
+  }
+  scheduleWrite(source.getScopeType(), source.getSourceId());
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+size_t HTFileCache::addFileInfo(const HTFilePath& source, const std::vector<HTFileInfo>& items)
+{
+  QMutexLocker locker(&m_Mutex);
+  HTFileInfoTree::Pointer* slot = findSlot(source.getScopeType(), source.getSourceId());
+  if(nullptr == slot)
+  {
+    auto infoTree = std::make_shared<HTFileInfoTree>();
+    infoTree->insert(items);
+    infoTree->sort();
+    storeTree(source, infoTree, ValidatorMap());
+    return infoTree->size();
+  }
+
+  // Trees are only copied if something is added while a reader holds them
+  std::vector<HTFileInfo> missingItems;
+  for(const auto& item : items)
+  {
+    if(nullptr == (*slot)->findNode(item))
+    {
+      missingItems.push_back(item);
+    }
+  }
+  if(missingItems.empty())
+  {
+    return 0;
+  }
+
+  HTFileInfoTree& infoTree = DetachTree(*slot);
+  infoTree.insert(missingItems);
+  infoTree.sort();
+  scheduleWrite(source.getScopeType(), source.getSourceId());
+  return missingItems.size();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTFileCache::setFileInfoTree(const HTFilePath& source, HTFileInfoTree&& infoTree)
+{
+  setFileInfoTree(source, std::make_shared<HTFileInfoTree>(std::move(infoTree)));
 }
 
 // -----------------------------------------------------------------------------
@@ -105,7 +774,8 @@ void HTFileCache::setFileInfoTree(const HTFilePath& source, const HTFileInfoTree
 // -----------------------------------------------------------------------------
 bool HTFileCache::containsGroup(const QString& id) const
 {
-  return m_GroupInfoMap.find(id) != m_GroupInfoMap.end();
+  QMutexLocker locker(&m_Mutex);
+  return nullptr != findSlot(HTFilePath::ScopeType::Group, id);
 }
 
 // -----------------------------------------------------------------------------
@@ -113,29 +783,26 @@ bool HTFileCache::containsGroup(const QString& id) const
 // -----------------------------------------------------------------------------
 bool HTFileCache::containsProject(const QString& id) const
 {
-  return m_ProjectInfoMap.find(id) != m_ProjectInfoMap.end();
+  QMutexLocker locker(&m_Mutex);
+  return nullptr != findSlot(HTFilePath::ScopeType::Project, id);
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileInfoTree HTFileCache::getGroupTree(const QString& id) const
+HTFileInfoTree::ConstPointer HTFileCache::getGroupTree(const QString& id) const
 {
-  if(!containsGroup(id))
-  {
-    return {};
-  }
-  return m_GroupInfoMap.at(id);
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree::Pointer* slot = findSlot(HTFilePath::ScopeType::Group, id);
+  return (nullptr != slot) ? *slot : EmptyTree();
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTFileInfoTree HTFileCache::getProjectTree(const QString& id) const
+HTFileInfoTree::ConstPointer HTFileCache::getProjectTree(const QString& id) const
 {
-  if(!containsProject(id))
-  {
-    return {};
-  }
-  return m_ProjectInfoMap.at(id);
+  QMutexLocker locker(&m_Mutex);
+  const HTFileInfoTree::Pointer* slot = findSlot(HTFilePath::ScopeType::Project, id);
+  return (nullptr != slot) ? *slot : EmptyTree();
 }
@@ -34,8 +34,14 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <vector>
 
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
 #include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
@@ -47,15 +53,105 @@
  * Each group or project stored has their own space in the cache to allow multiple projects or groups
  * to be cached without overwriting previous collections assuming all IDs are different. If a new group
  * or project has the same ID as a previous item of the same Scope, the previous item is overwritten.
+ *
+ * Each scope's tree is reference-counted. Readers share the cached tree instead of copying it and must
+ * treat it as an immutable snapshot. The cache changes a tree in place while nobody else holds it and
+ * copies it first otherwise, so readers keep the snapshot they already hold and copies of the cache
+ * share every tree until one of them changes it. A copied tree shares its nodes with the snapshot, and
+ * a change only copies the changed folders and the folders above them.
+ *
+ * When a cache directory is set, every tree handed to the cache is also written to disk and trees
+ * that are not in memory are loaded lazily from that directory the first time their scope is
+ * accessed. Files written by a different format version or older than the maximum age are
+ * considered stale and are discarded.
+ *
+ * Writes happen on a background thread k_WriteDelayMs after a scope changes. The thread serializes
+ * the scope's current tree under the cache's lock and writes the bytes after releasing it, so a burst
+ * of merges is written once, the writer never holds a tree that a merge would have to copy, and
+ * callers never wait for the disk. flush() and the destructor wait for pending writes.
+ *
+ * Each tree can be stored with the HTTP validators of the folder listings it was built from. Requests
+ * send them back with If-None-Match and If-Modified-Since, and reuse the cached children of every
+ * folder the server reports as unchanged. The validators are replaced together with their tree.
+ *
+ * A re-crawled folder can be merged into the cached tree with mergeFolder() instead of replacing
+ * the whole scope. Only the folder's items are compared, and listings that did not change leave the
+ * tree untouched.
+ *
+ * Single items, such as a file and its ancestor folders, can be added with addFileInfo() without
+ * crawling their scope. A tree created this way only holds the items added to it until the scope
+ * is crawled.
+ *
+ * Every public method is thread-safe. Requests update the cache from the connection's network thread
+ * while filters and widgets read it from their own threads.
  */
 class HyperThoughtUtilities_EXPORT HTFileCache
 {
-  using MapType = std::map<QString, HTFileInfoTree>;
+  using MapType = std::map<QString, HTFileInfoTree::Pointer>;
 
 public:
+  /**
+   * @brief The HTTP validators the server returned for one folder listing.
+   */
+  struct ListingValidators
+  {
+    QByteArray eTag;
+    QByteArray lastModified;
+  };
+
+  /**
+   * @brief Listing validators keyed by the listing URL.
+   */
+  using ValidatorMap = std::map<QString, ListingValidators>;
+
+  static constexpr quint32 k_FormatVersion = 2;
+  static constexpr qint64 k_DefaultMaxAge = 7 * 24 * 60 * 60;
+  static constexpr unsigned long k_WriteDelayMs = 1000;
+
   HTFileCache();
+  HTFileCache(const HTFileCache& other);
   virtual ~HTFileCache();
 
+  HTFileCache& operator=(const HTFileCache& other);
+
+  /**
+   * @brief Returns the directory the cache is persisted to.
+   * Returns an empty string if the cache is memory-only.
+   * @return
+   */
+  QString getCacheDirectory() const;
+
+  /**
+   * @brief Sets the directory the cache is persisted to. Changing the directory
+   * drops every tree held in memory. An empty string makes the cache memory-only.
+   * @param dirPath
+   */
+  void setCacheDirectory(const QString& dirPath);
+
+  /**
+   * @brief Returns the maximum age in seconds of a persisted tree before it is considered stale.
+   * @return
+   */
+  qint64 getMaxAge() const;
+
+  /**
+   * @brief Sets the maximum age in seconds of a persisted tree before it is considered stale.
+   * @param seconds
+   */
+  void setMaxAge(qint64 seconds);
+
+  /**
+   * @brief Removes every tree from memory and from the cache directory.
+   * Pending writes are dropped.
+   */
+  void clear();
+
+  /**
+   * @brief Writes pending changes to the cache directory without waiting for the write delay
+   * and returns once they are on disk.
+   */
+  void flush();
+
   /**
    * @brief Checks if file info exists for the specified path.
    * Returns true if the data exists. Returns false otherwise.
@@ -72,20 +168,91 @@ public:
   HTFileInfo getFileInfo(const HTFilePath& path) const;
 
   /**
-   * @brief Returns the HTFileInfoTree for the given source.
+   * @brief Returns the shared HTFileInfoTree snapshot for the given source.
    * Only the ScopeType and optional SourceId are extracted from the source.
+   * Returns an empty tree if the source has not been cached.
+   * @param source
+   * @return
+   */
+  HTFileInfoTree::ConstPointer getFileInfoTree(const HTFilePath& source) const;
+
+  /**
+   * @brief Copies the items of the folder at the given path from the cached tree of its scope.
+   * Returns false if no tree is cached for the scope or the folder is not in it.
+   * @param folderPath
+   * @param files
+   * @return
+   */
+  bool getFolderContents(const HTFilePath& folderPath, std::vector<HTFileInfo>& files) const;
+
+  /**
+   * @brief Returns the listing validators stored with the cached tree of the given source's scope.
+   * @param source
+   * @return
+   */
+  ValidatorMap getListingValidators(const HTFilePath& source) const;
+
+  /**
+   * @brief Returns the shared HTFileInfoTree snapshot for the given source and copies the
+   * listing validators stored with it into validators.
    * @param source
+   * @param validators
    * @return
    */
-  HTFileInfoTree getFileInfoTree(const HTFilePath& source) const;
+  HTFileInfoTree::ConstPointer getFileInfoTree(const HTFilePath& source, ValidatorMap& validators) const;
 
   /**
    * @brief Sets the HTFileInfoTree for the given source.
    * ScopeType and optional SourceId are taken from the source path for reference purposes.
+   * The cache takes over the tree. The caller must not modify it afterwards.
+   * Listing validators stored for the previous tree are dropped.
    * @param source
    * @param infoTree
    */
-  void setFileInfoTree(const HTFilePath& source, const HTFileInfoTree& infoTree);
+  void setFileInfoTree(const HTFilePath& source, const HTFileInfoTree::Pointer& infoTree);
+
+  /**
+   * @brief Sets the HTFileInfoTree for the given source together with the validators
+   * of the folder listings it was built from.
+   * @param source
+   * @param infoTree
+   * @param validators
+   */
+  void setFileInfoTree(const HTFilePath& source, const HTFileInfoTree::Pointer& infoTree, const ValidatorMap& validators);
+
+  /**
+   * @brief Merges the crawl of a single folder into the cached tree of the folder's scope.
+   * Every item below the folder is added, updated, or removed to match the crawl, and the listing
+   * validators of the crawl replace the ones stored for the same listings. The cached tree is only
+   * changed if anything changed, and the changed folders are only copied if a reader still holds it.
+   * Returns false without changing the cache if no tree is cached for the scope or the folder is not in it.
+   * @param folderPath
+   * @param contents The crawled tree. Its root holds the folder's contents.
+   * @param validators
+   * @param changes Receives every added, updated, and removed item.
+   * @param recursive False if the contents only list the folder's direct children. Only those are
+   * then merged and the cached contents of listed subfolders are kept.
+   * @return
+   */
+  bool mergeFolder(const HTFilePath& folderPath, const HTFileInfoTree& contents, const ValidatorMap& validators, HTFileInfoTree::ChangeSet& changes,
+                   bool recursive = true);
+
+  /**
+   * @brief Adds the given items to the cached tree of their scope. Items must be ordered parents first
+   * and items already in the tree are left unchanged. A tree holding only the given items is created if
+   * none is cached for the scope. The listing validators stored for the tree are kept.
+   * @param source
+   * @param items
+   * @return The number of items added.
+   */
+  size_t addFileInfo(const HTFilePath& source, const std::vector<HTFileInfo>& items);
+
+  /**
+   * @brief Moves the HTFileInfoTree into a new snapshot for the given source.
+   * @param source
+   * @param infoTree
+   */
+  void setFileInfoTree(const HTFilePath& source, HTFileInfoTree&& infoTree);
 
   /**
    * @brief Checks if the cache contains information for the given group ID
@@ -106,17 +273,147 @@ public:
    * @param id
    * @return
    */
-  HTFileInfoTree getGroupTree(const QString& id) const;
+  HTFileInfoTree::ConstPointer getGroupTree(const QString& id) const;
 
   /**
    * @brief Returns the project HTFileInfoTree for the given ID.
    * @param id
    * @return
    */
-  HTFileInfoTree getProjectTree(const QString& id) const;
+  HTFileInfoTree::ConstPointer getProjectTree(const QString& id) const;
 
 private:
-  HTFileInfoTree m_UserInfoTree;
-  MapType m_GroupInfoMap;
-  MapType m_ProjectInfoMap;
+  /**
+   * @brief Returns the in-memory slot for the given scope and ID without reading the cache directory.
+   * Returns nullptr if no tree is in memory for the scope and ID.
+   * @param scope
+   * @param id
+   * @return
+   */
+  HTFileInfoTree::Pointer* findLoadedSlot(HTFilePath::ScopeType scope, const QString& id) const;
+
+  /**
+   * @brief Returns the in-memory slot for the given scope and ID, loading the tree
+   * from the cache directory the first time it is requested.
+   * Returns nullptr if no tree exists for the scope and ID.
+   * @param scope
+   * @param id
+   * @return
+   */
+  HTFileInfoTree::Pointer* findSlot(HTFilePath::ScopeType scope, const QString& id) const;
+
+  /**
+   * @brief Returns the slot's tree for changing it in place. A tree that a reader or another cache
+   * still holds is replaced by a copy that shares its nodes. The mutex must be held.
+   * @param slot
+   * @return
+   */
+  static HTFileInfoTree& DetachTree(HTFileInfoTree::Pointer& slot);
+
+  /**
+   * @brief Stores the tree and validators for the given source in memory and schedules writing them to disk.
+   * The mutex must be held.
+   * @param source
+   * @param infoTree
+   * @param validators
+   */
+  void storeTree(const HTFilePath& source, const HTFileInfoTree::Pointer& infoTree, const ValidatorMap& validators);
+
+  /**
+   * @brief Returns a key that is unique for the given scope and ID.
+   * @param scope
+   * @param id
+   * @return
+   */
+  static QString ScopeKey(HTFilePath::ScopeType scope, const QString& id);
+
+  /**
+   * @brief Returns the file path used to persist the given scope and ID.
+   * @param scope
+   * @param id
+   * @return
+   */
+  QString getCacheFilePath(HTFilePath::ScopeType scope, const QString& id) const;
+
+  /**
+   * @brief Reads the tree and its listing validators persisted at the given file path.
+   * Returns nullptr if the file does not exist, cannot be read, or is stale.
+   * Unreadable and stale files are removed.
+   * @param filePath
+   * @param validators
+   * @return
+   */
+  HTFileInfoTree::Pointer readTree(const QString& filePath, ValidatorMap& validators) const;
+
+  /**
+   * @brief Returns the contents of a cache file holding the tree and its listing validators.
+   * @param infoTree
+   * @param validators
+   * @return
+   */
+  static QByteArray SerializeTree(const HTFileInfoTree& infoTree, const ValidatorMap& validators);
+
+  /**
+   * @brief Replaces the cache file at the given path with the given contents.
+   * @param filePath
+   * @param contents
+   */
+  static void WriteCacheFile(const QString& filePath, const QByteArray& contents);
+
+  /**
+   * @brief Queues the tree of the given scope and ID to be written by the write thread.
+   * Does nothing if the cache is memory-only. The mutex must be held.
+   * @param scope
+   * @param id
+   */
+  void scheduleWrite(HTFilePath::ScopeType scope, const QString& id);
+
+  /**
+   * @brief Runs on the write thread. Waits for the write delay unless a flush was requested and
+   * then writes the current tree of every queued scope. Each tree is serialized while the mutex is
+   * held. Scopes without a tree have their file removed.
+   */
+  void writePendingTrees();
+
+  /**
+   * @brief Returns the cached tree for the given source without sharing ownership.
+   * Returns nullptr if the source has not been cached.
+   * @param source
+   * @return
+   */
+  const HTFileInfoTree* findFileInfoTree(const HTFilePath& source) const;
+
+  /**
+   * @brief Returns the shared empty tree returned for sources that have not been cached.
+   * @return
+   */
+  static const HTFileInfoTree::ConstPointer& EmptyTree();
+
+  mutable QMutex m_Mutex;
+  QString m_CacheDirectory;
+  qint64 m_MaxAge = k_DefaultMaxAge;
+
+  // Trees are loaded lazily from const accessors
+  mutable HTFileInfoTree::Pointer m_UserInfoTree;
+  mutable MapType m_GroupInfoMap;
+  mutable MapType m_ProjectInfoMap;
+  mutable std::set<QString> m_ReadFiles;
+  mutable std::map<QString, ValidatorMap> m_ListingValidators;
+
+  /**
+   * @brief A scope whose tree is waiting to be written by the write thread.
+   */
+  struct PendingWrite
+  {
+    HTFilePath::ScopeType scope;
+    QString id;
+  };
+
+  // Guards the pending writes only. It may be locked while m_Mutex is held, never the other way round.
+  QMutex m_WriteMutex;
+  QWaitCondition m_WriteCondition;
+  std::map<QString, PendingWrite> m_PendingWrites;
+  bool m_WriteScheduled = false;
+  bool m_FlushRequested = false;
+  QThreadPool m_WritePool;
 };
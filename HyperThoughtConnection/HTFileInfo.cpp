@@ -106,7 +106,7 @@ HTFileInfo::~HTFileInfo() = default;
 std::vector<HTFileInfo> HTFileInfo::FromDocument(const QJsonDocument& doc)
 {
   std::vector<HTFileInfo> files;
-  QJsonArray arr = doc.array();
+  QJsonArray arr = doc.isObject() ? doc.object()["results"].toArray() : doc.array();
   for(const QJsonValueRef& val : arr)
   {
     files.emplace_back(val.toObject());
@@ -114,6 +114,16 @@ std::vector<HTFileInfo> HTFileInfo::FromDocument(const QJsonDocument& doc)
   return files;
 }
 
+// -----------------------------------------------------------------------------
+QUrl HTFileInfo::NextPageUrl(const QJsonDocument& doc)
+{
+  if(!doc.isObject())
+  {
+    return QUrl();
+  }
+  return QUrl(doc.object()["next"].toString());
+}
+
 // -----------------------------------------------------------------------------
 QString HTFileInfo::getId() const
 {
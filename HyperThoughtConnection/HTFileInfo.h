@@ -37,6 +37,7 @@
 #include <QtCore/QJsonObject>
 #include <QtCore/QMap>
 #include <QtCore/QMetaType>
+#include <QtCore/QUrl>
 #include <QtCore/QVector>
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTMetaData.h"
@@ -105,11 +106,21 @@ public:
 
   /**
    * @brief Constructs a vector of HTFiles from the given json document.
+   * The document is either an array of items or one page of a paged listing, an object that
+   * holds the page's items in "results".
    * @param doc
    * @return
    */
   static std::vector<HTFileInfo> FromDocument(const QJsonDocument& doc);
 
+  /**
+   * @brief Returns the URL of the next page of a paged listing document.
+   * Returns an empty URL for the last page and for listings that are not paged.
+   * @param doc
+   * @return
+   */
+  static QUrl NextPageUrl(const QJsonDocument& doc);
+
   /**
    * @brief Returns the ID value.
    * @return
@@ -33,9 +33,13 @@
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoModel.h"
 
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileInfoRequest.h"
+
 // -----------------------------------------------------------------------------
 HTFileInfoModel::HTFileInfoModel(QObject* parent)
 : QAbstractItemModel(parent)
+, m_FileTree(std::make_shared<const HTFileInfoTree>())
 {
 }
 
@@ -47,7 +51,7 @@ const HTFileInfoTree::Node* HTFileInfoModel::getNode(const QModelIndex& index) c
 {
   if(!index.isValid())
   {
-    return &m_FileTree.getRoot();
+    return &m_FileTree->getRoot();
   }
   return static_cast<HTFileInfoTree::Node*>(index.internalPointer());
 }
@@ -78,7 +82,7 @@ bool HTFileInfoModel::isDir(const QModelIndex& index) const
 // -----------------------------------------------------------------------------
 std::vector<HTFileInfo> HTFileInfoModel::getTopLevelFiles() const
 {
-  const auto& root = m_FileTree.getRoot();
+  const auto& root = m_FileTree->getRoot();
   size_t size = root.size();
 
   std::vector<HTFileInfo> topLevelFiles(size);
@@ -109,7 +113,7 @@ std::vector<HTFileInfo> HTFileInfoModel::getChildItems(const QModelIndex& parent
 // -----------------------------------------------------------------------------
 std::vector<HTFileInfo> HTFileInfoModel::getChildItems(const HTFileInfo& parent) const
 {
-  const HTFileInfoTree::Node* parentNode = m_FileTree.findNode(parent);
+  const HTFileInfoTree::Node* parentNode = m_FileTree->findNode(parent);
   if(nullptr == parentNode)
   {
     return {};
@@ -126,24 +130,165 @@ std::vector<HTFileInfo> HTFileInfoModel::getChildItems(const HTFileInfo& parent)
 // -----------------------------------------------------------------------------
 QModelIndex HTFileInfoModel::findIndex(const HTFilePath& path) const
 {
-  const HTFileInfoTree::Node* constNode = m_FileTree.findNode(path);
+  const HTFileInfoTree::Node* constNode = m_FileTree->findNode(path);
   if(nullptr == constNode)
   {
     return QModelIndex();
   }
-  int row = m_FileTree.getIndexWithinParent(constNode);
+  int row = m_FileTree->getIndexWithinParent(constNode);
   auto node = const_cast<HTFileInfoTree::Node*>(constNode);
   return createIndex(row, 0, node);
 }
 
 // -----------------------------------------------------------------------------
-void HTFileInfoModel::setFileInfoTree(const HTFileInfoTree& tree)
+void HTFileInfoModel::setFileInfoTree(const HTFileInfoTree::ConstPointer& tree)
 {
   emit beginResetModel();
-  m_FileTree = tree;
+  m_FileTree = (nullptr != tree) ? tree : std::make_shared<const HTFileInfoTree>();
+  m_LazyTree.reset();
+  m_Connection = nullptr;
+  m_FetchStates.clear();
+  m_Generation++;
   emit endResetModel();
 }
 
+// -----------------------------------------------------------------------------
+void HTFileInfoModel::setSource(HTConnection* connection, const HTFilePath& source)
+{
+  emit beginResetModel();
+  m_LazyTree = std::make_shared<HTFileInfoTree>();
+  m_FileTree = m_LazyTree;
+  m_Connection = connection;
+  m_Source = source;
+  m_FetchStates.clear();
+  m_Generation++;
+  emit endResetModel();
+
+  if(nullptr != connection)
+  {
+    requestListing(&m_LazyTree->getRoot(), HTRequestScheduler::Priority::High, true);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoModel::requestListing(const HTFileInfoTree::Node* node, HTRequestScheduler::Priority priority, bool prefetch)
+{
+  m_FetchStates[node] = FetchState::Fetching;
+
+  HTFilePath folderPath = m_Source;
+  QString folderId;
+  if(node != &m_LazyTree->getRoot())
+  {
+    folderId = node->fileInfo.getId();
+    folderPath.setPath(node->fileInfo.getContent().path + node->fileInfo.getContent().pk + ",");
+  }
+
+  auto request = new HTFileInfoRequest(m_Connection, folderPath, true);
+  request->setRecursive(false);
+  request->setPageSize(k_PageSize);
+  request->setPriority(priority);
+
+  // The request emits from the network thread, so the model handles the listing in its own thread
+  size_t generation = m_Generation;
+  connect(request, &HTFileInfoRequest::pageReceived, this, [this, generation, folderId](const HTFilePath&, HTFileInfoTree::ConstPointer page) { onPageReceived(generation, folderId, page); });
+  connect(request, &HTFileInfoRequest::infoReceived, this, [this, generation, folderId, prefetch]() { onListingReceived(generation, folderId, prefetch); });
+  connect(request, &HTFileInfoRequest::requestFailed, this, [this, generation, folderId]() { onListingFailed(generation, folderId); });
+  connect(request, &HTFileInfoRequest::finished, request, &QObject::deleteLater);
+  connect(request, &HTFileInfoRequest::requestFailed, request, &QObject::deleteLater);
+
+  request->exec();
+}
+
+// -----------------------------------------------------------------------------
+const HTFileInfoTree::Node* HTFileInfoModel::findFolder(const QString& folderId) const
+{
+  if(nullptr == m_LazyTree)
+  {
+    return nullptr;
+  }
+  if(folderId.isEmpty())
+  {
+    return &m_LazyTree->getRoot();
+  }
+  return m_LazyTree->findNodeById(folderId);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoModel::onPageReceived(size_t generation, const QString& folderId, const HTFileInfoTree::ConstPointer& page)
+{
+  const HTFileInfoTree::Node* folder = findFolder(folderId);
+  if(generation != m_Generation || nullptr == folder)
+  {
+    return;
+  }
+
+  const HTFileInfoTree::Node& contents = page->getRoot();
+  if(contents.size() > 0)
+  {
+    // Items are inserted below the folder named by their path, which is the listed folder
+    int first = static_cast<int>(folder->size());
+    beginInsertRows(getIndex(folder), first, first + static_cast<int>(contents.size()) - 1);
+    for(const HTFileInfoTree::Node* child : contents.children)
+    {
+      m_LazyTree->insert(child->fileInfo);
+    }
+    endInsertRows();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoModel::onListingReceived(size_t generation, const QString& folderId, bool prefetch)
+{
+  const HTFileInfoTree::Node* folder = findFolder(folderId);
+  if(generation != m_Generation || nullptr == folder)
+  {
+    return;
+  }
+  m_FetchStates[folder] = FetchState::Fetched;
+  emit folderFetched(getIndex(folder));
+
+  // Folders one level down are listed ahead of time, behind anything the user asked for
+  if(prefetch)
+  {
+    for(const HTFileInfoTree::Node* child : folder->children)
+    {
+      if(child->fileInfo.isDir() && m_FetchStates.count(child) == 0)
+      {
+        requestListing(child, HTRequestScheduler::Priority::Low, false);
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoModel::onListingFailed(size_t generation, const QString& folderId)
+{
+  const HTFileInfoTree::Node* folder = findFolder(folderId);
+  if(generation != m_Generation || nullptr == folder)
+  {
+    return;
+  }
+
+  // Views ask again right away if the folder stays fetchable, so a failed folder is shown empty until the next sync
+  m_FetchStates[folder] = FetchState::Fetched;
+  QModelIndex folderIndex = getIndex(folder);
+  if(folderIndex.isValid())
+  {
+    emit dataChanged(folderIndex, folderIndex);
+  }
+}
+
+// -----------------------------------------------------------------------------
+QModelIndex HTFileInfoModel::getIndex(const HTFileInfoTree::Node* node) const
+{
+  if(nullptr == node || nullptr == node->parent)
+  {
+    return QModelIndex();
+  }
+  int row = static_cast<int>(m_FileTree->getIndexWithinParent(node));
+  return createIndex(row, 0, const_cast<HTFileInfoTree::Node*>(node));
+}
+
 // -----------------------------------------------------------------------------
 HTFileInfoModel::Mode HTFileInfoModel::getMode() const
 {
@@ -221,7 +366,50 @@ QModelIndex HTFileInfoModel::parent(const QModelIndex& index) const
     return QModelIndex();
   }
 
+  // Top-level items belong to the invisible root
   const HTFileInfoTree::Node* node = getNode(index);
-  size_t parentIndex = m_FileTree.getIndexWithinParent(node);
-  return createIndex(parentIndex, 0, node->parent);
+  return getIndex(m_FileTree->getParent(node));
+}
+
+// -----------------------------------------------------------------------------
+bool HTFileInfoModel::hasChildren(const QModelIndex& parent) const
+{
+  const HTFileInfoTree::Node* node = getNode(parent);
+  if(node->size() > 0)
+  {
+    return true;
+  }
+  if(nullptr == m_LazyTree || (parent.isValid() && !node->fileInfo.isDir()))
+  {
+    return false;
+  }
+
+  auto state = m_FetchStates.find(node);
+  return state == m_FetchStates.end() || state->second != FetchState::Fetched;
+}
+
+// -----------------------------------------------------------------------------
+bool HTFileInfoModel::canFetchMore(const QModelIndex& parent) const
+{
+  if(nullptr == m_LazyTree || m_Connection.isNull())
+  {
+    return false;
+  }
+
+  const HTFileInfoTree::Node* node = getNode(parent);
+  if(parent.isValid() && !node->fileInfo.isDir())
+  {
+    return false;
+  }
+  return m_FetchStates.count(node) == 0;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoModel::fetchMore(const QModelIndex& parent)
+{
+  if(!canFetchMore(parent))
+  {
+    return;
+  }
+  requestListing(getNode(parent), HTRequestScheduler::Priority::High, true);
 }
@@ -33,23 +33,35 @@
 
 #pragma once
 
+#include <map>
 #include <vector>
 
 #include <QtCore/QAbstractItemModel>
+#include <QtCore/QPointer>
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTRequestScheduler.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
 
+class HTConnection;
+
 /**
  * @class HTFileInfoModel HTFileInfoModel.h HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoModel.h
  * @brief The HTFileInfoModel class is derived from QAbstractItemModel to allow viewing
  * files and directories within HyperThought Groups, Projects, and User space.
+ *
+ * The model either shows a crawled HTFileInfoTree snapshot or lists a source on demand. In the
+ * on-demand mode only the folders a view expands are listed through fetchMore(), and the folders
+ * inside them are prefetched at low priority so that expanding them next does not wait on the network.
+ * Large folders are listed in pages of k_PageSize items, and each page is inserted as it arrives.
  */
 class HyperThoughtUtilities_EXPORT HTFileInfoModel : public QAbstractItemModel
 {
   Q_OBJECT
 
 public:
+  static constexpr int k_PageSize = 1000;
+
   enum class Mode
   {
     Normal,
@@ -106,9 +118,19 @@ public:
   /**
    * @brief Sets the HTFileInfoTree used as the basis for the model.
    * Resets the model, invalidating the current indices and updating all views using it.
+   * The model shares the snapshot instead of copying it. A null tree clears the model.
    * @param tree
    */
-  void setFileInfoTree(const HTFileInfoTree& tree);
+  void setFileInfoTree(const HTFileInfoTree::ConstPointer& tree);
+
+  /**
+   * @brief Lists the given source on demand instead of showing a snapshot.
+   * Resets the model and requests the listing of the source folder. Other folders are listed when
+   * a view expands them. Listings still in flight from a previous source are discarded.
+   * @param connection
+   * @param source
+   */
+  void setSource(HTConnection* connection, const HTFilePath& source);
 
   /**
    * @brief Returns the Mode.
@@ -174,7 +196,90 @@ public:
    */
   QModelIndex parent(const QModelIndex& index) const override;
 
+  /**
+   * @brief Returns true if the specified index has or may have children.
+   * Folders that have not been listed yet report true so that views offer to expand them.
+   * @param parent
+   * @return
+   */
+  bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+
+  /**
+   * @brief Returns true if the folder at the specified index has not been listed or requested yet.
+   * Always returns false for snapshots.
+   * @param parent
+   * @return
+   */
+  bool canFetchMore(const QModelIndex& parent) const override;
+
+  /**
+   * @brief Requests the listing of the folder at the specified index. Its contents are inserted
+   * when the listing arrives.
+   * @param parent
+   */
+  void fetchMore(const QModelIndex& parent) override;
+
+signals:
+  /**
+   * @brief This signal is emitted after the listing of a folder has been inserted into the model.
+   * @param parent
+   */
+  void folderFetched(const QModelIndex& parent);
+
 private:
+  enum class FetchState
+  {
+    Fetching,
+    Fetched
+  };
+
+  /**
+   * @brief Returns the QModelIndex for the given node. Returns an invalid index for the root.
+   * @param node
+   * @return
+   */
+  QModelIndex getIndex(const HTFileInfoTree::Node* node) const;
+
+  /**
+   * @brief Requests the listing of the folder at the given node.
+   * @param node
+   * @param priority
+   * @param prefetch True if the folders in the listing should be requested as well.
+   */
+  void requestListing(const HTFileInfoTree::Node* node, HTRequestScheduler::Priority priority, bool prefetch);
+
+  /**
+   * @brief Inserts one page of a folder listing below the folder's node.
+   * Pages for a previous source are ignored.
+   * @param generation
+   * @param folderId Empty for the source folder.
+   * @param page
+   */
+  void onPageReceived(size_t generation, const QString& folderId, const HTFileInfoTree::ConstPointer& page);
+
+  /**
+   * @brief Marks the folder as listed once its last page has been inserted and prefetches the folders in it.
+   * Listings for a previous source are ignored.
+   * @param generation
+   * @param folderId Empty for the source folder.
+   * @param prefetch
+   */
+  void onListingReceived(size_t generation, const QString& folderId, bool prefetch);
+
+  /**
+   * @brief Marks the folder as listed without contents so that a failed listing is not requested in a loop.
+   * @param generation
+   * @param folderId
+   */
+  void onListingFailed(size_t generation, const QString& folderId);
+
+  /**
+   * @brief Returns the node of the folder with the given ID in the on-demand tree.
+   * @param folderId
+   * @return
+   */
+  const HTFileInfoTree::Node* findFolder(const QString& folderId) const;
+
   /**
    * @brief Returns a const Node* for the HTFileInfoTree::Node at the specified index.
    * Returns nullptr if none are found.
@@ -191,6 +296,13 @@ private:
 
   // -----------------------------------------------------------------------------
   // Variables
-  HTFileInfoTree m_FileTree;
+  HTFileInfoTree::ConstPointer m_FileTree;
   Mode m_Mode = Mode::Normal;
+
+  // On-demand listing
+  HTFileInfoTree::Pointer m_LazyTree;
+  QPointer<HTConnection> m_Connection;
+  HTFilePath m_Source;
+  std::map<const HTFileInfoTree::Node*, FetchState> m_FetchStates;
+  size_t m_Generation = 0;
 };
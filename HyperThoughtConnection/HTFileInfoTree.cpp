@@ -33,21 +33,60 @@
 
 #include "HTFileInfoTree.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <new>
+
+namespace
+{
+/**
+ * @brief Returns the last non-empty fragment of the comma-separated path that ends before
+ * the given position and moves the position to the start of that fragment.
+ * Returns an empty reference once the start of the path has been reached.
+ * @param path
+ * @param end
+ * @return
+ */
+QStringRef PreviousFragment(const QString& path, int& end)
+{
+  while(end > 0 && path.at(end - 1) == QLatin1Char(','))
+  {
+    end--;
+  }
+  if(end <= 0)
+  {
+    return QStringRef();
+  }
+
+  const int start = path.lastIndexOf(QLatin1Char(','), end - 1) + 1;
+  QStringRef fragment = path.midRef(start, end - start);
+  end = start;
+  return fragment;
+}
+} // namespace
+
 // -----------------------------------------------------------------------------
 HTFileInfoTree::HTFileInfoTree()
 {
+  clear();
 }
 
 // -----------------------------------------------------------------------------
 HTFileInfoTree::HTFileInfoTree(const HTFileInfoTree& other)
-: m_Root(other.m_Root)
+: m_Arenas(other.m_Arenas)
+, m_Root(other.m_Root)
+, m_NodeIndex(other.m_NodeIndex)
 {
 }
 
 // -----------------------------------------------------------------------------
 HTFileInfoTree::HTFileInfoTree(HTFileInfoTree&& other)
-: m_Root(std::move(other.m_Root))
+: m_Arenas(std::move(other.m_Arenas))
+, m_Root(other.m_Root)
+, m_NodeIndex(std::move(other.m_NodeIndex))
 {
+  other.clear();
 }
 
 // -----------------------------------------------------------------------------
@@ -56,137 +95,411 @@ HTFileInfoTree::~HTFileInfoTree() = default;
 // -----------------------------------------------------------------------------
 void HTFileInfoTree::clear()
 {
-  // Delete root children
-  size_t size = m_Root.size();
-  for(size_t i = 0; i < size; i++)
-  {
-    delete m_Root[i];
-  }
-  m_Root.children.clear();
+  // Nodes are released in bulk once no copy holds their arenas
+  m_Arenas.clear();
+  m_NodeIndex.clear();
+  m_Root = arena().create();
+}
+
+// -----------------------------------------------------------------------------
+size_t HTFileInfoTree::size() const
+{
+  return m_NodeIndex.size();
 }
 
 // -----------------------------------------------------------------------------
 void HTFileInfoTree::insert(const std::vector<HTFileInfo>& items)
 {
+  m_NodeIndex.reserve(static_cast<int>(m_NodeIndex.size() + items.size()));
   for(const auto& item : items)
   {
     insert(item);
   }
+  compact();
 }
 
 // -----------------------------------------------------------------------------
 void HTFileInfoTree::insert(const HTFileInfo& info)
 {
-  QStringList pathFragments = info.getPathFragments();
-  Node* parentNode = findNode(pathFragments);
+  // The last path fragment is the parent's ID
+  const QString path = info.getPath();
+  int end = path.size();
+  const QStringRef parentId = PreviousFragment(path, end);
+
+  Node* parentNode = parentId.isEmpty() ? nullptr : findNodeById(parentId.toString());
   if(nullptr == parentNode)
   {
-    parentNode = &m_Root;
+    parentNode = m_Root;
   }
 
-  Node* newNode = new Node();
+  createChild(ownNode(parentNode), info);
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node* HTFileInfoTree::createChild(Node* parent, const HTFileInfo& info)
+{
+  Node* newNode = arena().create();
   newNode->fileInfo = info;
-  newNode->parent = parentNode;
-  parentNode->children.push_back(newNode);
+  newNode->parent = parent;
+  parent->children.push_back(newNode);
+  m_NodeIndex.insert(info.getId(), newNode);
+  return newNode;
 }
 
 // -----------------------------------------------------------------------------
-bool HTFileInfoTree::contains(const HTFilePath& path) const
+HTFileInfoTree::NodeArena& HTFileInfoTree::arena()
 {
-  return nullptr != findNode(path);
+  if(m_Arenas.empty() || m_Arenas.back().use_count() > 1)
+  {
+    // Nodes a copy can see are frozen, so changes go into a new arena
+    m_Arenas.push_back(std::make_shared<NodeArena>());
+  }
+  else
+  {
+    // Pairs with the release of the last copy's reference
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return *m_Arenas.back();
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfo HTFileInfoTree::find(const HTFilePath& path) const
+HTFileInfoTree::Node* HTFileInfoTree::ownNode(Node* node)
 {
-  const Node* node = findNode(path);
-  if(nullptr == node)
+  // A tree with a single private arena owns every node
+  NodeArena& ownArena = arena();
+  if(m_Arenas.size() == 1 || ownArena.owns(node))
   {
-    return HTFileInfo();
+    return node;
   }
-  return node->fileInfo;
+
+  // The copy keeps the children, which point at the shared version of the node until they change
+  Node* copy = ownArena.create();
+  copy->fileInfo = node->fileInfo;
+  copy->children = node->children;
+  if(node == m_Root)
+  {
+    m_Root = copy;
+    return copy;
+  }
+
+  Node* parent = ownNode(getParent(node));
+  std::replace(parent->children.begin(), parent->children.end(), node, copy);
+  copy->parent = parent;
+  m_NodeIndex.insert(copy->fileInfo.getId(), copy);
+  return copy;
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFileInfo& info)
+HTFileInfoTree::Node* HTFileInfoTree::moveNode(Node* node, Node* parent)
 {
-  QStringList pathFragments = info.getPathFragments();
-  return findNode(pathFragments);
+  Node* oldParent = ownNode(getParent(node));
+  std::vector<Node*>& oldSiblings = oldParent->children;
+  oldSiblings.erase(std::remove(oldSiblings.begin(), oldSiblings.end(), node), oldSiblings.end());
+
+  Node* moved = ownNode(node);
+  moved->parent = parent;
+  return moved;
 }
 
 // -----------------------------------------------------------------------------
-const HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFileInfo& info) const
+void HTFileInfoTree::compact()
 {
-  QStringList pathFragments = info.getPathFragments();
-  return findNode(pathFragments);
+  size_t allocated = 0;
+  for(const auto& nodeArena : m_Arenas)
+  {
+    allocated += nodeArena->size();
+  }
+  if(allocated <= 2 * size() + k_CompactSlack && m_Arenas.size() <= k_MaxArenas)
+  {
+    return;
+  }
+
+  // Copies made earlier keep the old arenas alive for as long as they need them
+  HTFileInfoTree compacted;
+  compacted.m_Root->fileInfo = m_Root->fileInfo;
+  compacted.m_NodeIndex.reserve(static_cast<int>(size()));
+  compacted.copyChildren(*m_Root, compacted.m_Root);
+  *this = std::move(compacted);
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFilePath& path)
+bool HTFileInfoTree::ChangeSet::isEmpty() const
 {
-  return findNode(&m_Root, path.getPathFragments(), 0);
+  return added.empty() && updated.empty() && removed.empty();
 }
 
 // -----------------------------------------------------------------------------
-const HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFilePath& path) const
+bool HTFileInfoTree::mergeFolder(const QString& folderId, const HTFileInfoTree& contents, ChangeSet& changes, bool recursive)
+{
+  Node* folder = folderId.isEmpty() ? m_Root : findNodeById(folderId);
+  if(nullptr == folder)
+  {
+    return false;
+  }
+
+  mergeChildren(*contents.m_Root, folder, changes, recursive);
+  compact();
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::mergeChildren(const Node& source, Node* target, ChangeSet& changes, bool recursive)
 {
-  return findNode(&m_Root, path.getPathFragments(), 0);
+  // Folders whose children are unchanged keep their nodes, which copies of the tree may share
+  const bool changed = !ChildrenMatch(source, *target, false);
+  QHash<QString, Node*> oldChildren;
+  if(changed)
+  {
+    target = ownNode(target);
+
+    // Items that moved here from another folder keep their node and cached subtree. They are
+    // moved first because taking them out of their folder may copy the target's children.
+    QHash<QString, Node*> movedChildren;
+    for(const Node* sourceChild : source.children)
+    {
+      const QString id = sourceChild->fileInfo.getId();
+      Node* child = findNodeById(id);
+      if(nullptr == child || getParent(child) == target)
+      {
+        continue;
+      }
+      child = findMovedNode(id, target);
+      if(nullptr != child)
+      {
+        movedChildren.insert(id, moveNode(child, target));
+      }
+    }
+
+    oldChildren.reserve(static_cast<int>(target->size()));
+    for(Node* child : target->children)
+    {
+      oldChildren.insert(child->fileInfo.getId(), child);
+    }
+
+    // Children are rebuilt in the order of the source, reusing the nodes that still exist
+    target->children.clear();
+    target->children.reserve(source.size());
+    for(const Node* sourceChild : source.children)
+    {
+      const QString id = sourceChild->fileInfo.getId();
+      Node* child = oldChildren.take(id);
+      if(nullptr == child)
+      {
+        child = movedChildren.value(id, nullptr);
+      }
+      if(nullptr == child)
+      {
+        child = createChild(target, sourceChild->fileInfo);
+        copyChildren(*sourceChild, child);
+        RecordAdded(child, changes);
+        continue;
+      }
+
+      if(!SameVersion(child->fileInfo, sourceChild->fileInfo))
+      {
+        child = ownNode(child);
+        child->fileInfo = sourceChild->fileInfo;
+        changes.updated.push_back(child->fileInfo);
+      }
+      target->children.push_back(child);
+    }
+  }
+
+  // Shallow listings do not include grandchildren, so the cached ones are kept
+  if(recursive)
+  {
+    for(const Node* sourceChild : source.children)
+    {
+      // Merging a sibling may have copied the child, so it is looked up again
+      Node* child = findNodeById(sourceChild->fileInfo.getId());
+      if(nullptr != child)
+      {
+        mergeChildren(*sourceChild, child, changes, recursive);
+      }
+    }
+  }
+
+  // Children that moved into a subfolder during this merge are no longer below the target
+  for(auto iter = oldChildren.cbegin(); iter != oldChildren.cend(); ++iter)
+  {
+    Node* removedChild = findNodeById(iter.key());
+    if(nullptr != removedChild && getParent(removedChild) == target)
+    {
+      removeFromIndex(removedChild, changes);
+    }
+  }
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node* HTFileInfoTree::findNode(const QStringList& pathFragments)
+HTFileInfoTree::Node* HTFileInfoTree::findMovedNode(const QString& id, const Node* target) const
 {
-  return findNode(&m_Root, pathFragments, 0);
+  Node* node = m_NodeIndex.value(id);
+  if(nullptr == node || nullptr == node->parent)
+  {
+    return nullptr;
+  }
+
+  // A stale folder cannot move below itself, so it is replaced instead
+  for(const Node* ancestor = target; nullptr != ancestor; ancestor = getParent(ancestor))
+  {
+    if(ancestor == node)
+    {
+      return nullptr;
+    }
+  }
+  return node;
 }
 
 // -----------------------------------------------------------------------------
-const HTFileInfoTree::Node* HTFileInfoTree::findNode(const QStringList& pathFragments) const
+bool HTFileInfoTree::SameVersion(const HTFileInfo& cached, const HTFileInfo& listed)
 {
-  return findNode(&m_Root, pathFragments, 0);
+  // A moved item keeps its modified date but not its path
+  return cached.getContent().modifiedDate == listed.getContent().modifiedDate && cached.getPath() == listed.getPath();
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node* HTFileInfoTree::findNode(Node* node, const QStringList& pathFragments, int index) const
-{  
-  const int size = pathFragments.size();
-  if(size == index)
+bool HTFileInfoTree::folderMatches(const QString& folderId, const HTFileInfoTree& contents, bool recursive) const
+{
+  const Node* folder = folderId.isEmpty() ? m_Root : findNodeById(folderId);
+  return nullptr != folder && ChildrenMatch(*contents.m_Root, *folder, recursive);
+}
+
+// -----------------------------------------------------------------------------
+bool HTFileInfoTree::ChildrenMatch(const Node& source, const Node& target, bool recursive)
+{
+  if(source.size() != target.size())
   {
-    // Path has reached its end
-    return node;
+    return false;
+  }
+
+  QHash<QString, const Node*> targetChildren;
+  targetChildren.reserve(static_cast<int>(target.size()));
+  for(const Node* child : target.children)
+  {
+    targetChildren.insert(child->fileInfo.getId(), child);
   }
 
-  // Search through children for the current path fragment
-  const QString fragment = pathFragments[index];
-  for(const auto& child : node->children)
+  for(const Node* sourceChild : source.children)
   {
-    if(fragment == child->fileInfo.getId())
+    const Node* child = targetChildren.value(sourceChild->fileInfo.getId(), nullptr);
+    if(nullptr == child || !SameVersion(child->fileInfo, sourceChild->fileInfo))
+    {
+      return false;
+    }
+    if(recursive && !ChildrenMatch(*sourceChild, *child, recursive))
     {
-      return findNode(child, pathFragments, index + 1);
+      return false;
     }
   }
-  return nullptr;
+  return true;
 }
 
 // -----------------------------------------------------------------------------
-const HTFileInfoTree::Node* HTFileInfoTree::findNode(const Node* node, const QStringList& pathFragments, int index) const
+void HTFileInfoTree::removeFromIndex(const Node* node, ChangeSet& changes)
 {
-  const int size = pathFragments.size();
-  if(size == index)
+  for(const Node* child : node->children)
   {
-    // Reached the end of the path
-    return node;
+    removeFromIndex(child, changes);
+  }
+  // An item that moved within the merged folder is already indexed at its new node
+  const QString id = node->fileInfo.getId();
+  if(m_NodeIndex.value(id) == node)
+  {
+    m_NodeIndex.remove(id);
+  }
+  changes.removed.push_back(node->fileInfo);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::RecordAdded(const Node* node, ChangeSet& changes)
+{
+  changes.added.push_back(node->fileInfo);
+  for(const Node* child : node->children)
+  {
+    RecordAdded(child, changes);
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool HTFileInfoTree::contains(const HTFilePath& path) const
+{
+  return nullptr != findNode(path);
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfo HTFileInfoTree::find(const HTFilePath& path) const
+{
+  const Node* node = findNode(path);
+  if(nullptr == node)
+  {
+    return HTFileInfo();
+  }
+  return node->fileInfo;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFileInfo& info)
+{
+  return findNodeById(info.getId());
+}
+
+// -----------------------------------------------------------------------------
+const HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFileInfo& info) const
+{
+  return findNodeById(info.getId());
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node* HTFileInfoTree::findNodeById(const QString& id)
+{
+  return m_NodeIndex.value(id);
+}
+
+// -----------------------------------------------------------------------------
+const HTFileInfoTree::Node* HTFileInfoTree::findNodeById(const QString& id) const
+{
+  return m_NodeIndex.value(id);
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFilePath& path)
+{
+  const HTFileInfoTree* constThis = this;
+  return const_cast<Node*>(constThis->findNode(path));
+}
+
+// -----------------------------------------------------------------------------
+const HTFileInfoTree::Node* HTFileInfoTree::findNode(const HTFilePath& path) const
+{
+  const QString pathStr = path.getPath();
+  int end = pathStr.size();
+
+  // An empty path refers to the root of the scope
+  const QStringRef id = PreviousFragment(pathStr, end);
+  if(id.isEmpty())
+  {
+    return m_Root;
+  }
+
+  const Node* node = findNodeById(id.toString());
+  if(nullptr == node)
+  {
+    return nullptr;
   }
 
-  // Search through children for the current path fragment
-  const QString fragment = pathFragments[index];
-  for(const auto& child : node->children)
+  // The remaining fragments must match the node's ancestors
+  for(const Node* ancestor = getParent(node); ancestor != m_Root; ancestor = getParent(ancestor))
   {
-    if(fragment == child->fileInfo.getId())
+    if(nullptr == ancestor || PreviousFragment(pathStr, end) != ancestor->fileInfo.getId())
     {
-      return findNode(child, pathFragments, index + 1);
+      return nullptr;
     }
   }
-  return nullptr;
+  if(!PreviousFragment(pathStr, end).isEmpty())
+  {
+    return nullptr;
+  }
+  return node;
 }
 
 // -----------------------------------------------------------------------------
@@ -196,14 +509,14 @@ size_t HTFileInfoTree::getIndexWithinParent(const Node* node) const
   {
     return -1;
   }
-  if(nullptr == node->parent)
+  const Node* parent = getParent(node);
+  if(nullptr == parent)
   {
     return -1;
   }
-  const Node* parent = node->parent;
   for(size_t i = 0; i < parent->size(); i++)
   {
-    if((*parent)[i]->fileInfo == node->fileInfo)
+    if((*parent)[i] == node)
     {
       return i;
     }
@@ -214,50 +527,99 @@ size_t HTFileInfoTree::getIndexWithinParent(const Node* node) const
 // -----------------------------------------------------------------------------
 const HTFileInfoTree::Node& HTFileInfoTree::getRoot() const
 {
-  return m_Root;
+  return *m_Root;
+}
+
+// -----------------------------------------------------------------------------
+const HTFileInfoTree::Node* HTFileInfoTree::getParent(const Node* node) const
+{
+  if(nullptr == node || nullptr == node->parent)
+  {
+    return nullptr;
+  }
+  // Shared nodes may point at an older version of their parent, which has the same ID
+  if(nullptr == node->parent->parent)
+  {
+    return m_Root;
+  }
+  return findNodeById(node->parent->fileInfo.getId());
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node* HTFileInfoTree::getParent(const Node* node)
+{
+  const HTFileInfoTree* constThis = this;
+  return const_cast<Node*>(constThis->getParent(node));
 }
 
 // -----------------------------------------------------------------------------
 void HTFileInfoTree::sort()
 {
-  m_Root.sortChildren();
+  sortChildren(m_Root);
+  compact();
 }
 
 // -----------------------------------------------------------------------------
 HTFileInfoTree& HTFileInfoTree::operator=(const HTFileInfoTree& other)
 {
-  QByteArray bArray;
-  QDataStream oStream(&bArray, QIODevice::WriteOnly);
-  oStream << other;
+  if(this == &other)
+  {
+    return *this;
+  }
 
-  QDataStream iStream(&bArray, QIODevice::ReadOnly);
-  iStream >> *this;
+  m_Arenas = other.m_Arenas;
+  m_Root = other.m_Root;
+  m_NodeIndex = other.m_NodeIndex;
   return *this;
 }
 
 // -----------------------------------------------------------------------------
 HTFileInfoTree& HTFileInfoTree::operator=(HTFileInfoTree&& other)
 {
-  m_Root = std::move(other.m_Root);
+  if(this == &other)
+  {
+    return *this;
+  }
+
+  m_Arenas = std::move(other.m_Arenas);
+  m_Root = other.m_Root;
+  m_NodeIndex = std::move(other.m_NodeIndex);
+  other.clear();
   return *this;
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node::Node() = default;
+void HTFileInfoTree::copyChildren(const Node& source, Node* target)
+{
+  target->children.reserve(source.size());
+  for(const Node* child : source.children)
+  {
+    Node* newChild = createChild(target, child->fileInfo);
+    copyChildren(*child, newChild);
+  }
+}
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node::Node(const Node& other)
-: fileInfo(other.fileInfo)
+void HTFileInfoTree::readNode(QDataStream& in, Node* node)
 {
-  children.reserve(other.size());
-  for(const Node* child : other.children)
+  in >> node->fileInfo;
+  uint64_t numChildren;
+  in >> numChildren;
+
+  node->children.resize(numChildren);
+  for(size_t i = 0; i < numChildren; i++)
   {
-    Node* newChild = new Node(*child);
-    newChild->parent = this;
-    children.push_back(newChild);
+    Node* childNode = arena().create();
+    node->children[i] = childNode;
+    childNode->parent = node;
+    readNode(in, childNode);
+    m_NodeIndex.insert(childNode->fileInfo.getId(), childNode);
   }
 }
 
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node::Node() = default;
+
 // -----------------------------------------------------------------------------
 HTFileInfoTree::Node::Node(Node&& other)
 : fileInfo(std::move(other.fileInfo))
@@ -267,13 +629,7 @@ HTFileInfoTree::Node::Node(Node&& other)
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node::~Node()
-{
-  for(auto child : children)
-  {
-    delete child;
-  }
-}
+HTFileInfoTree::Node::~Node() = default;
 
 // -----------------------------------------------------------------------------
 size_t HTFileInfoTree::Node::size() const
@@ -288,26 +644,211 @@ const HTFileInfoTree::Node* HTFileInfoTree::Node::operator[](int index) const
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node& HTFileInfoTree::Node::operator=(const Node& other)
+HTFileInfoTree::Node& HTFileInfoTree::Node::operator=(Node&& other)
+{
+  fileInfo = std::move(other.fileInfo);
+  children = std::move(other.children);
+  parent = std::move(other.parent);
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::NodeArena::NodeArena(NodeArena&& other)
+: m_Blocks(std::move(other.m_Blocks))
 {
-  fileInfo = other.fileInfo;
-  children.reserve(other.size());
-  for(const Node* child : other.children)
+  other.m_Blocks.clear();
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::NodeArena::~NodeArena()
+{
+  clear();
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::NodeArena& HTFileInfoTree::NodeArena::operator=(NodeArena&& other)
+{
+  if(this != &other)
   {
-    Node* newChild = new Node(*child);
-    newChild->parent = this;
-    children.push_back(newChild);
+    clear();
+    m_Blocks = std::move(other.m_Blocks);
+    other.m_Blocks.clear();
   }
   return *this;
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoTree::Node& HTFileInfoTree::Node::operator=(Node&& other)
+HTFileInfoTree::Node* HTFileInfoTree::NodeArena::create()
 {
-  fileInfo = std::move(other.fileInfo);
-  children = std::move(other.children);
-  parent = std::move(other.parent);
-  return *this;
+  if(m_Blocks.empty() || m_Blocks.back().used == m_Blocks.back().capacity)
+  {
+    // Double the block size until the maximum is reached
+    size_t capacity = m_Blocks.empty() ? k_FirstBlockSize : m_Blocks.back().capacity * 2;
+    if(capacity > k_MaxBlockSize)
+    {
+      capacity = k_MaxBlockSize;
+    }
+
+    Block block;
+    block.storage.reset(new NodeStorage[capacity]);
+    block.capacity = capacity;
+    m_Blocks.push_back(std::move(block));
+  }
+
+  Block& block = m_Blocks.back();
+  Node* node = new(&block.storage[block.used]) Node();
+  block.used++;
+  return node;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::NodeArena::clear()
+{
+  for(Block& block : m_Blocks)
+  {
+    Node* nodes = reinterpret_cast<Node*>(block.storage.get());
+    for(size_t i = 0; i < block.used; i++)
+    {
+      nodes[i].~Node();
+    }
+  }
+  m_Blocks.clear();
+}
+
+// -----------------------------------------------------------------------------
+size_t HTFileInfoTree::NodeArena::size() const
+{
+  size_t count = 0;
+  for(const Block& block : m_Blocks)
+  {
+    count += block.used;
+  }
+  return count;
+}
+
+// -----------------------------------------------------------------------------
+bool HTFileInfoTree::NodeArena::owns(const Node* node) const
+{
+  std::less<const Node*> less;
+  for(const Block& block : m_Blocks)
+  {
+    const Node* first = reinterpret_cast<const Node*>(block.storage.get());
+    if(!less(node, first) && less(node, first + block.used))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::Node* HTFileInfoTree::NodeIndex::value(const QString& id) const
+{
+  // A null entry among the changes marks an ID removed from the shared table
+  auto iter = m_Changes.constFind(id);
+  if(iter != m_Changes.constEnd())
+  {
+    return iter.value();
+  }
+  return m_Table->value(id, nullptr);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::NodeIndex::insert(const QString& id, Node* node)
+{
+  if(nullptr == value(id))
+  {
+    m_Size++;
+  }
+
+  Table* table = writableTable();
+  if(nullptr == table)
+  {
+    m_Changes.insert(id, node);
+    return;
+  }
+  table->insert(id, node);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::NodeIndex::remove(const QString& id)
+{
+  if(nullptr == value(id))
+  {
+    return;
+  }
+  m_Size--;
+
+  Table* table = writableTable();
+  if(nullptr == table)
+  {
+    if(m_Table->contains(id))
+    {
+      m_Changes.insert(id, nullptr);
+    }
+    else
+    {
+      m_Changes.remove(id);
+    }
+    return;
+  }
+  table->remove(id);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::NodeIndex::reserve(int size)
+{
+  if(m_Table.use_count() == 1)
+  {
+    m_Table->reserve(size);
+  }
+}
+
+// -----------------------------------------------------------------------------
+size_t HTFileInfoTree::NodeIndex::size() const
+{
+  return m_Size;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoTree::NodeIndex::clear()
+{
+  m_Table = std::make_shared<Table>();
+  m_Changes.clear();
+  m_Size = 0;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::NodeIndex::Table* HTFileInfoTree::NodeIndex::writableTable()
+{
+  if(m_Table.use_count() > 1)
+  {
+    if(m_Changes.size() < k_MaxChanges)
+    {
+      return nullptr;
+    }
+    // Every lookup checks the changes first, so they are folded into a private copy once they pile up
+    m_Table = std::make_shared<Table>(*m_Table);
+  }
+  else
+  {
+    // Pairs with the release of the last copy's reference
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+
+  for(auto iter = m_Changes.cbegin(); iter != m_Changes.cend(); ++iter)
+  {
+    if(nullptr == iter.value())
+    {
+      m_Table->remove(iter.key());
+    }
+    else
+    {
+      m_Table->insert(iter.key(), iter.value());
+    }
+  }
+  m_Changes.clear();
+  return m_Table.get();
 }
 
 // Sort nodes using a custom function object
@@ -329,16 +870,22 @@ struct NodeCompareLess {
 };
 
 // -----------------------------------------------------------------------------
-void HTFileInfoTree::Node::sortChildren()
+void HTFileInfoTree::sortChildren(Node* node)
 {
-  // Sort children's children
-  for(auto child : children)
+  // Folders that are already sorted keep their nodes, which copies of the tree may share
+  NodeCompareLess comp;
+  if(!std::is_sorted(node->children.begin(), node->children.end(), comp))
   {
-    child->sortChildren();
+    node = ownNode(node);
+    std::sort(node->children.begin(), node->children.end(), comp);
   }
 
-  NodeCompareLess comp;
-  std::sort(children.begin(), children.end(), comp);
+  // Sorting a child may copy this folder, so the children are taken before recursing
+  const std::vector<Node*> children = node->children;
+  for(Node* child : children)
+  {
+    sortChildren(child);
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -363,29 +910,10 @@ QDataStream& operator<<(QDataStream& out, const HTFileInfoTree& myObj)
   return out;
 }
 
-// -----------------------------------------------------------------------------
-QDataStream& operator>>(QDataStream& in, HTFileInfoTree::Node* node)
-{
-  in >> node->fileInfo;
-  uint64_t numChildren;
-  in >> numChildren;
-
-  node->children.resize(numChildren);
-  for(size_t i = 0; i < numChildren; i++)
-  {
-    HTFileInfoTree::Node* childNode = new HTFileInfoTree::Node();
-    node->children[i] = childNode;
-    childNode->parent = node;
-    in >> childNode;
-  }
-  return in;
-}
-
 // -----------------------------------------------------------------------------
 QDataStream& operator>>(QDataStream& in, HTFileInfoTree& myObj)
 {
-  const HTFileInfoTree::Node* constRoot = &myObj.getRoot();
-  HTFileInfoTree::Node* root = const_cast<HTFileInfoTree::Node*>(constRoot);
-  in >> root;
+  myObj.clear();
+  myObj.readNode(in, myObj.m_Root);
   return in;
 }
@@ -33,7 +33,12 @@
 
 #pragma once
 
+#include <memory>
+#include <type_traits>
+#include <vector>
+
 #include <QtCore/QDataStream>
+#include <QtCore/QHash>
 #include <QtCore/QMetaType>
 #include <QtCore/QString>
 
@@ -44,10 +49,27 @@
 /**
  * @class HTFileInfoTree HTFileInfoTree.h HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h
  * @brief The HTFileInfoTree stores HTFileInfo nodes in a tree structure based on file paths.
+ * Nodes are also indexed by their HyperThought ID so that lookups by ID or path do not
+ * need to search the tree.
+ *
+ * Nodes are allocated from block arenas, so building or clearing a large tree costs a handful of
+ * allocations instead of one per node. Copies of a tree share its nodes, arenas, and index. A tree
+ * changes a node in place only while no copy shares it. Otherwise the node and the folders above it
+ * are copied into the tree's own arena, so a merge copies the changed folders' ancestor chains
+ * instead of the whole tree and untouched subtrees stay shared with older copies. Replaced and
+ * removed nodes stay in the arenas until they outnumber the live ones, when the tree is compacted.
  */
 class HyperThoughtUtilities_EXPORT HTFileInfoTree
 {
 public:
+  using Pointer = std::shared_ptr<HTFileInfoTree>;
+  using ConstPointer = std::shared_ptr<const HTFileInfoTree>;
+
+  /**
+   * @brief Nodes do not own their children. Child nodes belong to the tree's arenas and are
+   * released when no tree holds the arenas anymore. A node shared between trees may point at an
+   * older version of its parent, so the parent should be looked up with HTFileInfoTree::getParent().
+   */
   struct Node
   {
     HTFileInfo fileInfo;
@@ -55,7 +77,7 @@ public:
     Node* parent = nullptr;
 
     Node();
-    Node(const Node& other);
+    Node(const Node& other) = delete;
     Node(Node&& other);
     ~Node();
 
@@ -70,24 +92,31 @@ public:
      */
     const Node* operator[](int index) const;
 
-    /**
-     * @brief Recursively sorts the children by name and isDirectory status.
-     */
-    void sortChildren();
+    Node& operator=(const Node& other) = delete;
 
     /**
-     * @brief Copy assignment
+     * @brief Move assignment
      * @param other
      * @return
      */
-    Node& operator=(const Node& other);
+    Node& operator=(Node&& other);
+  };
+
+  /**
+   * @brief The items a merge added, updated, or removed. Removed items are kept as tombstones
+   * so that anything holding their IDs can drop them.
+   */
+  struct ChangeSet
+  {
+    std::vector<HTFileInfo> added;
+    std::vector<HTFileInfo> updated;
+    std::vector<HTFileInfo> removed;
 
     /**
-     * @brief Mode assignment
-     * @param other
+     * @brief Returns true if the merge changed nothing. Returns false otherwise.
      * @return
      */
-    Node& operator=(Node&& other);
+    bool isEmpty() const;
   };
 
   HTFileInfoTree();
@@ -100,6 +129,12 @@ public:
    */
   void clear();
 
+  /**
+   * @brief Returns the number of nodes in the tree, not counting the root.
+   * @return
+   */
+  size_t size() const;
+
   /**
    * @brief Inserts a collection of HTFileInfo items into the tree.
    * @param items
@@ -112,6 +147,32 @@ public:
    */
   void insert(const HTFileInfo& info);
 
+  /**
+   * @brief Replaces everything below the folder with the given ID by the contents of the root of the
+   * given tree, such as a crawl of that folder. Items are matched by ID. New items are added, items
+   * whose modified date changed are updated, and items missing from the contents are removed.
+   * Unchanged items keep their nodes. An empty ID merges into the root.
+   * Returns false without changing anything if the folder is not in the tree.
+   * @param folderId
+   * @param contents
+   * @param changes Receives every added, updated, and removed item.
+   * @param recursive False if the contents only list the folder's direct children, such as a
+   * single page listing. Subfolders that are still listed then keep their cached contents.
+   * @return
+   */
+  bool mergeFolder(const QString& folderId, const HTFileInfoTree& contents, ChangeSet& changes, bool recursive = true);
+
+  /**
+   * @brief Returns true if the folder with the given ID holds the same items as the root of the given
+   * tree, so that merging them would change nothing. Returns false otherwise or if the folder is not
+   * in the tree. Items are compared by ID and modified date. An empty ID compares the root.
+   * @param folderId
+   * @param contents
+   * @param recursive False to only compare the folder's direct children.
+   * @return
+   */
+  bool folderMatches(const QString& folderId, const HTFileInfoTree& contents, bool recursive = true) const;
+
   /**
    * @brief Checks if the tree contains an object at the specified path.
    * @param path
@@ -129,6 +190,7 @@ public:
 
   /**
    * @brief Returns the node containing the given value.
+   * Nodes are matched by HyperThought ID.
    * @param info
    * @return
    */
@@ -136,11 +198,28 @@ public:
 
   /**
    * @brief Returns the node containing the given value.
+   * Nodes are matched by HyperThought ID.
    * @param info
    * @return
    */
   const Node* findNode(const HTFileInfo& info) const;
 
+  /**
+   * @brief Returns the node with the given HyperThought ID.
+   * Returns nullptr if nothing is found.
+   * @param id
+   * @return
+   */
+  Node* findNodeById(const QString& id);
+
+  /**
+   * @brief Returns the node with the given HyperThought ID.
+   * Returns nullptr if nothing is found.
+   * @param id
+   * @return
+   */
+  const Node* findNodeById(const QString& id) const;
+
   /**
    * @brief Returns the node for the given path.
    * Returns nullptr if nothing is found.
@@ -163,6 +242,22 @@ public:
    */
   const Node& getRoot() const;
 
+  /**
+   * @brief Returns the node's parent in this tree. Returns nullptr for the root or a node that is
+   * not in the tree.
+   * @param node
+   * @return
+   */
+  const Node* getParent(const Node* node) const;
+
+  /**
+   * @brief Returns the node's parent in this tree. Returns nullptr for the root or a node that is
+   * not in the tree.
+   * @param node
+   * @return
+   */
+  Node* getParent(const Node* node);
+
   /**
    * @brief Returns the index for looking up the given node within its parent.
    * Returns -1 if the node or its parent are null.
@@ -174,12 +269,12 @@ public:
 
   /**
    * @brief Sort the tree nodes. Directories are listed before files.
-   * Files and directories are sorted by filename.
+   * Files and directories are sorted by filename. Folders that are already sorted keep their nodes.
    */
   void sort();
 
   /**
-   * @brief Assignment operator
+   * @brief Assignment operator. The tree shares the other tree's nodes until either of them changes.
    * @param other
    * @return
    */
@@ -193,48 +288,254 @@ public:
   HTFileInfoTree& operator=(HTFileInfoTree&& other);
 
 private:
+  friend QDataStream& operator>>(QDataStream& in, HTFileInfoTree& myObj);
+
+  /**
+   * @class NodeArena
+   * @brief The NodeArena class allocates nodes in geometrically growing blocks and destroys
+   * them all at once. Individual nodes are never released.
+   */
+  class NodeArena
+  {
+  public:
+    NodeArena() = default;
+    NodeArena(NodeArena&& other);
+    ~NodeArena();
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+    NodeArena& operator=(NodeArena&& other);
+
+    /**
+     * @brief Constructs a default node in the arena and returns it.
+     * @return
+     */
+    Node* create();
+
+    /**
+     * @brief Destroys every node in the arena and releases its blocks.
+     */
+    void clear();
+
+    /**
+     * @brief Returns the number of nodes created in the arena.
+     * @return
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns true if the node was created in this arena. Returns false otherwise.
+     * @param node
+     * @return
+     */
+    bool owns(const Node* node) const;
+
+  private:
+    using NodeStorage = std::aligned_storage<sizeof(Node), alignof(Node)>::type;
+
+    struct Block
+    {
+      std::unique_ptr<NodeStorage[]> storage;
+      size_t capacity = 0;
+      size_t used = 0;
+    };
+
+    static constexpr size_t k_FirstBlockSize = 64;
+    static constexpr size_t k_MaxBlockSize = 16384;
+
+    std::vector<Block> m_Blocks;
+  };
+
   /**
-   * @brief Recursively traverses the tree for the Node specified by the given path.
-   * Returns nullptr if the Node could not be found.
-   * @param pathFragments
+   * @class NodeIndex
+   * @brief The NodeIndex class maps HyperThought IDs to nodes. Copies of an index share one table
+   * and keep their own changes on the side until there are enough of them to pay for copying it.
+   */
+  class NodeIndex
+  {
+  public:
+    /**
+     * @brief Returns the node with the given ID or nullptr if there is none.
+     * @param id
+     * @return
+     */
+    Node* value(const QString& id) const;
+
+    /**
+     * @brief Maps the ID to the node, replacing any node it was mapped to before.
+     * @param id
+     * @param node
+     */
+    void insert(const QString& id, Node* node);
+
+    /**
+     * @brief Removes the ID from the index.
+     * @param id
+     */
+    void remove(const QString& id);
+
+    /**
+     * @brief Reserves space for the given number of entries if the table is not shared.
+     * @param size
+     */
+    void reserve(int size);
+
+    /**
+     * @brief Returns the number of indexed IDs.
+     * @return
+     */
+    size_t size() const;
+
+    /**
+     * @brief Removes every entry.
+     */
+    void clear();
+
+  private:
+    using Table = QHash<QString, Node*>;
+
+    static constexpr int k_MaxChanges = 4096;
+
+    /**
+     * @brief Returns the table for changing it in place, or nullptr while it is shared and the
+     * changes are still few enough to keep on the side.
+     * @return
+     */
+    Table* writableTable();
+
+    std::shared_ptr<Table> m_Table = std::make_shared<Table>();
+    Table m_Changes;
+    size_t m_Size = 0;
+  };
+
+  using ArenaList = std::vector<std::shared_ptr<NodeArena>>;
+
+  static constexpr size_t k_MaxArenas = 256;
+  static constexpr size_t k_CompactSlack = 1024;
+
+  /**
+   * @brief Returns the arena new nodes are created in. A new arena is started if a copy of the
+   * tree shares the current one.
    * @return
    */
-  Node* findNode(const QStringList& pathFragments);
+  NodeArena& arena();
 
   /**
-   * @brief Recursively traverses the tree for the Node specified by the given path.
-   * Returns nullptr if the Node could not be found.
-   * @param pathFragments
+   * @brief Returns a version of the node that this tree may change in place. A node that a copy of
+   * the tree shares is copied into the tree's own arena together with the folders above it.
+   * @param node
    * @return
    */
-  const Node* findNode(const QStringList& pathFragments) const;
+  Node* ownNode(Node* node);
 
   /**
-   * @brief Recursively traverses the tree for the Node specified by the given path.
-   * Returns nullptr if the Node could not be found.
+   * @brief Moves the node from its current folder below the given parent, which this tree must own.
+   * Returns the moved version of the node.
    * @param node
-   * @param pathFragments
-   * @param index
+   * @param parent
    * @return
    */
-  Node* findNode(Node* node, const QStringList& pathFragments, int index) const;
+  Node* moveNode(Node* node, Node* parent);
 
   /**
-   * @brief Recursively traverses the tree for the Node specified by the given path.
-   * Returns nullptr if the Node could not be found.
+   * @brief Recursively sorts the node's children unless they already are.
    * @param node
-   * @param pathFragments
-   * @param index
+   */
+  void sortChildren(Node* node);
+
+  /**
+   * @brief Copies the live nodes into a single new arena once replaced and removed nodes
+   * outnumber them, or once the tree holds too many arenas.
+   */
+  void compact();
+
+  /**
+   * @brief Creates a node in the arena holding the given value and appends it to the parent.
+   * The new node is added to the ID index. The parent must be owned by this tree.
+   * @param parent
+   * @param info
+   * @return
+   */
+  Node* createChild(Node* parent, const HTFileInfo& info);
+
+  /**
+   * @brief Recursively copies the children of the source node into the target node.
+   * @param source
+   * @param target
+   */
+  void copyChildren(const Node& source, Node* target);
+
+  /**
+   * @brief Merges the children of the source node into the target node, recursing into
+   * subfolders if requested. Only folders whose children change are copied.
+   * @param source
+   * @param target
+   * @param changes
+   * @param recursive
+   */
+  void mergeChildren(const Node& source, Node* target, ChangeSet& changes, bool recursive);
+
+  /**
+   * @brief Returns the node of an item that is cached in another folder than the target, so that
+   * a merge can move it below the target. Returns nullptr if the item is not cached or the node is
+   * the target or one of its ancestors.
+   * @param id
+   * @param target
+   * @return
+   */
+  Node* findMovedNode(const QString& id, const Node* target) const;
+
+  /**
+   * @brief Returns true if the cached item has the same modified date and path as the listed one.
+   * Returns false otherwise.
+   * @param cached
+   * @param listed
    * @return
    */
-  const Node* findNode(const Node* node, const QStringList& pathFragments, int index) const;
+  static bool SameVersion(const HTFileInfo& cached, const HTFileInfo& listed);
+
+  /**
+   * @brief Checks if the target node has the same children as the source node, recursing into
+   * subfolders if requested.
+   * @param source
+   * @param target
+   * @param recursive
+   * @return
+   */
+  static bool ChildrenMatch(const Node& source, const Node& target, bool recursive);
+
+  /**
+   * @brief Recursively removes the node's descendants and the node itself from the ID index and
+   * records them as removed.
+   * @param node
+   * @param changes
+   */
+  void removeFromIndex(const Node* node, ChangeSet& changes);
+
+  /**
+   * @brief Recursively records the node and its descendants as added.
+   * @param node
+   * @param changes
+   */
+  static void RecordAdded(const Node* node, ChangeSet& changes);
+
+  /**
+   * @brief Recursively reads the node and its children from the stream.
+   * @param in
+   * @param node
+   */
+  void readNode(QDataStream& in, Node* node);
 
   // -----------------------------------------------------------------------------
   // Variables
-  Node m_Root;
+  ArenaList m_Arenas;
+  Node* m_Root = nullptr;
+  NodeIndex m_NodeIndex;
 };
 
 QDataStream& operator<<(QDataStream& out, const HTFileInfoTree& myObj);
 QDataStream& operator>>(QDataStream& in, HTFileInfoTree& myObj);
 
 Q_DECLARE_METATYPE(HTFileInfoTree)
+Q_DECLARE_METATYPE(HTFileInfoTree::ConstPointer)
+Q_DECLARE_METATYPE(HTFileInfoTree::ChangeSet)
@@ -0,0 +1,336 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "HTMetrics.h"
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QTextStream>
+
+namespace
+{
+const char* const k_OutcomeNames[] = {"success", "httpError", "networkError", "canceled"};
+
+/**
+ * @brief Raises the atomic to the given value if the value is larger.
+ * @param target
+ * @param value
+ */
+void StoreMax(std::atomic<qint64>& target, qint64 value)
+{
+  qint64 current = target.load(std::memory_order_relaxed);
+  while(value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+  {
+  }
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+HTMetrics::Histogram::Histogram()
+{
+  reset();
+}
+
+// -----------------------------------------------------------------------------
+void HTMetrics::Histogram::record(qint64 ms)
+{
+  ms = (ms > 0) ? ms : 0;
+
+  // Bucket i holds [2^(i-1), 2^i) with bucket 0 holding everything below 1 ms
+  size_t bucket = 0;
+  while(bucket + 1 < k_BucketCount && (qint64(1) << bucket) <= ms)
+  {
+    bucket++;
+  }
+
+  m_Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  m_Count.fetch_add(1, std::memory_order_relaxed);
+  m_Sum.fetch_add(ms, std::memory_order_relaxed);
+  StoreMax(m_Max, ms);
+}
+
+// -----------------------------------------------------------------------------
+quint64 HTMetrics::Histogram::getCount() const
+{
+  return m_Count.load(std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------------
+double HTMetrics::Histogram::getMean() const
+{
+  quint64 count = getCount();
+  return (count > 0) ? static_cast<double>(m_Sum.load(std::memory_order_relaxed)) / count : 0.0;
+}
+
+// -----------------------------------------------------------------------------
+qint64 HTMetrics::Histogram::getMax() const
+{
+  return m_Max.load(std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------------
+qint64 HTMetrics::Histogram::getPercentile(double percentile) const
+{
+  // Buckets are read one at a time while samples may still arrive, so the total is summed from them
+  std::array<quint64, k_BucketCount> buckets;
+  quint64 total = 0;
+  for(size_t i = 0; i < k_BucketCount; i++)
+  {
+    buckets[i] = m_Buckets[i].load(std::memory_order_relaxed);
+    total += buckets[i];
+  }
+  if(total == 0)
+  {
+    return 0;
+  }
+
+  quint64 rank = static_cast<quint64>(percentile * total);
+  rank = (rank < total) ? rank : total - 1;
+  quint64 seen = 0;
+  for(size_t i = 0; i < k_BucketCount; i++)
+  {
+    seen += buckets[i];
+    if(seen > rank)
+    {
+      qint64 upperBound = qint64(1) << i;
+      qint64 max = getMax();
+      return (upperBound < max) ? upperBound : max;
+    }
+  }
+  return getMax();
+}
+
+// -----------------------------------------------------------------------------
+void HTMetrics::Histogram::reset()
+{
+  for(std::atomic<quint64>& bucket : m_Buckets)
+  {
+    bucket = 0;
+  }
+  m_Count = 0;
+  m_Sum = 0;
+  m_Max = 0;
+}
+
+// -----------------------------------------------------------------------------
+QJsonObject HTMetrics::Histogram::toJson() const
+{
+  QJsonObject buckets;
+  for(size_t i = 0; i < k_BucketCount; i++)
+  {
+    quint64 count = m_Buckets[i].load(std::memory_order_relaxed);
+    if(count > 0)
+    {
+      QString bound = (i + 1 < k_BucketCount) ? QString::number(qint64(1) << i) : QString("inf");
+      buckets["lt_" + bound] = static_cast<qint64>(count);
+    }
+  }
+
+  QJsonObject json;
+  json["count"] = static_cast<qint64>(getCount());
+  json["mean"] = getMean();
+  json["p50"] = getPercentile(0.5);
+  json["p95"] = getPercentile(0.95);
+  json["p99"] = getPercentile(0.99);
+  json["max"] = getMax();
+  json["buckets"] = buckets;
+  return json;
+}
+
+// -----------------------------------------------------------------------------
+HTMetrics::EndpointMetrics::EndpointMetrics()
+{
+  for(std::atomic<quint64>& outcome : outcomes)
+  {
+    outcome = 0;
+  }
+  retries = 0;
+  bytesIn = 0;
+  bytesOut = 0;
+}
+
+// -----------------------------------------------------------------------------
+quint64 HTMetrics::EndpointMetrics::getRequestCount() const
+{
+  quint64 count = 0;
+  for(const std::atomic<quint64>& outcome : outcomes)
+  {
+    count += outcome.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+// -----------------------------------------------------------------------------
+HTMetrics::HTMetrics() = default;
+
+// -----------------------------------------------------------------------------
+HTMetrics::~HTMetrics() = default;
+
+// -----------------------------------------------------------------------------
+HTMetrics::EndpointMetrics& HTMetrics::getOrCreateEndpointMetrics(const QString& endpoint)
+{
+  QMutexLocker locker(&m_Mutex);
+  std::unique_ptr<EndpointMetrics>& metrics = m_Endpoints[endpoint];
+  if(nullptr == metrics)
+  {
+    metrics.reset(new EndpointMetrics());
+  }
+  return *metrics;
+}
+
+// -----------------------------------------------------------------------------
+void HTMetrics::record(const Sample& sample)
+{
+  Record(getOrCreateEndpointMetrics(sample.endpoint), sample);
+}
+
+// -----------------------------------------------------------------------------
+void HTMetrics::Record(EndpointMetrics& metrics, const Sample& sample)
+{
+  metrics.outcomes[static_cast<size_t>(sample.outcome)].fetch_add(1, std::memory_order_relaxed);
+  if(sample.willRetry)
+  {
+    metrics.retries.fetch_add(1, std::memory_order_relaxed);
+  }
+  metrics.bytesIn.fetch_add(sample.bytesIn, std::memory_order_relaxed);
+  metrics.bytesOut.fetch_add(sample.bytesOut, std::memory_order_relaxed);
+  metrics.queueWait.record(sample.queueWaitMs);
+  if(sample.firstByteMs >= 0)
+  {
+    metrics.firstByte.record(sample.firstByteMs);
+  }
+  metrics.latency.record(sample.totalMs);
+}
+
+// -----------------------------------------------------------------------------
+QStringList HTMetrics::getEndpoints() const
+{
+  QMutexLocker locker(&m_Mutex);
+  QStringList endpoints;
+  for(const auto& endpoint : m_Endpoints)
+  {
+    endpoints.push_back(endpoint.first);
+  }
+  return endpoints;
+}
+
+// -----------------------------------------------------------------------------
+const HTMetrics::EndpointMetrics* HTMetrics::getEndpointMetrics(const QString& endpoint) const
+{
+  QMutexLocker locker(&m_Mutex);
+  auto iter = m_Endpoints.find(endpoint);
+  return (iter != m_Endpoints.end()) ? iter->second.get() : nullptr;
+}
+
+// -----------------------------------------------------------------------------
+void HTMetrics::reset()
+{
+  // Endpoints stay in the table so that pointers handed out remain valid
+  QMutexLocker locker(&m_Mutex);
+  for(auto& endpoint : m_Endpoints)
+  {
+    EndpointMetrics& metrics = *endpoint.second;
+    for(std::atomic<quint64>& outcome : metrics.outcomes)
+    {
+      outcome = 0;
+    }
+    metrics.retries = 0;
+    metrics.bytesIn = 0;
+    metrics.bytesOut = 0;
+    metrics.queueWait.reset();
+    metrics.firstByte.reset();
+    metrics.latency.reset();
+  }
+}
+
+// -----------------------------------------------------------------------------
+QString HTMetrics::toText() const
+{
+  QString text;
+  QTextStream out(&text);
+  for(const QString& endpoint : getEndpoints())
+  {
+    const EndpointMetrics* metrics = getEndpointMetrics(endpoint);
+    out << endpoint << ": requests=" << metrics->getRequestCount();
+    for(size_t i = 1; i < k_OutcomeCount; i++)
+    {
+      out << " " << k_OutcomeNames[i] << "=" << metrics->outcomes[i].load();
+    }
+    out << " retries=" << metrics->retries.load() << " bytesIn=" << metrics->bytesIn.load() << " bytesOut=" << metrics->bytesOut.load();
+    out << " queue(p50/p95)=" << metrics->queueWait.getPercentile(0.5) << "/" << metrics->queueWait.getPercentile(0.95) << "ms";
+    out << " ttfb(p50/p95)=" << metrics->firstByte.getPercentile(0.5) << "/" << metrics->firstByte.getPercentile(0.95) << "ms";
+    out << " total(p50/p95/max)=" << metrics->latency.getPercentile(0.5) << "/" << metrics->latency.getPercentile(0.95) << "/" << metrics->latency.getMax() << "ms\n";
+  }
+  out.flush();
+  return text;
+}
+
+// -----------------------------------------------------------------------------
+QJsonObject HTMetrics::toJson() const
+{
+  QJsonObject json;
+  for(const QString& endpoint : getEndpoints())
+  {
+    const EndpointMetrics* metrics = getEndpointMetrics(endpoint);
+    QJsonObject endpointJson;
+    endpointJson["requests"] = static_cast<qint64>(metrics->getRequestCount());
+    for(size_t i = 0; i < k_OutcomeCount; i++)
+    {
+      endpointJson[k_OutcomeNames[i]] = static_cast<qint64>(metrics->outcomes[i].load());
+    }
+    endpointJson["retries"] = static_cast<qint64>(metrics->retries.load());
+    endpointJson["bytesIn"] = metrics->bytesIn.load();
+    endpointJson["bytesOut"] = metrics->bytesOut.load();
+    endpointJson["queueWaitMs"] = metrics->queueWait.toJson();
+    endpointJson["firstByteMs"] = metrics->firstByte.toJson();
+    endpointJson["latencyMs"] = metrics->latency.toJson();
+    json[endpoint] = endpointJson;
+  }
+  return json;
+}
+
+// -----------------------------------------------------------------------------
+QString HTMetrics::EndpointName(const QByteArray& verb, const QUrl& url)
+{
+  static const QRegularExpression digitExpr("\\d");
+  QStringList segments = url.path().split('/');
+  for(QString& segment : segments)
+  {
+    if(segment.contains(digitExpr))
+    {
+      segment = ":id";
+    }
+  }
+  return QString::fromLatin1(verb) + " " + segments.join('/');
+}
@@ -0,0 +1,255 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
+
+/**
+ * @class HTMetrics HTMetrics.h HyperThoughtUtilities/HyperThoughtConnection/HTMetrics.h
+ * @brief The HTMetrics class collects per-endpoint statistics for the requests sent by an
+ * HTRequestScheduler: outcomes, retries, bytes in and out, and histograms of the queue wait,
+ * time to first byte and total latency of every attempt.
+ *
+ * Counters and histogram buckets are atomics, so recording a sample never blocks readers. A mutex
+ * only guards the endpoint table when an endpoint is looked up or the table is read. Callers that
+ * record many samples for the same endpoint look it up once with getOrCreateEndpointMetrics() and
+ * record through the returned metrics without taking the mutex.
+ */
+class HyperThoughtUtilities_EXPORT HTMetrics
+{
+public:
+  enum class Outcome
+  {
+    Success = 0,
+    HttpError,
+    NetworkError,
+    Canceled
+  };
+
+  static constexpr size_t k_OutcomeCount = 4;
+
+  /**
+   * @brief Bucket i counts durations below 2^i milliseconds. The last bucket counts everything longer.
+   */
+  static constexpr size_t k_BucketCount = 20;
+
+  /**
+   * @brief The measurements of one attempt of a request. Durations are in milliseconds.
+   * A negative firstByteMs means no response header arrived.
+   */
+  struct Sample
+  {
+    QString endpoint;
+    Outcome outcome = Outcome::Success;
+    qint64 queueWaitMs = 0;
+    qint64 firstByteMs = -1;
+    qint64 totalMs = 0;
+    qint64 bytesIn = 0;
+    qint64 bytesOut = 0;
+    bool willRetry = false;
+  };
+
+  /**
+   * @class Histogram
+   * @brief The Histogram class counts durations in logarithmic buckets.
+   */
+  class HyperThoughtUtilities_EXPORT Histogram
+  {
+  public:
+    Histogram();
+
+    /**
+     * @brief Adds a duration in milliseconds.
+     * @param ms
+     */
+    void record(qint64 ms);
+
+    /**
+     * @brief Returns the number of recorded durations.
+     * @return
+     */
+    quint64 getCount() const;
+
+    /**
+     * @brief Returns the mean duration in milliseconds or 0 if nothing was recorded.
+     * @return
+     */
+    double getMean() const;
+
+    /**
+     * @brief Returns the longest recorded duration in milliseconds.
+     * @return
+     */
+    qint64 getMax() const;
+
+    /**
+     * @brief Returns an upper bound in milliseconds for the given percentile between 0 and 1.
+     * The bound is the end of the bucket the percentile falls in, capped at getMax().
+     * @param percentile
+     * @return
+     */
+    qint64 getPercentile(double percentile) const;
+
+    /**
+     * @brief Sets every bucket back to zero.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the count, mean, max, percentiles and non-empty buckets as JSON.
+     * @return
+     */
+    QJsonObject toJson() const;
+
+  private:
+    std::array<std::atomic<quint64>, k_BucketCount> m_Buckets;
+    std::atomic<quint64> m_Count;
+    std::atomic<qint64> m_Sum;
+    std::atomic<qint64> m_Max;
+  };
+
+  /**
+   * @brief The counters and histograms of one endpoint.
+   */
+  struct EndpointMetrics
+  {
+    EndpointMetrics();
+
+    std::array<std::atomic<quint64>, k_OutcomeCount> outcomes;
+    std::atomic<quint64> retries;
+    std::atomic<qint64> bytesIn;
+    std::atomic<qint64> bytesOut;
+    Histogram queueWait;
+    Histogram firstByte;
+    Histogram latency;
+
+    /**
+     * @brief Returns the number of recorded attempts.
+     * @return
+     */
+    quint64 getRequestCount() const;
+  };
+
+  HTMetrics();
+  virtual ~HTMetrics();
+
+  HTMetrics(const HTMetrics&) = delete;            // Copy Constructor Not Implemented
+  HTMetrics(HTMetrics&&) = delete;                 // Move Constructor Not Implemented
+  HTMetrics& operator=(const HTMetrics&) = delete; // Copy Assignment Not Implemented
+  HTMetrics& operator=(HTMetrics&&) = delete;      // Move Assignment Not Implemented
+
+  /**
+   * @brief Records one attempt of a request under the sample's endpoint.
+   * This method is thread-safe. It locks the endpoint table to look up the endpoint.
+   * @param sample
+   */
+  void record(const Sample& sample);
+
+  /**
+   * @brief Records one attempt of a request in the given endpoint's metrics. The sample's endpoint
+   * name is ignored.
+   * This method is thread-safe and lock-free.
+   * @param metrics Metrics returned by getOrCreateEndpointMetrics().
+   * @param sample
+   */
+  static void Record(EndpointMetrics& metrics, const Sample& sample);
+
+  /**
+   * @brief Returns the metrics of the given endpoint, creating them the first time.
+   * The returned object stays valid for the lifetime of this HTMetrics.
+   * This method is thread-safe. It locks the endpoint table.
+   * @param endpoint
+   * @return
+   */
+  EndpointMetrics& getOrCreateEndpointMetrics(const QString& endpoint);
+
+  /**
+   * @brief Returns the names of every endpoint with recorded samples.
+   * This method is thread-safe.
+   * @return
+   */
+  QStringList getEndpoints() const;
+
+  /**
+   * @brief Returns the metrics of the given endpoint or nullptr if nothing was recorded for it.
+   * The returned object stays valid for the lifetime of this HTMetrics.
+   * This method is thread-safe.
+   * @param endpoint
+   * @return
+   */
+  const EndpointMetrics* getEndpointMetrics(const QString& endpoint) const;
+
+  /**
+   * @brief Sets every counter and histogram back to zero.
+   * This method is thread-safe.
+   */
+  void reset();
+
+  /**
+   * @brief Returns one line per endpoint with its counters and latency percentiles.
+   * @return
+   */
+  QString toText() const;
+
+  /**
+   * @brief Returns every endpoint's counters and histograms as JSON.
+   * @return
+   */
+  QJsonObject toJson() const;
+
+  /**
+   * @brief Returns the endpoint name for a request: the HTTP verb followed by the URL path.
+   * Path segments that contain digits, such as IDs in upload URLs, are replaced by ":id"
+   * so that they do not create an endpoint per request.
+   * @param verb
+   * @param url
+   * @return
+   */
+  static QString EndpointName(const QByteArray& verb, const QUrl& url);
+
+private:
+  mutable QMutex m_Mutex;
+  std::map<QString, std::unique_ptr<EndpointMetrics>> m_Endpoints;
+};
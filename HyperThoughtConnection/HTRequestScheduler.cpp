@@ -0,0 +1,887 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "HTRequestScheduler.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtNetwork/QNetworkAccessManager>
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTBufferedReply.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
+
+namespace
+{
+/**
+ * @brief Returns the HTTP verb the reply was sent with.
+ * @param reply
+ * @return
+ */
+QByteArray OperationVerb(const QNetworkReply* reply)
+{
+  switch(reply->operation())
+  {
+  case QNetworkAccessManager::HeadOperation:
+    return "HEAD";
+  case QNetworkAccessManager::GetOperation:
+    return "GET";
+  case QNetworkAccessManager::PutOperation:
+    return "PUT";
+  case QNetworkAccessManager::PostOperation:
+    return "POST";
+  case QNetworkAccessManager::DeleteOperation:
+    return "DELETE";
+  case QNetworkAccessManager::CustomOperation:
+    return reply->request().attribute(QNetworkRequest::CustomVerbAttribute).toByteArray();
+  default:
+    return "UNKNOWN";
+  }
+}
+
+/**
+ * @brief Returns true if sending a request with the given method twice has the same effect as sending it once.
+ * @param verb
+ * @return
+ */
+bool IsIdempotent(const QByteArray& verb)
+{
+  return verb == "GET" || verb == "HEAD" || verb == "PUT" || verb == "DELETE" || verb == "OPTIONS";
+}
+
+/**
+ * @brief Returns the milliseconds between the two time points.
+ * @param begin
+ * @param end
+ * @return
+ */
+qint64 ElapsedMs(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+}
+
+/**
+ * @brief Returns the trace track for a slot in the given lane. Lane tracks are numbered apart from
+ * the thread tracks used by HTTraceSpan.
+ * @param lane
+ * @param slot
+ * @return
+ */
+quint64 GetTraceTrack(HTRequestScheduler::Lane lane, int slot)
+{
+  return 1000000 + 1000 * static_cast<quint64>(lane) + static_cast<quint64>(slot);
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::ContextGuard::ContextGuard()
+: m_Mutex(QMutex::Recursive)
+, m_Alive(true)
+, m_Name("")
+{
+}
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::ContextGuard::~ContextGuard() = default;
+
+// -----------------------------------------------------------------------------
+bool HTRequestScheduler::ContextGuard::isAlive() const
+{
+  return m_Alive.load(std::memory_order_acquire);
+}
+
+// -----------------------------------------------------------------------------
+const char* HTRequestScheduler::ContextGuard::getName() const
+{
+  return m_Name.load(std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::ContextGuard::setName(const char* name)
+{
+  m_Name.store(name, std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestScheduler::ContextGuard::lock()
+{
+  m_Mutex.lock();
+  if(!m_Alive.load(std::memory_order_relaxed))
+  {
+    m_Mutex.unlock();
+    return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::ContextGuard::unlock()
+{
+  m_Mutex.unlock();
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::ContextGuard::release()
+{
+  QMutexLocker locker(&m_Mutex);
+  m_Alive.store(false, std::memory_order_release);
+}
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::ContextLocker::ContextLocker(ContextGuard& guard)
+: m_Guard(guard)
+, m_Locked(guard.lock())
+{
+}
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::ContextLocker::~ContextLocker()
+{
+  if(m_Locked)
+  {
+    m_Guard.unlock();
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestScheduler::ContextLocker::isLocked() const
+{
+  return m_Locked;
+}
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::HTRequestScheduler(QObject* parent)
+: QObject(parent)
+, m_Submissions(nullptr)
+, m_BreakerState(BreakerState::Closed)
+, m_BreakerCooldownMs(k_BreakerCooldownMs)
+{
+  for(LaneState& lane : m_Lanes)
+  {
+    lane.active = 0;
+    lane.queued = 0;
+  }
+  getLane(Lane::MetaData).maxActive = k_DefaultMetaDataLimit;
+  getLane(Lane::Transfer).maxActive = k_DefaultTransferLimit;
+}
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::~HTRequestScheduler()
+{
+  Submission* submission = m_Submissions.exchange(nullptr);
+  while(nullptr != submission)
+  {
+    Submission* next = submission->next;
+    delete submission;
+    submission = next;
+  }
+}
+
+// -----------------------------------------------------------------------------
+HTRequestScheduler::LaneState& HTRequestScheduler::getLane(Lane lane)
+{
+  return m_Lanes[static_cast<size_t>(lane)];
+}
+
+// -----------------------------------------------------------------------------
+const HTRequestScheduler::LaneState& HTRequestScheduler::getLane(Lane lane) const
+{
+  return m_Lanes[static_cast<size_t>(lane)];
+}
+
+// -----------------------------------------------------------------------------
+size_t HTRequestScheduler::getMaxActive(Lane lane) const
+{
+  return getLane(lane).maxActive;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::setMaxActive(Lane lane, size_t count)
+{
+  getLane(lane).maxActive = (count > 0) ? count : 1;
+
+  // A larger limit may allow queued jobs to start
+  QMetaObject::invokeMethod(this, [this, lane]() { startJobs(lane); }, Qt::QueuedConnection);
+}
+
+// -----------------------------------------------------------------------------
+size_t HTRequestScheduler::getActiveCount(Lane lane) const
+{
+  return getLane(lane).active;
+}
+
+// -----------------------------------------------------------------------------
+size_t HTRequestScheduler::getQueuedCount(Lane lane) const
+{
+  return getLane(lane).queued;
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestScheduler::isCircuitOpen() const
+{
+  return m_BreakerState != BreakerState::Closed;
+}
+
+// -----------------------------------------------------------------------------
+int HTRequestScheduler::getBreakerCooldown() const
+{
+  return m_BreakerCooldownMs;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::setBreakerCooldown(int cooldownMs)
+{
+  m_BreakerCooldownMs = (cooldownMs > 0) ? cooldownMs : 0;
+}
+
+// -----------------------------------------------------------------------------
+HTMetrics& HTRequestScheduler::getMetrics()
+{
+  return m_Metrics;
+}
+
+// -----------------------------------------------------------------------------
+const HTMetrics& HTRequestScheduler::getMetrics() const
+{
+  return m_Metrics;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::submit(Lane lane, Priority priority, const ContextPointer& context, SendFunction send, FinishedCallback onFinished)
+{
+  submit(lane, priority, RetryPolicy(), context, std::move(send), std::move(onFinished));
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::submit(Lane lane, Priority priority, const RetryPolicy& policy, const ContextPointer& context, SendFunction send, FinishedCallback onFinished)
+{
+  submitShared(lane, priority, policy, QByteArray(), context, std::move(send), std::move(onFinished));
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::submitShared(Lane lane, Priority priority, const RetryPolicy& policy, const QByteArray& shareKey, const ContextPointer& context, SendFunction send,
+                                      FinishedCallback onFinished)
+{
+  Submission* submission = new Submission();
+  submission->job.lane = lane;
+  submission->job.priority = priority;
+  submission->job.policy = policy;
+  submission->job.shareKey = shareKey;
+  submission->job.queuedAt = std::chrono::steady_clock::now();
+  submission->job.context = context;
+  submission->job.contextClass = context->getName();
+  submission->job.send = std::move(send);
+  submission->job.onFinished = std::move(onFinished);
+
+  // Lock-free push. Only the submission that finds the list empty schedules a drain.
+  Submission* head = m_Submissions.load(std::memory_order_relaxed);
+  do
+  {
+    submission->next = head;
+  } while(!m_Submissions.compare_exchange_weak(head, submission, std::memory_order_release, std::memory_order_relaxed));
+
+  if(nullptr == head)
+  {
+    QMetaObject::invokeMethod(this, [this]() { drainSubmissions(); }, Qt::QueuedConnection);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::post(const ContextPointer& context, std::function<void()> function)
+{
+  QMetaObject::invokeMethod(
+      this,
+      [context, function]() {
+        ContextLocker locker(*context);
+        if(locker.isLocked())
+        {
+          function();
+        }
+      },
+      Qt::QueuedConnection);
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::cancel(const ContextPointer& context)
+{
+  if(QThread::currentThread() != thread())
+  {
+    QMetaObject::invokeMethod(this, [this, context]() { cancel(context); }, Qt::QueuedConnection);
+    return;
+  }
+
+  // Pending submissions join their lanes first so they can be removed with the rest
+  takeSubmissions();
+  for(auto& waitingJobs : m_WaitingJobs)
+  {
+    std::deque<Job>& jobs = waitingJobs.second;
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [context](const Job& job) { return job.context == context; }), jobs.end());
+  }
+
+  // Requests waiting on a canceled shared job are sent on their own
+  std::vector<QByteArray> shareKeys;
+  for(LaneState& lane : m_Lanes)
+  {
+    for(std::deque<Job>& queue : lane.queues)
+    {
+      auto removed = std::stable_partition(queue.begin(), queue.end(), [context](const Job& job) { return job.context != context; });
+      for(auto iter = removed; iter != queue.end(); ++iter)
+      {
+        shareKeys.push_back(iter->shareKey);
+      }
+      lane.queued -= static_cast<size_t>(std::distance(removed, queue.end()));
+      queue.erase(removed, queue.end());
+    }
+  }
+
+  for(auto iter = m_RetryJobs.begin(); iter != m_RetryJobs.end();)
+  {
+    if((*iter)->context == context)
+    {
+      shareKeys.push_back((*iter)->shareKey);
+      iter = m_RetryJobs.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+
+  // Aborting finishes the reply immediately, so collect the replies before touching them
+  std::vector<QNetworkReply*> replies;
+  for(const auto& activeJob : m_ActiveJobs)
+  {
+    if(activeJob.second->context == context && !activeJob.second->canceled)
+    {
+      activeJob.second->canceled = true;
+      shareKeys.push_back(activeJob.second->shareKey);
+      replies.push_back(activeJob.first);
+    }
+  }
+
+  for(const QByteArray& shareKey : shareKeys)
+  {
+    promoteWaitingJob(shareKey);
+  }
+  for(QNetworkReply* reply : replies)
+  {
+    reply->abort();
+  }
+
+  startJobs(Lane::MetaData);
+  startJobs(Lane::Transfer);
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::drainSubmissions()
+{
+  takeSubmissions();
+
+  startJobs(Lane::MetaData);
+  startJobs(Lane::Transfer);
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::takeSubmissions()
+{
+  // The list is newest first. Reverse it to keep submission order.
+  Submission* submission = m_Submissions.exchange(nullptr, std::memory_order_acquire);
+  std::vector<Submission*> submissions;
+  while(nullptr != submission)
+  {
+    submissions.push_back(submission);
+    submission = submission->next;
+  }
+
+  for(auto iter = submissions.rbegin(); iter != submissions.rend(); ++iter)
+  {
+    Job& job = (*iter)->job;
+    if(!job.shareKey.isEmpty())
+    {
+      // A request with the same key is already queued or in flight, so wait for its reply
+      auto waitingJobs = m_WaitingJobs.find(job.shareKey);
+      if(waitingJobs != m_WaitingJobs.end())
+      {
+        waitingJobs->second.push_back(std::move(job));
+        delete *iter;
+        continue;
+      }
+      m_WaitingJobs[job.shareKey];
+    }
+
+    LaneState& lane = getLane(job.lane);
+    lane.queues[static_cast<size_t>(job.priority)].push_back(std::move(job));
+    lane.queued++;
+    delete *iter;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::startJobs(Lane laneId)
+{
+  LaneState& lane = getLane(laneId);
+  bool isProbe = false;
+  while(lane.active < lane.maxActive && lane.queued > 0 && canStartJob(isProbe))
+  {
+    // Highest priority first
+    for(auto queue = lane.queues.rbegin(); queue != lane.queues.rend(); ++queue)
+    {
+      if(!queue->empty())
+      {
+        Job job = std::move(queue->front());
+        queue->pop_front();
+        lane.queued--;
+        startJob(std::move(job), isProbe);
+        break;
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::startJob(Job job, bool isProbe)
+{
+  // Requests whose owner is gone are dropped
+  QNetworkReply* reply = nullptr;
+  {
+    ContextLocker locker(*job.context);
+    if(locker.isLocked())
+    {
+      reply = job.send();
+    }
+  }
+  if(nullptr == reply)
+  {
+    promoteWaitingJob(job.shareKey);
+    return;
+  }
+
+  getLane(job.lane).active++;
+  m_ProbeActive = m_ProbeActive || isProbe;
+
+  job.startedAt = std::chrono::steady_clock::now();
+  job.firstByteMs = -1;
+  job.bytesIn = 0;
+  job.bytesOut = 0;
+
+  // The endpoint is only looked up once per job, so recording its attempts does not lock the metrics
+  if(nullptr == job.metrics)
+  {
+    job.endpoint = HTMetrics::EndpointName(OperationVerb(reply), reply->url());
+    job.metrics = &m_Metrics.getOrCreateEndpointMetrics(job.endpoint);
+  }
+  beginTrace(job, reply);
+
+  std::shared_ptr<Job> sharedJob = std::make_shared<Job>(std::move(job));
+  m_ActiveJobs[reply] = sharedJob;
+  connect(reply, &QNetworkReply::finished, this, [this, sharedJob, reply, isProbe]() { onJobFinished(sharedJob, reply, isProbe); });
+
+  // Progress is reported as running totals
+  Job* metricsJob = sharedJob.get();
+  connect(reply, &QNetworkReply::metaDataChanged, this, [metricsJob]() {
+    if(metricsJob->firstByteMs < 0)
+    {
+      metricsJob->firstByteMs = ElapsedMs(metricsJob->startedAt, std::chrono::steady_clock::now());
+    }
+  });
+  connect(reply, &QNetworkReply::downloadProgress, this, [metricsJob](qint64 bytesReceived, qint64) { metricsJob->bytesIn = bytesReceived; });
+  connect(reply, &QNetworkReply::uploadProgress, this, [metricsJob](qint64 bytesSent, qint64) { metricsJob->bytesOut = bytesSent; });
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::onJobFinished(const std::shared_ptr<Job>& job, QNetworkReply* reply, bool isProbe)
+{
+  getLane(job->lane).active--;
+  m_ActiveJobs.erase(reply);
+  reply->deleteLater();
+
+  // Canceled requests do not count against the breaker and never reach their callback.
+  // A canceled probe frees its slot so the next request can probe instead.
+  if(job->canceled)
+  {
+    if(isProbe)
+    {
+      m_ProbeActive = false;
+    }
+    recordMetrics(*job, reply, false);
+    startJobs(Lane::MetaData);
+    startJobs(Lane::Transfer);
+    return;
+  }
+
+  bool transientFailure = IsTransientFailure(reply, job->policy);
+  recordOutcome(transientFailure, isProbe);
+
+  bool willRetry = transientFailure && job->attempt + 1 < job->policy.maxAttempts && job->context->isAlive();
+  recordMetrics(*job, reply, willRetry);
+
+  if(willRetry)
+  {
+    // The callback only sees the final attempt
+    job->attempt++;
+    int delay = getRetryDelay(*job, reply);
+    m_RetryJobs.insert(job);
+    QTimer::singleShot(delay, this, [this, job]() {
+      // Canceled while waiting for the retry
+      if(m_RetryJobs.erase(job) == 0)
+      {
+        return;
+      }
+      job->queuedAt = std::chrono::steady_clock::now();
+      Lane laneId = job->lane;
+      LaneState& lane = getLane(laneId);
+      lane.queues[static_cast<size_t>(job->priority)].push_back(std::move(*job));
+      lane.queued++;
+      startJobs(laneId);
+    });
+  }
+  else if(transientFailure && !job->context->isAlive())
+  {
+    // Requests that were waiting on the dropped job get an attempt of their own
+    promoteWaitingJob(job->shareKey);
+  }
+  else
+  {
+    deliverReply(*job, reply);
+  }
+
+  startJobs(Lane::MetaData);
+  startJobs(Lane::Transfer);
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::beginTrace(Job& job, const QNetworkReply* reply)
+{
+  job.traceSlot = -1;
+  if(!HTTrace::IsEnabled())
+  {
+    return;
+  }
+
+  LaneState& lane = getLane(job.lane);
+  auto freeSlot = std::find(lane.traceSlots.begin(), lane.traceSlots.end(), false);
+  job.traceSlot = static_cast<int>(std::distance(lane.traceSlots.begin(), freeSlot));
+  if(freeSlot == lane.traceSlots.end())
+  {
+    lane.traceSlots.push_back(true);
+    QString laneName = (job.lane == Lane::MetaData) ? "MetaData" : "Transfer";
+    HTTrace::SetTrackName(GetTraceTrack(job.lane, job.traceSlot), QString("%1 %2").arg(laneName).arg(job.traceSlot));
+  }
+  else
+  {
+    *freeSlot = true;
+  }
+
+  HTTrace::AddAsyncSpan("queue", job.endpoint, reinterpret_cast<quintptr>(reply), job.queuedAt, job.startedAt);
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::recordMetrics(Job& job, const QNetworkReply* reply, bool willRetry)
+{
+  HTMetrics::Sample sample;
+  sample.queueWaitMs = ElapsedMs(job.queuedAt, job.startedAt);
+  sample.firstByteMs = job.firstByteMs;
+  sample.totalMs = ElapsedMs(job.startedAt, std::chrono::steady_clock::now());
+  sample.bytesIn = job.bytesIn;
+  sample.bytesOut = job.bytesOut;
+  sample.willRetry = willRetry;
+
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if(job.canceled || reply->error() == QNetworkReply::OperationCanceledError)
+  {
+    sample.outcome = HTMetrics::Outcome::Canceled;
+  }
+  else if(statusCode >= 400)
+  {
+    sample.outcome = HTMetrics::Outcome::HttpError;
+  }
+  else if(reply->error() != QNetworkReply::NoError)
+  {
+    sample.outcome = HTMetrics::Outcome::NetworkError;
+  }
+  else
+  {
+    sample.outcome = HTMetrics::Outcome::Success;
+  }
+
+  HTMetrics::Record(*job.metrics, sample);
+
+  if(job.traceSlot >= 0)
+  {
+    const char* const outcomeNames[] = {"success", "httpError", "networkError", "canceled"};
+    QJsonObject args;
+    args["request"] = job.contextClass;
+    args["attempt"] = job.attempt + 1;
+    args["status"] = statusCode;
+    args["outcome"] = outcomeNames[static_cast<size_t>(sample.outcome)];
+    args["bytesIn"] = sample.bytesIn;
+    args["bytesOut"] = sample.bytesOut;
+    HTTrace::AddSpan("network", job.endpoint, GetTraceTrack(job.lane, job.traceSlot), job.startedAt, std::chrono::steady_clock::now(), args);
+
+    std::vector<bool>& traceSlots = getLane(job.lane).traceSlots;
+    if(static_cast<size_t>(job.traceSlot) < traceSlots.size())
+    {
+      traceSlots[job.traceSlot] = false;
+    }
+    job.traceSlot = -1;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::deliverReply(const Job& job, QNetworkReply* reply)
+{
+  std::deque<Job> waitingJobs;
+  if(!job.shareKey.isEmpty())
+  {
+    auto iter = m_WaitingJobs.find(job.shareKey);
+    if(iter != m_WaitingJobs.end())
+    {
+      waitingJobs = std::move(iter->second);
+      m_WaitingJobs.erase(iter);
+    }
+  }
+
+  if(waitingJobs.empty())
+  {
+    ContextLocker locker(*job.context);
+    if(locker.isLocked() && job.onFinished)
+    {
+      job.onFinished(reply);
+    }
+    return;
+  }
+
+  // Each callback reads its own copy of the body
+  QByteArray body = reply->readAll();
+  waitingJobs.push_front(job);
+  for(const Job& waitingJob : waitingJobs)
+  {
+    ContextLocker locker(*waitingJob.context);
+    if(locker.isLocked() && waitingJob.onFinished)
+    {
+      HTBufferedReply* bufferedReply = new HTBufferedReply(reply, body);
+      waitingJob.onFinished(bufferedReply);
+      bufferedReply->deleteLater();
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::promoteWaitingJob(const QByteArray& shareKey)
+{
+  auto iter = m_WaitingJobs.find(shareKey);
+  if(shareKey.isEmpty() || iter == m_WaitingJobs.end())
+  {
+    return;
+  }
+
+  std::deque<Job>& waitingJobs = iter->second;
+  while(!waitingJobs.empty() && !waitingJobs.front().context->isAlive())
+  {
+    waitingJobs.pop_front();
+  }
+  if(waitingJobs.empty())
+  {
+    m_WaitingJobs.erase(iter);
+    return;
+  }
+
+  Job job = std::move(waitingJobs.front());
+  waitingJobs.pop_front();
+  LaneState& lane = getLane(job.lane);
+  lane.queues[static_cast<size_t>(job.priority)].push_back(std::move(job));
+  lane.queued++;
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestScheduler::IsTransientFailure(const QNetworkReply* reply, const RetryPolicy& policy)
+{
+  // The server may have applied a failed POST or PATCH, so sending it again could apply it twice
+  if(!policy.retryNonIdempotent && !IsIdempotent(OperationVerb(reply)))
+  {
+    return false;
+  }
+
+  QVariant statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+  if(statusCode.isValid())
+  {
+    switch(statusCode.toInt())
+    {
+    case 429:
+    case 502:
+    case 503:
+    case 504:
+      return true;
+    default:
+      break;
+    }
+  }
+
+  if(!policy.retryNetworkErrors)
+  {
+    return false;
+  }
+
+  // The connection falls back to HTTP/1.1 before the request is sent again
+  if(reply->error() == QNetworkReply::ProtocolFailure && reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool())
+  {
+    return true;
+  }
+
+  switch(reply->error())
+  {
+  case QNetworkReply::RemoteHostClosedError:
+  case QNetworkReply::TimeoutError:
+  case QNetworkReply::TemporaryNetworkFailureError:
+  case QNetworkReply::NetworkSessionFailedError:
+  case QNetworkReply::ProxyTimeoutError:
+  case QNetworkReply::UnknownNetworkError:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// -----------------------------------------------------------------------------
+int HTRequestScheduler::RetryAfterDelay(const QNetworkReply* reply)
+{
+  if(!reply->hasRawHeader("Retry-After"))
+  {
+    return -1;
+  }
+
+  // Retry-After is either a number of seconds or an HTTP date
+  QString value = QString::fromLatin1(reply->rawHeader("Retry-After")).trimmed();
+  bool isNumber = false;
+  qint64 delayMs = value.toLongLong(&isNumber) * 1000;
+  if(!isNumber)
+  {
+    QDateTime retryTime = QDateTime::fromString(value, Qt::RFC2822Date);
+    if(!retryTime.isValid())
+    {
+      return -1;
+    }
+    delayMs = QDateTime::currentDateTimeUtc().msecsTo(retryTime);
+  }
+
+  if(delayMs < 0)
+  {
+    return 0;
+  }
+  return (delayMs > k_MaxRetryAfterMs) ? k_MaxRetryAfterMs : static_cast<int>(delayMs);
+}
+
+// -----------------------------------------------------------------------------
+int HTRequestScheduler::getRetryDelay(const Job& job, const QNetworkReply* reply) const
+{
+  // Exponential backoff with jitter so that parallel requests do not retry in lockstep
+  qint64 ceiling = static_cast<qint64>(job.policy.baseDelayMs) << std::min(job.attempt - 1, 20);
+  ceiling = std::min<qint64>(ceiling, job.policy.maxDelayMs);
+  int halfCeiling = static_cast<int>(ceiling / 2);
+  int delay = halfCeiling + static_cast<int>(QRandomGenerator::global()->bounded(halfCeiling + 1));
+
+  // The server knows best when it can take the request again
+  int retryAfter = RetryAfterDelay(reply);
+  return (retryAfter > delay) ? retryAfter : delay;
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestScheduler::canStartJob(bool& isProbe) const
+{
+  isProbe = false;
+  switch(m_BreakerState.load())
+  {
+  case BreakerState::Closed:
+    return true;
+  case BreakerState::Open:
+    return false;
+  case BreakerState::HalfOpen:
+    isProbe = !m_ProbeActive;
+    return isProbe;
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::recordOutcome(bool transientFailure, bool isProbe)
+{
+  if(isProbe)
+  {
+    m_ProbeActive = false;
+  }
+
+  if(transientFailure)
+  {
+    m_ConsecutiveFailures++;
+    bool reopen = isProbe && m_BreakerState == BreakerState::HalfOpen;
+    bool trip = m_BreakerState == BreakerState::Closed && m_ConsecutiveFailures >= k_BreakerThreshold;
+    if(reopen || trip)
+    {
+      openCircuit();
+    }
+    return;
+  }
+
+  m_ConsecutiveFailures = 0;
+  if(m_BreakerState != BreakerState::Closed)
+  {
+    m_BreakerState = BreakerState::Closed;
+    emit circuitStateChanged(false);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestScheduler::openCircuit()
+{
+  bool wasClosed = (m_BreakerState == BreakerState::Closed);
+  m_BreakerState = BreakerState::Open;
+  if(wasClosed)
+  {
+    emit circuitStateChanged(true);
+  }
+
+  QTimer::singleShot(m_BreakerCooldownMs, this, [this]() {
+    if(m_BreakerState == BreakerState::Open)
+    {
+      m_BreakerState = BreakerState::HalfOpen;
+      startJobs(Lane::MetaData);
+      startJobs(Lane::Transfer);
+    }
+  });
+}
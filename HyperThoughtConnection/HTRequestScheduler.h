@@ -0,0 +1,523 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtNetwork/QNetworkReply>
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTMetrics.h"
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
+
+/**
+ * @class HTRequestScheduler HTRequestScheduler.h HyperThoughtUtilities/HyperThoughtConnection/HTRequestScheduler.h
+ * @brief The HTRequestScheduler class queues network requests for an HTConnection and limits how many
+ * are in flight at once. Metadata calls and bulk transfers are scheduled in separate lanes with their
+ * own limits so that large uploads and downloads cannot starve file listings. Each lane starts queued
+ * requests by priority and in submission order within a priority.
+ *
+ * submit() may be called from any thread. Submissions are pushed onto a lock-free list and are started
+ * from the scheduler's thread, which is also the thread the QNetworkAccessManager lives in. HTConnection
+ * runs both on a dedicated network thread, so every send function and callback runs there.
+ *
+ * Work is submitted with the ContextGuard of the object that owns it. The owner may be destroyed on any
+ * thread, so the guard is locked around every send function and callback instead of checking a QPointer.
+ *
+ * Requests that fail with a transient error (429, 502, 503, 504, a dropped connection, or a broken HTTP/2
+ * stream) are sent again after a jittered exponential backoff that honors Retry-After. Their callbacks only
+ * see the final attempt.
+ * Consecutive transient failures open a circuit breaker for the whole connection. While it is open no
+ * new requests are started. After a cooldown a single request is let through, and the breaker closes
+ * again once it succeeds.
+ *
+ * Requests submitted with the same share key while one of them is queued or in flight are coalesced.
+ * Only the first one is sent, and every waiting callback receives its own HTBufferedReply copy of the
+ * final response. If the sending request is canceled, the next waiting request is sent in its place.
+ *
+ * Every attempt that reaches the network is recorded in the scheduler's HTMetrics by endpoint, with its
+ * time in the queue, time to first byte, total latency, bytes transferred and outcome. While HTTrace is
+ * enabled each attempt is also traced on a per-lane track, one track per concurrent request, and its
+ * time in the queue is traced as an async span.
+ */
+class HyperThoughtUtilities_EXPORT HTRequestScheduler : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum class Lane
+  {
+    MetaData = 0,
+    Transfer
+  };
+
+  enum class Priority
+  {
+    Low = 0,
+    Normal,
+    High
+  };
+
+  /**
+   * @brief Creates and returns the QNetworkReply for a scheduled request.
+   * Returning nullptr drops the request without calling its FinishedCallback.
+   */
+  using SendFunction = std::function<QNetworkReply*()>;
+
+  /**
+   * @brief Called once with the finished QNetworkReply. The reply is deleted after the callback returns.
+   */
+  using FinishedCallback = std::function<void(QNetworkReply*)>;
+
+  /**
+   * @class ContextGuard
+   * @brief The ContextGuard class tells the scheduler whether the owner of submitted work still exists.
+   * Send functions, callbacks and posted functions only run while the guard is locked and its owner is
+   * alive. The owner calls release() before any of its members are destroyed. release() waits for work
+   * that is running on the scheduler's thread, so nothing runs while or after the owner is destroyed.
+   * The lock is recursive, so work may start nested event loops that run more of the owner's work.
+   */
+  class HyperThoughtUtilities_EXPORT ContextGuard
+  {
+  public:
+    ContextGuard();
+    ~ContextGuard();
+
+    ContextGuard(const ContextGuard&) = delete;            // Copy Constructor
+    ContextGuard(ContextGuard&&) = delete;                 // Move Constructor
+    ContextGuard& operator=(const ContextGuard&) = delete; // Copy Assignment
+    ContextGuard& operator=(ContextGuard&&) = delete;      // Move Assignment
+
+    /**
+     * @brief Returns true if the owner has not been released yet. Returns false otherwise.
+     * Work must still lock the guard before it touches the owner.
+     * @return
+     */
+    bool isAlive() const;
+
+    /**
+     * @brief Returns the class name used for the owner's requests in traces.
+     * @return
+     */
+    const char* getName() const;
+
+    /**
+     * @brief Sets the class name used for the owner's requests in traces. The string must outlive the guard.
+     * @param name
+     */
+    void setName(const char* name);
+
+    /**
+     * @brief Locks the guard and returns true if the owner is alive. Returns false without holding the lock otherwise.
+     * @return
+     */
+    bool lock();
+
+    /**
+     * @brief Unlocks a guard locked by lock().
+     */
+    void unlock();
+
+    /**
+     * @brief Marks the owner as destroyed. Waits for work holding the lock on other threads to return.
+     */
+    void release();
+
+  private:
+    QMutex m_Mutex;
+    std::atomic<bool> m_Alive;
+    std::atomic<const char*> m_Name;
+  };
+
+  using ContextPointer = std::shared_ptr<ContextGuard>;
+
+  /**
+   * @class ContextLocker
+   * @brief The ContextLocker class locks a ContextGuard for the scope it lives in.
+   */
+  class HyperThoughtUtilities_EXPORT ContextLocker
+  {
+  public:
+    explicit ContextLocker(ContextGuard& guard);
+    ~ContextLocker();
+
+    ContextLocker(const ContextLocker&) = delete;            // Copy Constructor
+    ContextLocker(ContextLocker&&) = delete;                 // Move Constructor
+    ContextLocker& operator=(const ContextLocker&) = delete; // Copy Assignment
+    ContextLocker& operator=(ContextLocker&&) = delete;      // Move Assignment
+
+    /**
+     * @brief Returns true if the guard is locked and its owner is alive. Returns false otherwise.
+     * @return
+     */
+    bool isLocked() const;
+
+  private:
+    ContextGuard& m_Guard;
+    bool m_Locked = false;
+  };
+
+  /**
+   * @brief Controls how often and how quickly a request is sent again after a transient failure.
+   * Only idempotent methods (GET, HEAD, PUT, DELETE and OPTIONS) are retried unless retryNonIdempotent
+   * is set. Callers set it for POST and PATCH calls that are safe to repeat.
+   */
+  struct RetryPolicy
+  {
+    int maxAttempts = 5;
+    int baseDelayMs = 500;
+    int maxDelayMs = 30000;
+    bool retryNetworkErrors = true;
+    bool retryNonIdempotent = false;
+  };
+
+  static constexpr size_t k_DefaultMetaDataLimit = 8;
+  static constexpr size_t k_DefaultTransferLimit = 4;
+  static constexpr int k_BreakerThreshold = 5;
+  static constexpr int k_BreakerCooldownMs = 30000;
+  static constexpr int k_MaxRetryAfterMs = 5 * 60 * 1000;
+
+  /**
+   * @brief Constructor
+   * @param parent
+   */
+  HTRequestScheduler(QObject* parent = nullptr);
+
+  /**
+   * @brief Destructor
+   */
+  ~HTRequestScheduler() override;
+
+  /**
+   * @brief Returns the maximum number of requests in flight for the given lane.
+   * @param lane
+   * @return
+   */
+  size_t getMaxActive(Lane lane) const;
+
+  /**
+   * @brief Sets the maximum number of requests in flight for the given lane.
+   * @param lane
+   * @param count
+   */
+  void setMaxActive(Lane lane, size_t count);
+
+  /**
+   * @brief Returns the number of requests in flight for the given lane.
+   * @param lane
+   * @return
+   */
+  size_t getActiveCount(Lane lane) const;
+
+  /**
+   * @brief Returns the number of requests waiting in the given lane.
+   * Requests that were submitted from another thread and not yet handed to the lane are not counted.
+   * @param lane
+   * @return
+   */
+  size_t getQueuedCount(Lane lane) const;
+
+  /**
+   * @brief Returns true if the circuit breaker is holding back new requests. Returns false otherwise.
+   * @return
+   */
+  bool isCircuitOpen() const;
+
+  /**
+   * @brief Returns how long in milliseconds the circuit breaker holds back requests before it lets a probe through.
+   * @return
+   */
+  int getBreakerCooldown() const;
+
+  /**
+   * @brief Sets how long in milliseconds the circuit breaker holds back requests before it lets a probe through.
+   * Takes effect the next time the breaker opens.
+   * @param cooldownMs
+   */
+  void setBreakerCooldown(int cooldownMs);
+
+  /**
+   * @brief Returns the metrics recorded for the requests sent by this scheduler.
+   * The metrics may be read from any thread.
+   * @return
+   */
+  HTMetrics& getMetrics();
+  const HTMetrics& getMetrics() const;
+
+  /**
+   * @brief Queues a request. The send function is called on the scheduler's thread once the lane has
+   * room, and the callback is called on the same thread when the reply finishes. Neither is called
+   * if the context has been released by then.
+   * This method is thread-safe.
+   * @param lane
+   * @param priority
+   * @param context Guard of the object that owns the request. Must not be nullptr.
+   * @param send
+   * @param onFinished
+   */
+  void submit(Lane lane, Priority priority, const ContextPointer& context, SendFunction send, FinishedCallback onFinished);
+
+  /**
+   * @brief Queues a request with the given retry policy. The send function is called again for each retry
+   * and must create a new QNetworkReply every time.
+   * This method is thread-safe.
+   * @param lane
+   * @param priority
+   * @param policy
+   * @param context Guard of the object that owns the request. Must not be nullptr.
+   * @param send
+   * @param onFinished
+   */
+  void submit(Lane lane, Priority priority, const RetryPolicy& policy, const ContextPointer& context, SendFunction send, FinishedCallback onFinished);
+
+  /**
+   * @brief Queues a request that shares its network call with any other request submitted with the same key
+   * that has not finished yet. Use this only for requests without side effects, such as GET requests, and
+   * build the key from everything that affects the response. An empty key is never shared.
+   * This method is thread-safe.
+   * @param lane
+   * @param priority
+   * @param policy
+   * @param shareKey
+   * @param context Guard of the object that owns the request. Must not be nullptr.
+   * @param send
+   * @param onFinished
+   */
+  void submitShared(Lane lane, Priority priority, const RetryPolicy& policy, const QByteArray& shareKey, const ContextPointer& context, SendFunction send,
+                    FinishedCallback onFinished);
+
+  /**
+   * @brief Calls the given function on the scheduler's thread unless the context has been released by then.
+   * Requests use this to start work that must not race with their own callbacks.
+   * This method is thread-safe.
+   * @param context
+   * @param function
+   */
+  void post(const ContextPointer& context, std::function<void()> function);
+
+  /**
+   * @brief Drops every queued request submitted with the context and aborts the ones in flight.
+   * Callbacks of canceled requests are not called.
+   * This method is thread-safe. Calls from other threads take effect asynchronously.
+   * @param context
+   */
+  void cancel(const ContextPointer& context);
+
+  /**
+   * @brief Returns true if the finished reply failed with an error worth retrying. Returns false otherwise.
+   * Failures of non-idempotent methods are only worth retrying if the policy allows it.
+   * @param reply
+   * @param policy
+   * @return
+   */
+  static bool IsTransientFailure(const QNetworkReply* reply, const RetryPolicy& policy);
+
+  /**
+   * @brief Returns the delay in milliseconds requested by the reply's Retry-After header
+   * or -1 if the header is missing or invalid.
+   * @param reply
+   * @return
+   */
+  static int RetryAfterDelay(const QNetworkReply* reply);
+
+signals:
+  /**
+   * @brief This signal is emitted when the circuit breaker opens or closes.
+   * @param open
+   */
+  void circuitStateChanged(bool open);
+
+private:
+  enum class BreakerState
+  {
+    Closed,
+    Open,
+    HalfOpen
+  };
+
+  struct Job
+  {
+    Lane lane = Lane::MetaData;
+    Priority priority = Priority::Normal;
+    RetryPolicy policy;
+    int attempt = 0;
+    bool canceled = false;
+    QByteArray shareKey;
+    std::chrono::steady_clock::time_point queuedAt;
+    std::chrono::steady_clock::time_point startedAt;
+    qint64 firstByteMs = -1;
+    qint64 bytesIn = 0;
+    qint64 bytesOut = 0;
+    int traceSlot = -1;
+    QString endpoint;
+    HTMetrics::EndpointMetrics* metrics = nullptr;
+    const char* contextClass = "";
+    ContextPointer context;
+    SendFunction send;
+    FinishedCallback onFinished;
+  };
+
+  struct Submission
+  {
+    Job job;
+    Submission* next = nullptr;
+  };
+
+  struct LaneState
+  {
+    std::array<std::deque<Job>, 3> queues;
+    std::atomic<size_t> maxActive;
+    std::atomic<size_t> active;
+    std::atomic<size_t> queued;
+    std::vector<bool> traceSlots;
+  };
+
+  /**
+   * @brief Moves every pending submission into its lane queue and starts as many jobs as the lanes allow.
+   */
+  void drainSubmissions();
+
+  /**
+   * @brief Moves every pending submission into its lane queue without starting any jobs.
+   */
+  void takeSubmissions();
+
+  /**
+   * @brief Starts queued jobs in the given lane until it is full or empty.
+   * @param lane
+   */
+  void startJobs(Lane lane);
+
+  /**
+   * @brief Sends the job's request and tracks the reply until it finishes.
+   * @param job
+   * @param isProbe True if this request tests a half-open circuit breaker.
+   */
+  void startJob(Job job, bool isProbe);
+
+  /**
+   * @brief Handles a finished reply. Transient failures are queued again after a backoff delay.
+   * Everything else is passed to the job's callback.
+   * @param job
+   * @param reply
+   * @param isProbe
+   */
+  void onJobFinished(const std::shared_ptr<Job>& job, QNetworkReply* reply, bool isProbe);
+
+  /**
+   * @brief Claims the lowest free trace track in the job's lane and traces the time the job spent queued.
+   * Does nothing unless HTTrace is enabled.
+   * @param job
+   * @param reply
+   */
+  void beginTrace(Job& job, const QNetworkReply* reply);
+
+  /**
+   * @brief Records the metrics of a finished attempt and traces it if beginTrace() claimed a track for it.
+   * @param job
+   * @param reply
+   * @param willRetry
+   */
+  void recordMetrics(Job& job, const QNetworkReply* reply, bool willRetry);
+
+  /**
+   * @brief Hands a copy of the shared job's final reply to every request waiting on the same key.
+   * Jobs without waiting requests receive the reply itself.
+   * @param job
+   * @param reply
+   */
+  void deliverReply(const Job& job, QNetworkReply* reply);
+
+  /**
+   * @brief Queues the next live request waiting on the given key in place of a sending request that was
+   * dropped or canceled. Forgets the key if no request is waiting.
+   * @param shareKey
+   */
+  void promoteWaitingJob(const QByteArray& shareKey);
+
+  /**
+   * @brief Returns the backoff delay in milliseconds before the job's next attempt.
+   * @param job
+   * @param reply
+   * @return
+   */
+  int getRetryDelay(const Job& job, const QNetworkReply* reply) const;
+
+  /**
+   * @brief Returns true if the circuit breaker lets another request start. Returns false otherwise.
+   * @param isProbe Set to true if the request would test a half-open breaker.
+   * @return
+   */
+  bool canStartJob(bool& isProbe) const;
+
+  /**
+   * @brief Updates the circuit breaker with the outcome of a finished attempt.
+   * @param transientFailure
+   * @param isProbe
+   */
+  void recordOutcome(bool transientFailure, bool isProbe);
+
+  /**
+   * @brief Opens the circuit breaker and schedules the half-open state after the cooldown.
+   */
+  void openCircuit();
+
+  /**
+   * @brief Returns the state for the given lane.
+   * @param lane
+   * @return
+   */
+  LaneState& getLane(Lane lane);
+  const LaneState& getLane(Lane lane) const;
+
+  std::atomic<Submission*> m_Submissions;
+  std::array<LaneState, 2> m_Lanes;
+  std::map<QNetworkReply*, std::shared_ptr<Job>> m_ActiveJobs;
+  std::set<std::shared_ptr<Job>> m_RetryJobs;
+  std::map<QByteArray, std::deque<Job>> m_WaitingJobs;
+  std::atomic<BreakerState> m_BreakerState;
+  int m_ConsecutiveFailures = 0;
+  bool m_ProbeActive = false;
+  std::atomic<int> m_BreakerCooldownMs;
+  HTMetrics m_Metrics;
+};
@@ -0,0 +1,307 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "HTTrace.h"
+
+#include <atomic>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+namespace
+{
+struct TraceEvent
+{
+  char phase = 'X';
+  const char* category = "";
+  QString name;
+  quint64 id = 0;
+  qint64 timestampUs = 0;
+  qint64 durationUs = 0;
+  QJsonObject args;
+};
+
+/**
+ * @brief Holds the recorded events. The trace is written when the process exits.
+ */
+class TraceLog
+{
+public:
+  TraceLog()
+  : epoch(std::chrono::steady_clock::now())
+  {
+    outputFile = qEnvironmentVariable("HT_TRACE_FILE");
+    fromEnvironment = !outputFile.isEmpty();
+    enabled = fromEnvironment;
+  }
+
+  ~TraceLog()
+  {
+    QMutexLocker locker(&mutex);
+    write();
+  }
+
+  /**
+   * @brief Writes the events to the output file. The mutex must be held.
+   * @return
+   */
+  bool write() const;
+
+  std::atomic<bool> enabled;
+  bool fromEnvironment = false;
+  const std::chrono::steady_clock::time_point epoch;
+
+  QMutex mutex;
+  QString outputFile;
+  std::vector<TraceEvent> events;
+  size_t droppedCount = 0;
+};
+
+bool TraceLog::write() const
+{
+  if(outputFile.isEmpty() || events.empty())
+  {
+    return false;
+  }
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  QJsonArray traceEvents;
+  for(const TraceEvent& event : events)
+  {
+    QJsonObject json;
+    json["ph"] = QString(QChar(event.phase));
+    json["name"] = event.name;
+    json["pid"] = pid;
+    json["ts"] = event.timestampUs;
+    if(event.phase == 'X')
+    {
+      json["cat"] = event.category;
+      json["tid"] = static_cast<qint64>(event.id);
+      json["dur"] = event.durationUs;
+    }
+    else if(event.phase == 'M')
+    {
+      json["tid"] = static_cast<qint64>(event.id);
+    }
+    else
+    {
+      // Async events share the process track and are grouped by category and id
+      json["cat"] = event.category;
+      json["tid"] = 0;
+      json["id"] = QString::number(event.id, 16);
+    }
+    if(!event.args.isEmpty())
+    {
+      json["args"] = event.args;
+    }
+    traceEvents.append(json);
+  }
+
+  QJsonObject trace;
+  trace["traceEvents"] = traceEvents;
+  trace["displayTimeUnit"] = "ms";
+  if(droppedCount > 0)
+  {
+    trace["droppedEvents"] = static_cast<qint64>(droppedCount);
+  }
+
+  QFile file(outputFile);
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    return false;
+  }
+  file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+  return true;
+}
+
+TraceLog& GetTraceLog()
+{
+  static TraceLog log;
+  return log;
+}
+
+qint64 ToMicroseconds(HTTrace::TimePoint time)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(time - GetTraceLog().epoch).count();
+}
+
+void AddEvent(TraceEvent event)
+{
+  TraceLog& log = GetTraceLog();
+  QMutexLocker locker(&log.mutex);
+  if(log.events.size() >= HTTrace::k_MaxEvents)
+  {
+    log.droppedCount++;
+    return;
+  }
+  log.events.push_back(std::move(event));
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+bool HTTrace::IsEnabled()
+{
+  return GetTraceLog().enabled.load(std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------------
+QString HTTrace::GetOutputFile()
+{
+  TraceLog& log = GetTraceLog();
+  QMutexLocker locker(&log.mutex);
+  return log.outputFile;
+}
+
+// -----------------------------------------------------------------------------
+void HTTrace::SetOutputFile(const QString& filePath)
+{
+  TraceLog& log = GetTraceLog();
+  QMutexLocker locker(&log.mutex);
+  if(log.fromEnvironment)
+  {
+    return;
+  }
+  log.outputFile = filePath;
+  log.enabled = !filePath.isEmpty();
+}
+
+// -----------------------------------------------------------------------------
+void HTTrace::AddSpan(const char* category, const QString& name, quint64 track, TimePoint begin, TimePoint end, const QJsonObject& args)
+{
+  if(!IsEnabled())
+  {
+    return;
+  }
+
+  TraceEvent event;
+  event.phase = 'X';
+  event.category = category;
+  event.name = name;
+  event.id = track;
+  event.timestampUs = ToMicroseconds(begin);
+  event.durationUs = ToMicroseconds(end) - event.timestampUs;
+  event.args = args;
+  AddEvent(std::move(event));
+}
+
+// -----------------------------------------------------------------------------
+void HTTrace::AddAsyncSpan(const char* category, const QString& name, quint64 id, TimePoint begin, TimePoint end, const QJsonObject& args)
+{
+  if(!IsEnabled())
+  {
+    return;
+  }
+
+  TraceEvent beginEvent;
+  beginEvent.phase = 'b';
+  beginEvent.category = category;
+  beginEvent.name = name;
+  beginEvent.id = id;
+  beginEvent.timestampUs = ToMicroseconds(begin);
+  beginEvent.args = args;
+
+  TraceEvent endEvent = beginEvent;
+  endEvent.phase = 'e';
+  endEvent.timestampUs = ToMicroseconds(end);
+  endEvent.args = QJsonObject();
+
+  AddEvent(std::move(beginEvent));
+  AddEvent(std::move(endEvent));
+}
+
+// -----------------------------------------------------------------------------
+void HTTrace::SetTrackName(quint64 track, const QString& name)
+{
+  if(!IsEnabled())
+  {
+    return;
+  }
+
+  TraceEvent event;
+  event.phase = 'M';
+  event.category = "";
+  event.name = "thread_name";
+  event.id = track;
+  event.args["name"] = name;
+  AddEvent(std::move(event));
+}
+
+// -----------------------------------------------------------------------------
+quint64 HTTrace::CurrentThreadTrack()
+{
+  // Small sequential IDs keep the tracks readable and exact in JSON
+  static std::atomic<quint64> nextTrack(1);
+  thread_local quint64 track = 0;
+  if(track == 0)
+  {
+    track = nextTrack++;
+    QString threadName = QThread::currentThread()->objectName();
+    SetTrackName(track, threadName.isEmpty() ? QString("Thread %1").arg(track) : threadName);
+  }
+  return track;
+}
+
+// -----------------------------------------------------------------------------
+bool HTTrace::Flush()
+{
+  TraceLog& log = GetTraceLog();
+  QMutexLocker locker(&log.mutex);
+  return log.write();
+}
+
+// -----------------------------------------------------------------------------
+HTTraceSpan::HTTraceSpan(const char* category, const QString& name)
+: m_Enabled(HTTrace::IsEnabled())
+{
+  if(m_Enabled)
+  {
+    m_Category = category;
+    m_Name = name;
+    m_Begin = std::chrono::steady_clock::now();
+  }
+}
+
+// -----------------------------------------------------------------------------
+HTTraceSpan::~HTTraceSpan()
+{
+  if(m_Enabled)
+  {
+    HTTrace::AddSpan(m_Category, m_Name, HTTrace::CurrentThreadTrack(), m_Begin, std::chrono::steady_clock::now());
+  }
+}
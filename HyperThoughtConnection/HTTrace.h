@@ -0,0 +1,161 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <chrono>
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
+
+/**
+ * @class HTTrace HTTrace.h HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h
+ * @brief The HTTrace class collects timeline events and writes them as a Chrome trace that can be
+ * opened in chrome://tracing or ui.perfetto.dev.
+ *
+ * Tracing is turned on by setting the HT_TRACE_FILE environment variable or the plugin's TraceFile
+ * setting to the output path. While it is off every call returns after a single atomic load.
+ * Events are kept in memory and the file is written by Flush() and when the process exits.
+ */
+class HyperThoughtUtilities_EXPORT HTTrace
+{
+public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  /**
+   * @brief Events beyond this count are dropped so that a long session cannot exhaust memory.
+   */
+  static constexpr size_t k_MaxEvents = 1000000;
+
+  HTTrace() = delete;
+
+  /**
+   * @brief Returns true if events are being recorded. Returns false otherwise.
+   * This method is thread-safe.
+   * @return
+   */
+  static bool IsEnabled();
+
+  /**
+   * @brief Returns the file the trace is written to or an empty string if tracing is off.
+   * @return
+   */
+  static QString GetOutputFile();
+
+  /**
+   * @brief Sets the file the trace is written to. An empty path turns tracing off.
+   * The HT_TRACE_FILE environment variable takes precedence over this setting.
+   * This method is thread-safe.
+   * @param filePath
+   */
+  static void SetOutputFile(const QString& filePath);
+
+  /**
+   * @brief Records an event that runs on a single track from begin to end.
+   * Events on the same track must not overlap unless one contains the other.
+   * This method is thread-safe.
+   * @param category
+   * @param name
+   * @param track
+   * @param begin
+   * @param end
+   * @param args
+   */
+  static void AddSpan(const char* category, const QString& name, quint64 track, TimePoint begin, TimePoint end, const QJsonObject& args = QJsonObject());
+
+  /**
+   * @brief Records an event that may overlap other events. Each async event is drawn on a track of its own.
+   * This method is thread-safe.
+   * @param category
+   * @param name
+   * @param id
+   * @param begin
+   * @param end
+   * @param args
+   */
+  static void AddAsyncSpan(const char* category, const QString& name, quint64 id, TimePoint begin, TimePoint end, const QJsonObject& args = QJsonObject());
+
+  /**
+   * @brief Sets the name shown for the given track.
+   * This method is thread-safe.
+   * @param track
+   * @param name
+   */
+  static void SetTrackName(quint64 track, const QString& name);
+
+  /**
+   * @brief Returns the track of the calling thread.
+   * @return
+   */
+  static quint64 CurrentThreadTrack();
+
+  /**
+   * @brief Writes every recorded event to the output file.
+   * This method is thread-safe.
+   * @return True if the file was written. False otherwise.
+   */
+  static bool Flush();
+};
+
+/**
+ * @class HTTraceSpan HTTrace.h HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h
+ * @brief The HTTraceSpan class records the lifetime of a scope on the calling thread's track.
+ */
+class HyperThoughtUtilities_EXPORT HTTraceSpan
+{
+public:
+  /**
+   * @brief Starts the span if tracing is enabled.
+   * @param category
+   * @param name
+   */
+  HTTraceSpan(const char* category, const QString& name);
+
+  /**
+   * @brief Records the span if it was started.
+   */
+  ~HTTraceSpan();
+
+  HTTraceSpan(const HTTraceSpan&) = delete;            // Copy Constructor Not Implemented
+  HTTraceSpan(HTTraceSpan&&) = delete;                 // Move Constructor Not Implemented
+  HTTraceSpan& operator=(const HTTraceSpan&) = delete; // Copy Assignment Not Implemented
+  HTTraceSpan& operator=(HTTraceSpan&&) = delete;      // Move Assignment Not Implemented
+
+private:
+  bool m_Enabled = false;
+  const char* m_Category = nullptr;
+  QString m_Name;
+  HTTrace::TimePoint m_Begin;
+};
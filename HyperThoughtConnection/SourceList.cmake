@@ -1,6 +1,7 @@
 set(HyperThoughtConnectionDir ${${PLUGIN_NAME}_SOURCE_DIR}/HyperThoughtConnection)
 
 set(${PLUGIN_NAME}_HyperThought_HDRS
+    ${HyperThoughtConnectionDir}/HTBufferedReply.h
     ${HyperThoughtConnectionDir}/HTConnection.h
     ${HyperThoughtConnectionDir}/HTFileCache.h
     ${HyperThoughtConnectionDir}/HTFileInfo.h
@@ -8,9 +9,13 @@ set(${PLUGIN_NAME}_HyperThought_HDRS
     ${HyperThoughtConnectionDir}/HTFileInfoTree.h
     ${HyperThoughtConnectionDir}/HTFilePath.h
     ${HyperThoughtConnectionDir}/HTMetaData.h
+    ${HyperThoughtConnectionDir}/HTMetrics.h
+    ${HyperThoughtConnectionDir}/HTRequestScheduler.h
+    ${HyperThoughtConnectionDir}/HTTrace.h
 )
 
 set(${PLUGIN_NAME}_HyperThought_SRCS
+    ${HyperThoughtConnectionDir}/HTBufferedReply.cpp
     ${HyperThoughtConnectionDir}/HTConnection.cpp
     ${HyperThoughtConnectionDir}/HTFileCache.cpp
     ${HyperThoughtConnectionDir}/HTFileInfo.cpp
@@ -18,6 +23,9 @@ set(${PLUGIN_NAME}_HyperThought_SRCS
     ${HyperThoughtConnectionDir}/HTFileInfoTree.cpp
     ${HyperThoughtConnectionDir}/HTFilePath.cpp
     ${HyperThoughtConnectionDir}/HTMetaData.cpp
+    ${HyperThoughtConnectionDir}/HTMetrics.cpp
+    ${HyperThoughtConnectionDir}/HTRequestScheduler.cpp
+    ${HyperThoughtConnectionDir}/HTTrace.cpp
 )
 
 source_group("HyperThoughtConnection" FILES ${${PLUGIN_NAME}_HyperThought_HDRS} ${${PLUGIN_NAME}_HyperThought_SRCS})
\ No newline at end of file
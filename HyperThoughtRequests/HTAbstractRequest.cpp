@@ -34,6 +34,10 @@
 #include "HTAbstractRequest.h"
 
 #include <QtCore/QEventLoop>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QUrlQuery>
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
 
@@ -41,16 +45,21 @@
 //
 // -----------------------------------------------------------------------------
 HTAbstractRequest::HTAbstractRequest(HTConnection* connection, bool isAsync)
-: QObject(connection)
+: QObject((nullptr != connection && connection->thread() == QThread::currentThread()) ? connection : nullptr)
 , m_Connection(connection)
+, m_Context(std::make_shared<HTRequestScheduler::ContextGuard>())
 , m_IsAsync(isAsync)
+, m_Running(false)
 {
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTAbstractRequest::~HTAbstractRequest() = default;
+HTAbstractRequest::~HTAbstractRequest()
+{
+  releaseContext();
+}
 
 // -----------------------------------------------------------------------------
 //
@@ -76,6 +85,38 @@ void HTAbstractRequest::setAsync(bool async)
   m_IsAsync = async;
 }
 
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTRequestScheduler::Priority HTAbstractRequest::getPriority() const
+{
+  return m_Priority;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::setPriority(HTRequestScheduler::Priority priority)
+{
+  m_Priority = priority;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+HTRequestScheduler::RetryPolicy HTAbstractRequest::getRetryPolicy() const
+{
+  return m_RetryPolicy;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::setRetryPolicy(const HTRequestScheduler::RetryPolicy& policy)
+{
+  m_RetryPolicy = policy;
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
@@ -135,7 +176,209 @@ QString HTAbstractRequest::getDownloadApiUrl() const
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void HTAbstractRequest::waitForResponse(QNetworkReply* reply)
+QNetworkRequest HTAbstractRequest::createFileListRequest(const HTFilePath& folderPath) const
+{
+  QString path = folderPath.getPath().isEmpty() ? "," : folderPath.getPath();
+  QUrlQuery query;
+  switch(folderPath.getScopeType())
+  {
+  case HTFilePath::ScopeType::User:
+    query.addQueryItem("path", path.toUtf8());
+    query.addQueryItem("method", "user");
+    break;
+  case HTFilePath::ScopeType::Group:
+    query.addQueryItem("group", folderPath.getSourceId().toUtf8());
+    query.addQueryItem("path", path.toUtf8());
+    query.addQueryItem("method", "group");
+    break;
+  case HTFilePath::ScopeType::Project:
+    query.addQueryItem("project", folderPath.getSourceId().toUtf8());
+    query.addQueryItem("path", path.toUtf8());
+    query.addQueryItem("method", "project");
+    break;
+  }
+
+  QUrl fileApiUrl(getFilesApiUrl());
+  fileApiUrl.setQuery(query);
+
+  QNetworkRequest request = getConnection()->createDefaultNetworkRequest();
+  request.setUrl(fileApiUrl);
+  return request;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool HTAbstractRequest::IsBodyDecoded(const QNetworkReply* reply)
+{
+  const QByteArray encoding = reply->rawHeader("Content-Encoding").trimmed().toLower();
+  if(encoding.isEmpty() || encoding == "identity")
+  {
+    return true;
+  }
+
+  // Qt decompresses the gzip and deflate bodies it asked for but keeps their Content-Encoding header.
+  // Requests that set Accept-Encoding themselves receive the raw body.
+  const bool isQtEncoding = (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate");
+  return isQtEncoding && !reply->request().hasRawHeader("Accept-Encoding");
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::sendRequest(HTRequestScheduler::Lane lane, HTRequestScheduler::SendFunction send, HTRequestScheduler::FinishedCallback onFinished)
+{
+  sendRequest(lane, m_RetryPolicy, std::move(send), std::move(onFinished));
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::sendRequest(HTRequestScheduler::Lane lane, const HTRequestScheduler::RetryPolicy& policy, HTRequestScheduler::SendFunction send,
+                                    HTRequestScheduler::FinishedCallback onFinished)
+{
+  markRunning();
+  getConnection()->getScheduler()->submit(lane, m_Priority, policy, m_Context, std::move(send), std::move(onFinished));
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::sendSharedGetRequest(const QNetworkRequest& request, HTRequestScheduler::FinishedCallback onFinished)
+{
+  // Conditional headers change the response, so they are part of the key
+  QByteArray shareKey = "GET " + request.url().toEncoded() + "\n" + request.rawHeader("Authorization");
+  shareKey += "\n" + request.rawHeader("If-None-Match") + "\n" + request.rawHeader("If-Modified-Since");
+
+  markRunning();
+  getConnection()->getScheduler()->submitShared(HTRequestScheduler::Lane::MetaData, m_Priority, m_RetryPolicy, shareKey, m_Context, [this, request]() { return getConnection()->get(request); },
+                                                std::move(onFinished));
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::markRunning()
+{
+  // Later stages of a running request continue its span
+  if(!m_Running && HTTrace::IsEnabled())
+  {
+    m_Traced = true;
+    m_TraceBegin = std::chrono::steady_clock::now();
+  }
+  m_Running = true;
+  m_Context->setName(metaObject()->className());
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+const HTRequestScheduler::ContextPointer& HTAbstractRequest::getContext() const
+{
+  return m_Context;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::releaseContext()
+{
+  m_Context->release();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::endTrace(const QString& outcome)
+{
+  if(!m_Traced)
+  {
+    return;
+  }
+  m_Traced = false;
+
+  QJsonObject args;
+  args["outcome"] = outcome;
+  HTTrace::AddAsyncSpan("request", metaObject()->className(), reinterpret_cast<quintptr>(this), m_TraceBegin, std::chrono::steady_clock::now(), args);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::runOnNetworkThread(std::function<void()> function)
+{
+  getConnection()->getScheduler()->post(m_Context, std::move(function));
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::cancel()
+{
+  runOnNetworkThread([this]() {
+    // Requests that already finished or never started have nothing to cancel
+    if(!m_Running)
+    {
+      return;
+    }
+    getConnection()->getScheduler()->cancel(m_Context);
+    onCanceled();
+  });
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::onCanceled()
+{
+  fail(QNetworkReply::OperationCanceledError);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::finish()
+{
+  // Asynchronous requests may be deleted as soon as the signal is delivered
+  endTrace("finished");
+  m_Running = false;
+  bool wake = !isAsync();
+  emit finished();
+  if(wake)
+  {
+    wakeWaitingThread();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::fail(QNetworkReply::NetworkError err)
+{
+  endTrace(QString("failed (%1)").arg(err));
+  m_Running = false;
+  bool wake = !isAsync();
+  emit requestFailed(err);
+  if(wake)
+  {
+    wakeWaitingThread();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::wakeWaitingThread()
+{
+  QMutexLocker locker(&m_WaitMutex);
+  m_Completed = true;
+  m_WaitCondition.wakeAll();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTAbstractRequest::waitForFinished()
 {
   // Asynchronous requests should not wait
   if(isAsync())
@@ -143,8 +386,24 @@ void HTAbstractRequest::waitForResponse(QNetworkReply* reply)
     return;
   }
 
-  QEventLoop loop;
-  QObject::connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), &loop, &QEventLoop::quit);
-  QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-  loop.exec();
+  // Blocking the network thread would also block the replies being waited for
+  if(QThread::currentThread() == getConnection()->getNetworkThread())
+  {
+    QEventLoop loop;
+    QObject::connect(this, &HTAbstractRequest::requestFailed, &loop, &QEventLoop::quit);
+    QObject::connect(this, &HTAbstractRequest::finished, &loop, &QEventLoop::quit);
+    if(!m_Completed)
+    {
+      loop.exec();
+    }
+    m_Completed = false;
+    return;
+  }
+
+  QMutexLocker locker(&m_WaitMutex);
+  while(!m_Completed)
+  {
+    m_WaitCondition.wait(&m_WaitMutex);
+  }
+  m_Completed = false;
 }
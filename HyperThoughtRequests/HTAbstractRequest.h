@@ -33,9 +33,16 @@
 
 #pragma once
 
+#include <atomic>
+
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QWaitCondition>
 #include <QtNetwork/QNetworkReply>
 
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTRequestScheduler.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
 
 class HTConnection;
@@ -45,6 +52,20 @@ class HTConnection;
  * @brief The HTAbstractRequest class serves as the basis of all HyperThought requests.
  * It provides access to HyperThought connection values to its subclasses as well as
  * synchronous / asynchronous control flow.
+ *
+ * Every network call is sent through the connection's HTRequestScheduler. Synchronous requests
+ * wait once for finished() or requestFailed() instead of waiting on each reply.
+ *
+ * Callbacks run on the connection's network thread and the request's signals are emitted from there.
+ * A synchronous exec() blocks the calling thread until the request completes without processing its
+ * events, so slots that must run before exec() returns should be connected with Qt::DirectConnection.
+ *
+ * Requests may be destroyed on any thread. Callbacks hold the request's scheduler context while they
+ * run, and destroying the request waits for a running callback and prevents later ones. Subclasses
+ * call releaseContext() first in their destructors so no callback sees their members being destroyed.
+ *
+ * While HTTrace is enabled, the time from a request's first network call until it finishes or fails
+ * is traced as an async span named after the request class.
  */
 class HyperThoughtUtilities_EXPORT HTAbstractRequest : public QObject
 {
@@ -81,6 +102,30 @@ public:
    */
   void setAsync(bool async);
 
+  /**
+   * @brief Returns the priority used when scheduling this request's network calls.
+   * @return
+   */
+  HTRequestScheduler::Priority getPriority() const;
+
+  /**
+   * @brief Sets the priority used when scheduling this request's network calls.
+   * @param priority
+   */
+  void setPriority(HTRequestScheduler::Priority priority);
+
+  /**
+   * @brief Returns the policy used to retry this request's network calls after transient failures.
+   * @return
+   */
+  HTRequestScheduler::RetryPolicy getRetryPolicy() const;
+
+  /**
+   * @brief Sets the policy used to retry this request's network calls after transient failures.
+   * @param policy
+   */
+  void setRetryPolicy(const HTRequestScheduler::RetryPolicy& policy);
+
   /**
    * @brief Makes the approriate request over the connection.
    * Emits the appropriate signals as the request is completed.
@@ -88,6 +133,13 @@ public:
    */
   virtual void exec() = 0;
 
+  /**
+   * @brief Stops the request if it is running. Queued network calls are dropped and calls in flight
+   * are aborted. The request then fails with QNetworkReply::OperationCanceledError.
+   * This method is thread-safe and takes effect asynchronously.
+   */
+  void cancel();
+
 signals:
   void requestFailed(QNetworkReply::NetworkError err);
   void finished();
@@ -136,15 +188,126 @@ protected:
   QString getDownloadApiUrl() const;
 
   /**
-   * @brief This method is used to make a request behave synchronously.
-   * An event loop is connected to the given reply and will only stop when an
-   * error is emitted or is the request is completed.
-   * If the request is asynchronous, this method does nothing.
+   * @brief Creates a GET request for the listing of the given folder.
+   * @param folderPath
+   * @return
+   */
+  QNetworkRequest createFileListRequest(const HTFilePath& folderPath) const;
+
+  /**
+   * @brief Returns true if the reply body can be parsed as is. Returns false if it still carries
+   * a content encoding that Qt did not decode, such as br from a proxy that ignored Accept-Encoding.
+   * Gzip and deflate bodies count as decoded unless the request set Accept-Encoding itself.
    * @param reply
+   * @return
    */
-  void waitForResponse(QNetworkReply* reply);
+  static bool IsBodyDecoded(const QNetworkReply* reply);
+
+  /**
+   * @brief Queues a network call on the connection's scheduler in the given lane.
+   * The callback is called with the finished reply unless this request has been destroyed.
+   * Transient failures are retried according to getRetryPolicy(), so the send function may be
+   * called more than once and must create a new reply each time.
+   * The scheduler deletes the reply after the callback returns.
+   * @param lane
+   * @param send
+   * @param onFinished
+   */
+  void sendRequest(HTRequestScheduler::Lane lane, HTRequestScheduler::SendFunction send, HTRequestScheduler::FinishedCallback onFinished);
+
+  /**
+   * @brief Sends a network call like sendRequest() but retries transient failures according to the given policy.
+   * Used by stages that opt in to retrying a non-idempotent method.
+   * @param lane
+   * @param policy
+   * @param send
+   * @param onFinished
+   */
+  void sendRequest(HTRequestScheduler::Lane lane, const HTRequestScheduler::RetryPolicy& policy, HTRequestScheduler::SendFunction send,
+                   HTRequestScheduler::FinishedCallback onFinished);
+
+  /**
+   * @brief Queues a GET request on the connection's scheduler in the MetaData lane.
+   * Identical GET requests with the same URL, Authorization and conditional headers that are queued or in flight
+   * at the same time share one network call, and each callback receives a copy of the response.
+   * @param request
+   * @param onFinished
+   */
+  void sendSharedGetRequest(const QNetworkRequest& request, HTRequestScheduler::FinishedCallback onFinished);
+
+  /**
+   * @brief Calls the given function on the network thread unless this request has been destroyed.
+   * Work that starts network calls should run there so it cannot race with their callbacks.
+   * @param function
+   */
+  void runOnNetworkThread(std::function<void()> function);
+
+  /**
+   * @brief Called on the network thread when a running request is canceled.
+   * Subclasses release their resources and report the failure.
+   * The default implementation calls fail(QNetworkReply::OperationCanceledError).
+   */
+  virtual void onCanceled();
+
+  /**
+   * @brief Emits finished() and wakes the thread waiting in waitForFinished().
+   */
+  void finish();
+
+  /**
+   * @brief Emits requestFailed() and wakes the thread waiting in waitForFinished().
+   * @param err
+   */
+  void fail(QNetworkReply::NetworkError err);
+
+  /**
+   * @brief This method is used to make a request spanning multiple replies behave synchronously.
+   * The calling thread blocks until finish() or fail() is called from the network thread.
+   * If the request is asynchronous, this method does nothing.
+   */
+  void waitForFinished();
+
+  /**
+   * @brief Returns the guard passed to the scheduler with this request's network calls.
+   * Work connected outside of the scheduler, such as a reply's readyRead(), locks it before touching the request.
+   * @return
+   */
+  const HTRequestScheduler::ContextPointer& getContext() const;
+
+  /**
+   * @brief Waits for a callback running on the network thread and prevents later ones.
+   * Must be called at the start of every subclass destructor. Calling it more than once is harmless.
+   */
+  void releaseContext();
 
 private:
+  /**
+   * @brief Marks the request as running before a network call is queued.
+   */
+  void markRunning();
+
+  /**
+   * @brief Traces the request's span if it is being traced.
+   * @param outcome
+   */
+  void endTrace(const QString& outcome);
+
+  /**
+   * @brief Marks the request as complete and wakes the waiting thread.
+   */
+  void wakeWaitingThread();
+
   HTConnection* m_Connection = nullptr;
+  HTRequestScheduler::ContextPointer m_Context;
   bool m_IsAsync = false;
+  HTRequestScheduler::Priority m_Priority = HTRequestScheduler::Priority::Normal;
+  HTRequestScheduler::RetryPolicy m_RetryPolicy;
+
+  std::atomic<bool> m_Running;
+  bool m_Traced = false;
+  HTTrace::TimePoint m_TraceBegin;
+
+  QMutex m_WaitMutex;
+  QWaitCondition m_WaitCondition;
+  bool m_Completed = false;
 };
@@ -33,7 +33,10 @@
 
 #include "HTAbstractUploadRequest.h"
 
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMimeDatabase>
+#include <QtCore/QThread>
 
 #include "HyperThoughtUtilities/HyperThoughtRequests/HTUpdateMetaDataRequest.h"
 
@@ -46,7 +49,16 @@ HTAbstractUploadRequest::HTAbstractUploadRequest(HTConnection* connection, const
 }
 
 // -----------------------------------------------------------------------------
-HTAbstractUploadRequest::~HTAbstractUploadRequest() = default;
+HTAbstractUploadRequest::~HTAbstractUploadRequest()
+{
+  releaseContext();
+
+  // The file belongs to the network thread once the upload has started
+  if(nullptr != m_UploadFile)
+  {
+    m_UploadFile->deleteLater();
+  }
+}
 
 // -----------------------------------------------------------------------------
 HTFilePath HTAbstractUploadRequest::getUploadPath() const
@@ -99,20 +111,27 @@ QString HTAbstractUploadRequest::getFinalizeUploadUrl() const
 }
 
 // -----------------------------------------------------------------------------
-void HTAbstractUploadRequest::initFileUpload(const HTFilePath& uploadTarget, const QString& localPath)
+bool HTAbstractUploadRequest::initFileUpload(const HTFilePath& uploadTarget, const QString& localPath)
 {
-  // Extract data from the local file
-  QFile file(localPath);
-  if(!file.open(QIODevice::OpenModeFlag::ReadOnly))
+  // Open the local file for streaming. Only its size and content type are read here.
+  closeUploadFile();
+  m_UploadFile = new QFile(localPath);
+  if(!m_UploadFile->open(QIODevice::OpenModeFlag::ReadOnly))
   {
+    delete m_UploadFile;
+    m_UploadFile = nullptr;
     emit cannotReadFile();
-    return;
-  }
-  else
-  {
-    m_UploadData = file.readAll();
+    failUpload(QNetworkReply::UnknownContentError);
+    return false;
   }
 
+  // The network manager reads the upload body from its own thread
+  m_UploadFile->moveToThread(getConnection()->getNetworkThread());
+
+  QFileInfo fileInfo(localPath);
+  m_UploadSize = fileInfo.size();
+  m_ContentType = QMimeDatabase().mimeTypeForFile(fileInfo).name();
+
   // Request the upload URL from HyperThought
   QByteArray json = getInitPayload().toJson(QJsonDocument::Compact);
   QByteArray jsonSize = QByteArray::number(json.size());
@@ -122,14 +141,12 @@ void HTAbstractUploadRequest::initFileUpload(const HTFilePath& uploadTarget, con
   request.setRawHeader("Content-Length", jsonSize);
   request.setUrl(genUploadUrl);
 
-  // Send request and wait for a reply.
-  auto reply = getConnection()->post(request, json);
-  connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &HTAbstractUploadRequest::uploadFailed);
-  connect(reply, &QNetworkReply::finished, this, &HTAbstractUploadRequest::onInitResponse);
-  connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
-
-  // If asynchronous, wait for a response before proceeding
-  waitForResponse(reply);
+  // A repeated request only generates an upload URL that is never used
+  HTRequestScheduler::RetryPolicy policy = getRetryPolicy();
+  policy.retryNonIdempotent = true;
+  sendRequest(
+      HTRequestScheduler::Lane::MetaData, policy, [this, request, json]() { return getConnection()->post(request, json); }, [this](QNetworkReply* reply) { onInitResponse(reply); });
+  return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -138,16 +155,30 @@ void HTAbstractUploadRequest::uploadData()
   auto request = getConnection()->createDefaultNetworkRequest();
   request.setUrl(m_UploadUrl);
   request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/octet-stream");
-  request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, m_UploadData.size());
+  request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, m_UploadSize);
 
-  // Send request and wait for a reply.
-  auto reply = getConnection()->put(request, m_UploadData);
-  connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &HTAbstractUploadRequest::uploadFailed);
-  connect(reply, &QNetworkReply::finished, this, &HTAbstractUploadRequest::onDataUploaded);
-  connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+  // Stream the body from the file instead of buffering the whole upload in memory
+  request.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
 
-  // If asynchronous, wait for a response before proceeding
-  waitForResponse(reply);
+  // Every attempt, including retries, sends the file from the beginning
+  auto send = [this, request]() {
+    m_UploadFile->seek(0);
+    return getConnection()->put(request, m_UploadFile);
+  };
+  sendRequest(HTRequestScheduler::Lane::Transfer, send, [this](QNetworkReply* reply) { onDataUploaded(reply); });
+}
+
+// -----------------------------------------------------------------------------
+void HTAbstractUploadRequest::closeUploadFile()
+{
+  if(nullptr == m_UploadFile)
+  {
+    return;
+  }
+
+  m_UploadFile->close();
+  m_UploadFile->deleteLater();
+  m_UploadFile = nullptr;
 }
 
 // -----------------------------------------------------------------------------
@@ -159,24 +190,24 @@ void HTAbstractUploadRequest::finalizeUpload()
   request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
   request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, json.size());
   request.setUrl(tempUrl);
-  
-  // Send request and wait for a reply.
-  auto reply = getConnection()->patch(request, json);
-  connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &HTAbstractUploadRequest::uploadFailed);
-  connect(reply, &QNetworkReply::finished, this, &HTAbstractUploadRequest::onUploadFinalized);
-  connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
-
-  // If asynchronous, wait for a response before proceeding
-  waitForResponse(reply);
+
+  // Not retried: the file may already have been moved when the response is lost
+  sendRequest(
+      HTRequestScheduler::Lane::MetaData, [this, request, json]() { return getConnection()->patch(request, json); }, [this](QNetworkReply* reply) { onUploadFinalized(reply); });
 }
 
 // -----------------------------------------------------------------------------
 void HTAbstractUploadRequest::patchMetaData()
 {
-  m_MetaDataRequest = new HTUpdateMetaDataRequest(getConnection(), m_UploadFileId, m_MetaData, isAsync());
-  connect(m_MetaDataRequest, &HTUpdateMetaDataRequest::finished, this, &HTAbstractUploadRequest::onMetaDataPatched);
-  connect(m_MetaDataRequest, &HTUpdateMetaDataRequest::requestFailed, this, &HTAbstractUploadRequest::onMetaDataError);
-  m_MetaDataRequest->exec();
+  // Patched directly because a nested request object cannot be created on the network thread
+  QByteArray json = HTUpdateMetaDataRequest::CreatePayloadDoc(m_UploadFileId, m_MetaData).toJson(QJsonDocument::Compact);
+  auto request = createNetworkRequest();
+
+  // The patch sets the same values every time
+  HTRequestScheduler::RetryPolicy policy = getRetryPolicy();
+  policy.retryNonIdempotent = true;
+  sendRequest(
+      HTRequestScheduler::Lane::MetaData, policy, [this, request, json]() { return getConnection()->patch(request, json); }, [this](QNetworkReply* reply) { onMetaDataPatched(reply); });
 }
 
 // -----------------------------------------------------------------------------
@@ -204,7 +235,7 @@ QJsonDocument HTAbstractUploadRequest::getInitPayload() const
   payload["users"] = QJsonArray();
   payload["name"] = getUploadName();
   payload["contentType"] = getContentType();
-  payload["size"] = m_UploadData.size();
+  payload["size"] = m_UploadSize;
 
   QJsonDocument doc;
   doc.setObject(payload);
@@ -223,12 +254,12 @@ QJsonDocument HTAbstractUploadRequest::getFinalPayload() const
 }
 
 // -----------------------------------------------------------------------------
-void HTAbstractUploadRequest::onInitResponse()
+void HTAbstractUploadRequest::onInitResponse(QNetworkReply* reply)
 {
-  QNetworkReply* reply = dynamic_cast<QNetworkReply*>(sender());
   if(reply->error() > 0)
   {
-    uploadFailed(reply->error());
+    closeUploadFile();
+    failUpload(reply->error());
     return;
   }
   
@@ -242,12 +273,13 @@ void HTAbstractUploadRequest::onInitResponse()
 }
 
 // -----------------------------------------------------------------------------
-void HTAbstractUploadRequest::onDataUploaded()
+void HTAbstractUploadRequest::onDataUploaded(QNetworkReply* reply)
 {
-  QNetworkReply* reply = dynamic_cast<QNetworkReply*>(sender());
+  closeUploadFile();
+
   if(reply->error() > 0)
   {
-    uploadFailed(reply->error());
+    failUpload(reply->error());
     return;
   }
 
@@ -256,12 +288,11 @@ void HTAbstractUploadRequest::onDataUploaded()
 }
 
 // -----------------------------------------------------------------------------
-void HTAbstractUploadRequest::onUploadFinalized()
+void HTAbstractUploadRequest::onUploadFinalized(QNetworkReply* reply)
 {
-  QNetworkReply* reply = dynamic_cast<QNetworkReply*>(sender());
   if(reply->error() > 0)
   {
-    uploadFailed(reply->error());
+    failUpload(reply->error());
     return;
   }
 
@@ -271,31 +302,45 @@ void HTAbstractUploadRequest::onUploadFinalized()
   }
   else
   {
-    emit uploadComplete();
+    completeUpload();
   }
 }
 
 // -----------------------------------------------------------------------------
-void HTAbstractUploadRequest::onMetaDataPatched()
+void HTAbstractUploadRequest::onMetaDataPatched(QNetworkReply* reply)
 {
-  m_MetaDataRequest->deleteLater();
-  m_MetaDataRequest = nullptr;
-  emit uploadComplete();
+  if(reply->error() > 0)
+  {
+    failUpload(reply->error());
+    return;
+  }
+
+  completeUpload();
 }
 
 // -----------------------------------------------------------------------------
-void HTAbstractUploadRequest::onMetaDataError(QNetworkReply::NetworkError err)
+void HTAbstractUploadRequest::completeUpload()
 {
-  m_MetaDataRequest->deleteLater();
-  m_MetaDataRequest = nullptr;
+  emit uploadComplete();
+  finish();
+}
 
+// -----------------------------------------------------------------------------
+void HTAbstractUploadRequest::failUpload(QNetworkReply::NetworkError err)
+{
   emit uploadFailed(err);
+  fail(err);
+}
+
+// -----------------------------------------------------------------------------
+void HTAbstractUploadRequest::onCanceled()
+{
+  closeUploadFile();
+  failUpload(QNetworkReply::OperationCanceledError);
 }
 
 // -----------------------------------------------------------------------------
 QString HTAbstractUploadRequest::getContentType() const
 {
-  QMimeDatabase db;
-  QMimeType type = db.mimeTypeForData(m_UploadData);
-  return type.name();
+  return m_ContentType;
 }
@@ -41,7 +41,7 @@
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTMetaData.h"
 
-class HTUpdateMetaDataRequest;
+class QFile;
 
 /**
  * @class HTFileUploadRequest HTFileUploadRequest.h HyperThoughtUtilities/HyperThoughtConnection/HTFileUploadRequest.h
@@ -110,19 +110,27 @@ protected:
 
   /**
    * @brief Initialize the file upload using the target upload directory and local file path.
-   * Copies the local file to a QByteArray.
+   * Opens the local file for streaming and reads its size and content type without loading its contents.
    * Calls onInitResponse() when completed.
+   * Returns false and emits cannotReadFile() and uploadFailed() if the local file cannot be opened.
    * @param uploadTarget
    * @param localPath
+   * @return
    */
-  void initFileUpload(const HTFilePath& uploadTarget, const QString& localPath);
+  bool initFileUpload(const HTFilePath& uploadTarget, const QString& localPath);
 
   /**
-   * @brief Uploads the QByteArray data to the URL provided by HyperThought in the initFileUpload response.
+   * @brief Streams the local file to the URL provided by HyperThought in the initFileUpload response.
+   * The file is read in bounded chunks as the data is sent.
    * Calls onDataUploaded() when completed.
    */
   void uploadData();
 
+  /**
+   * @brief Closes and releases the local file being uploaded.
+   */
+  void closeUploadFile();
+
   /**
    * @brief Finalizes the data upload by notifying HyperThought that the file has been fully uploaded.
    * Calls onUploadFinalized() when completed.
@@ -131,6 +139,7 @@ protected:
 
   /**
    * @brief Requests HyperThought update the metadata for the uploaded file.
+   * Calls onMetaDataPatched() when completed.
    */
   void patchMetaData();
 
@@ -151,34 +160,49 @@ protected:
    * If no network errors occured, the response contains the URL for the next part
    * of the upload request and the fileId to use for finalizing the upload.
    * Otherwise, emits uploadFailed(QNetworkReply::NetworkError).
+   * @param reply
    */
-  void onInitResponse();
+  void onInitResponse(QNetworkReply* reply);
 
   /**
    * @brief Called when the data has finished uploading to HyperThought.
    * If no network errors occurred, this calls finalizeUpload() to finalize the upload.
    * Otherwise, emits uploadFailed(QNetworkReply::NetworkError).
+   * @param reply
    */
-  void onDataUploaded();
+  void onDataUploaded(QNetworkReply* reply);
 
   /**
    * @brief Called when the upload has been finalized.
    * If no network errors occurred, the uploadComplete() signal is emitted.
    * Otherwise, emits uploadFailed(QNetworkReply::NetworkError).
+   * @param reply
+   */
+  void onUploadFinalized(QNetworkReply* reply);
+
+  /**
+   * @brief Called when HyperThought responds to the metadata patch for the uploaded file.
+   * If no network errors occurred, the uploadComplete() signal is emitted.
+   * Otherwise, emits uploadFailed(QNetworkReply::NetworkError).
+   * @param reply
    */
-  void onUploadFinalized();
+  void onMetaDataPatched(QNetworkReply* reply);
 
   /**
-   * @brief Called when the uploaded HyperThought file has had its metadata patched.
-   * Deletes the update request and returns uploadComplete().
+   * @brief Emits uploadComplete() and finished().
    */
-  void onMetaDataPatched();
+  void completeUpload();
 
   /**
-   * @brief Called when the uploaded HyperThought file failed to be patched.
+   * @brief Emits uploadFailed(QNetworkReply::NetworkError) and requestFailed(QNetworkReply::NetworkError).
    * @param err
    */
-  void onMetaDataError(QNetworkReply::NetworkError err);
+  void failUpload(QNetworkReply::NetworkError err);
+
+  /**
+   * @brief Releases the local file and emits uploadFailed() and requestFailed().
+   */
+  void onCanceled() override;
 
   /**
    * @brief Returns the content type for the data to be uploaded.
@@ -188,10 +212,11 @@ protected:
 
 private:
   HTFilePath m_UploadPath;
-  QByteArray m_UploadData;
+  QFile* m_UploadFile = nullptr;
+  qint64 m_UploadSize = 0;
+  QString m_ContentType;
   QString m_UploadFileId;
   QString m_UploadUrl;
   bool m_AssignsMetaData;
   HTMetaData m_MetaData;
-  HTUpdateMetaDataRequest* m_MetaDataRequest = nullptr;
 };
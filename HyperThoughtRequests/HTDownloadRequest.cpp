@@ -33,6 +33,13 @@
 
 #include "HTDownloadRequest.h"
 
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSaveFile>
+
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
 
 // -----------------------------------------------------------------------------
@@ -47,7 +54,14 @@ HTDownloadRequest::HTDownloadRequest(HTConnection* connection, const HTFilePath&
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-HTDownloadRequest::~HTDownloadRequest() = default;
+HTDownloadRequest::~HTDownloadRequest()
+{
+  releaseContext();
+  if(nullptr != m_File)
+  {
+    m_File->deleteLater();
+  }
+}
 
 // -----------------------------------------------------------------------------
 //
@@ -97,49 +111,564 @@ void HTDownloadRequest::setDownloadDir(const QDir& dir)
   m_DownloadDir = dir;
 }
 
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+size_t HTDownloadRequest::getMaxStreams() const
+{
+  return m_MaxStreams;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::setMaxStreams(size_t count)
+{
+  m_MaxStreams = (count > 0) ? count : 1;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+qint64 HTDownloadRequest::getMinSegmentSize() const
+{
+  return m_MinSegmentSize;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::setMinSegmentSize(qint64 size)
+{
+  m_MinSegmentSize = (size > 0) ? size : 1;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool HTDownloadRequest::isResumeEnabled() const
+{
+  return m_ResumeEnabled;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::setResumeEnabled(bool enabled)
+{
+  m_ResumeEnabled = enabled;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+QString HTDownloadRequest::getTargetFilePath() const
+{
+  return m_DownloadDir.path() + "/" + getDownloadName();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+QString HTDownloadRequest::getCheckpointFilePath() const
+{
+  return getTargetFilePath() + ".htdownload";
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
 void HTDownloadRequest::exec()
 {
-  QString filePath = m_DownloadDir.path() + "/" + getDownloadName();
-  m_File = new QFile(filePath, this);
+  m_FileInfo = getConnection()->getFileCache().getFileInfo(m_FilePath);
+  m_DownloadUrl = QUrl(getDownloadApiUrl() + "?pk=" + m_FileInfo.getId());
+  m_Segments.clear();
+  m_TotalSize = -1;
+  m_Done = false;
+  m_CheckpointedBytes = 0;
+
+  // The file is written and released on the network thread. Requests started by an HTRequestGroup
+  // may already be running there, so it cannot be parented to this request.
+  m_File = new QFile(getTargetFilePath());
+  m_File->moveToThread(getConnection()->getNetworkThread());
+  if(m_ResumeEnabled && readCheckpoint())
+  {
+    // Keep the bytes already received
+    if(m_File->open(QIODevice::ReadWrite))
+    {
+      runOnNetworkThread([this]() { resumeSegments(); });
+    }
+    else
+    {
+      failDownload(QNetworkReply::UnknownContentError);
+    }
+    waitForFinished();
+    return;
+  }
+
+  // A stale or mismatched checkpoint describes a partial file that is about to be truncated
+  QFile::remove(getCheckpointFilePath());
   if(!m_File->open(QIODevice::WriteOnly | QIODevice::Truncate))
   {
+    failDownload(QNetworkReply::UnknownContentError);
+    waitForFinished();
     return;
   }
 
-  HTFileInfo fileInfo = getConnection()->getFileCache().getFileInfo(m_FilePath);
-  QString downloadUrl = getDownloadApiUrl() + "?pk=" + fileInfo.getId();
+  // Files known to be too small to split skip the extra round trip of the probe
+  // Segments are laid out and requested on the network thread so they cannot race with their callbacks
+  qint64 knownSize = m_FileInfo.getContent().size;
+  bool useRanges = m_MaxStreams > 1 && (knownSize <= 0 || knownSize >= 2 * m_MinSegmentSize);
+  runOnNetworkThread([this, useRanges]() {
+    if(useRanges)
+    {
+      probeRangeSupport();
+    }
+    else
+    {
+      startSingleStream();
+    }
+  });
+
+  // Synchronous requests wait for every stream instead of each reply.
+  waitForFinished();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool HTDownloadRequest::readCheckpoint()
+{
+  const HTFileInfo::Content content = m_FileInfo.getContent();
+  if(content.pk.isEmpty() || content.modifiedDate.isEmpty())
+  {
+    return false;
+  }
+
+  QFile checkpointFile(getCheckpointFilePath());
+  if(!checkpointFile.open(QIODevice::ReadOnly))
+  {
+    return false;
+  }
+  QJsonObject checkpoint = QJsonDocument::fromJson(checkpointFile.readAll()).object();
+  checkpointFile.close();
+
+  // The partial file is only valid for the same remote file revision
+  qint64 totalSize = static_cast<qint64>(checkpoint["size"].toDouble(-1));
+  if(checkpoint["fileId"].toString() != content.pk || checkpoint["modified"].toString() != content.modifiedDate)
+  {
+    return false;
+  }
+  if(totalSize <= 0 || QFileInfo(getTargetFilePath()).size() != totalSize)
+  {
+    return false;
+  }
+
+  std::vector<Segment> segments;
+  const QJsonArray segmentArray = checkpoint["segments"].toArray();
+  for(const QJsonValue& value : segmentArray)
+  {
+    QJsonObject segmentObj = value.toObject();
+    Segment segment;
+    segment.Begin = static_cast<qint64>(segmentObj["begin"].toDouble(-1));
+    segment.End = static_cast<qint64>(segmentObj["end"].toDouble(-1));
+    segment.Received = static_cast<qint64>(segmentObj["received"].toDouble(-1));
+    if(segment.Begin < 0 || segment.End < segment.Begin || segment.End >= totalSize || segment.Received < 0 || segment.Received > segment.End - segment.Begin + 1)
+    {
+      return false;
+    }
+    segments.push_back(segment);
+  }
+  if(segments.empty())
+  {
+    return false;
+  }
+
+  m_Segments = std::move(segments);
+  m_TotalSize = totalSize;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::writeCheckpoint()
+{
+  if(!m_ResumeEnabled || nullptr == m_File || m_TotalSize <= 0 || m_Segments.empty() || m_Segments.front().End < 0)
+  {
+    return;
+  }
+
+  // Only record bytes that have reached the file
+  m_File->flush();
+
+  QJsonArray segmentArray;
+  qint64 bytesReceived = 0;
+  for(const Segment& segment : m_Segments)
+  {
+    QJsonObject segmentObj;
+    segmentObj["begin"] = segment.Begin;
+    segmentObj["end"] = segment.End;
+    segmentObj["received"] = segment.Received;
+    segmentArray.append(segmentObj);
+    bytesReceived += segment.Received;
+  }
+
+  const HTFileInfo::Content content = m_FileInfo.getContent();
+  QJsonObject checkpoint;
+  checkpoint["fileId"] = content.pk;
+  checkpoint["modified"] = content.modifiedDate;
+  checkpoint["size"] = m_TotalSize;
+  checkpoint["segments"] = segmentArray;
+
+  QSaveFile checkpointFile(getCheckpointFilePath());
+  if(checkpointFile.open(QIODevice::WriteOnly))
+  {
+    checkpointFile.write(QJsonDocument(checkpoint).toJson(QJsonDocument::Compact));
+    checkpointFile.commit();
+  }
+  m_CheckpointedBytes = bytesReceived;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::resumeSegments()
+{
+  m_Generation++;
+
+  qint64 bytesReceived = 0;
+  bool requested = false;
+  for(size_t i = 0; i < m_Segments.size(); i++)
+  {
+    Segment& segment = m_Segments[i];
+    bytesReceived += segment.Received;
+    segment.Finished = (segment.Received == segment.End - segment.Begin + 1);
+    if(!segment.Finished)
+    {
+      requestSegment(i);
+      requested = true;
+    }
+  }
+  m_CheckpointedBytes = bytesReceived;
+  emit downloadProgress(bytesReceived, m_TotalSize);
+
+  // The previous attempt stopped after the last byte was written
+  if(!requested)
+  {
+    onDownloadComplete();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::probeRangeSupport()
+{
   QNetworkRequest request = getConnection()->createDefaultNetworkRequest();
-  request.setUrl(downloadUrl);
+  request.setUrl(m_DownloadUrl);
+  request.setRawHeader("Range", "bytes=0-0");
+  request.setRawHeader("Accept-Encoding", "identity");
+
+  sendRequest(
+      HTRequestScheduler::Lane::MetaData, [this, request]() { return getConnection()->get(request); }, [this](QNetworkReply* reply) { onProbeResponse(reply); });
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::onProbeResponse(QNetworkReply* reply)
+{
+  // Expect "Content-Range: bytes 0-0/<total>" on a 206 response
+  qint64 totalSize = -1;
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if(reply->error() == QNetworkReply::NoError && statusCode == 206)
+  {
+    static const QRegularExpression contentRangeExpr("^bytes\\s+\\d+-\\d+/(\\d+)$");
+    QRegularExpressionMatch match = contentRangeExpr.match(QString::fromLatin1(reply->rawHeader("Content-Range")).trimmed());
+    if(match.hasMatch())
+    {
+      totalSize = match.captured(1).toLongLong();
+    }
+  }
+
+  if(totalSize > 0)
+  {
+    startRangedDownload(totalSize);
+  }
+  else
+  {
+    startSingleStream();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::startRangedDownload(qint64 totalSize)
+{
+  qint64 streamCount = totalSize / m_MinSegmentSize;
+  if(streamCount > static_cast<qint64>(m_MaxStreams))
+  {
+    streamCount = static_cast<qint64>(m_MaxStreams);
+  }
+  if(streamCount < 1)
+  {
+    streamCount = 1;
+  }
+
+  // Preallocate so that each stream can write at its own offset
+  m_Generation++;
+  m_TotalSize = totalSize;
+  m_File->resize(totalSize);
+
+  qint64 segmentSize = totalSize / streamCount;
+  m_Segments.assign(static_cast<size_t>(streamCount), Segment());
+  for(qint64 i = 0; i < streamCount; i++)
+  {
+    Segment& segment = m_Segments[static_cast<size_t>(i)];
+    segment.Begin = i * segmentSize;
+    segment.End = (i == streamCount - 1) ? totalSize - 1 : (i + 1) * segmentSize - 1;
+  }
+
+  // Record the file revision before any data arrives so that an interruption can be resumed
+  writeCheckpoint();
+
+  for(size_t i = 0; i < m_Segments.size(); i++)
+  {
+    requestSegment(i);
+  }
+}
 
-  QNetworkReply* reply = getConnection()->get(request);
-  connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &HTDownloadRequest::downloadFailed);
-  connect(reply, &QNetworkReply::downloadProgress, this, &HTDownloadRequest::onDownloadProgress);
-  connect(reply, &QNetworkReply::finished, this, &HTDownloadRequest::onDownloadComplete);
-  connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::startSingleStream()
+{
+  // A single stream without ranges cannot be resumed
+  QFile::remove(getCheckpointFilePath());
+  m_Generation++;
+  m_TotalSize = -1;
+  m_File->resize(0);
+  m_Segments.assign(1, Segment());
+  requestSegment(0);
+}
 
-  waitForResponse(reply);
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::requestSegment(size_t index)
+{
+  // Segments queued before a failure or a fallback to a single stream are dropped when they come up
+  int generation = m_Generation;
+  auto send = [this, index, generation]() -> QNetworkReply* {
+    if(m_Done || generation != m_Generation)
+    {
+      return nullptr;
+    }
+
+    // Retries continue after the bytes already written
+    const Segment& segment = m_Segments[index];
+    QNetworkRequest request = getConnection()->createDefaultNetworkRequest();
+    request.setUrl(m_DownloadUrl);
+    if(segment.End >= 0)
+    {
+      // Byte offsets refer to the stored representation, so ranges must not be content-encoded
+      request.setRawHeader("Range", QString("bytes=%1-%2").arg(segment.Begin + segment.Received).arg(segment.End).toLatin1());
+      request.setRawHeader("Accept-Encoding", "identity");
+    }
+    else if(segment.Received > 0)
+    {
+      // A retried single stream starts over
+      m_Segments[index].Received = 0;
+      m_File->resize(0);
+    }
+
+    QNetworkReply* reply = getConnection()->get(request);
+    m_Segments[index].Reply = reply;
+    // The reply lives on the network thread, so its data is written there as it arrives
+    connect(
+        reply, &QNetworkReply::readyRead, reply,
+        [this, context = getContext(), reply]() {
+          HTRequestScheduler::ContextLocker locker(*context);
+          if(locker.isLocked())
+          {
+            onSegmentReadyRead(reply);
+          }
+        },
+        Qt::DirectConnection);
+    return reply;
+  };
+  sendRequest(HTRequestScheduler::Lane::Transfer, send, [this](QNetworkReply* reply) { onSegmentFinished(reply); });
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void HTDownloadRequest::onDownloadProgress(int64_t bytesReceived, int64_t bytesTotal)
+HTDownloadRequest::Segment* HTDownloadRequest::findSegment(const QNetworkReply* reply)
 {
-  QNetworkReply* reply = dynamic_cast<QNetworkReply*>(sender());
   if(nullptr == reply)
   {
-    throw std::runtime_error("Invalid sender. QNetworkReply required");
+    return nullptr;
+  }
+
+  for(Segment& segment : m_Segments)
+  {
+    if(segment.Reply == reply)
+    {
+      return &segment;
+    }
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::abortSegments()
+{
+  // Queued segments are dropped by the generation check
+  m_Generation++;
+
+  // Stop tracking the replies first. abort() emits finished() synchronously.
+  std::vector<QNetworkReply*> replies;
+  for(Segment& segment : m_Segments)
+  {
+    if(!segment.Reply.isNull())
+    {
+      replies.push_back(segment.Reply);
+      segment.Reply = nullptr;
+    }
+  }
+
+  for(QNetworkReply* reply : replies)
+  {
+    reply->abort();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::onSegmentReadyRead(QNetworkReply* reply)
+{
+  Segment* segment = findSegment(reply);
+  if(nullptr == segment || m_Done)
+  {
+    return;
+  }
+
+  // Error pages are not file content. The scheduler retries or fails the segment when it finishes.
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if(statusCode >= 300)
+  {
+    reply->readAll();
+    return;
+  }
+
+  // A server that ignores the Range header sends the whole file. Start over with a single stream.
+  if(segment->End >= 0 && statusCode != 206)
+  {
+    abortSegments();
+    startSingleStream();
+    return;
+  }
+
+  if(m_TotalSize < 0)
+  {
+    QVariant contentLength = reply->header(QNetworkRequest::ContentLengthHeader);
+    m_TotalSize = contentLength.isValid() ? contentLength.toLongLong() : -1;
   }
 
   // QDataStream::operator<< stringifies the byte data.
   // Use QFile::write(buffer, size) to write bytes instead of string data.
   QByteArray bytes = reply->readAll();
+  m_File->seek(segment->Begin + segment->Received);
   m_File->write(bytes.data(), bytes.size());
+  segment->Received += bytes.size();
+
+  qint64 bytesReceived = 0;
+  for(const Segment& seg : m_Segments)
+  {
+    bytesReceived += seg.Received;
+  }
+  emit downloadProgress(bytesReceived, m_TotalSize);
+
+  if(m_ResumeEnabled && bytesReceived - m_CheckpointedBytes >= k_CheckpointInterval)
+  {
+    writeCheckpoint();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::onSegmentFinished(QNetworkReply* reply)
+{
+  // Aborted replies are no longer tracked
+  Segment* segment = findSegment(reply);
+  if(nullptr == segment || m_Done)
+  {
+    return;
+  }
+
+  // Read anything that arrived with the finished signal
+  if(reply->bytesAvailable() > 0)
+  {
+    onSegmentReadyRead(reply);
+    segment = findSegment(reply);
+    if(nullptr == segment)
+    {
+      return;
+    }
+  }
+  segment->Reply = nullptr;
+  segment->Finished = true;
+
+  if(reply->error() != QNetworkReply::NoError)
+  {
+    failDownload(reply->error());
+    return;
+  }
+  if(segment->End >= 0 && segment->Received != segment->End - segment->Begin + 1)
+  {
+    failDownload(QNetworkReply::ProtocolFailure);
+    return;
+  }
+
+  for(const Segment& seg : m_Segments)
+  {
+    if(!seg.Finished)
+    {
+      return;
+    }
+  }
+
+  onDownloadComplete();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::onCanceled()
+{
+  failDownload(QNetworkReply::OperationCanceledError);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void HTDownloadRequest::failDownload(QNetworkReply::NetworkError err)
+{
+  m_Done = true;
+  abortSegments();
+  writeCheckpoint();
+  m_File->close();
+  m_File->deleteLater();
+  m_File = nullptr;
 
-  emit downloadProgress(bytesReceived, bytesTotal);
+  emit downloadFailed(err);
+  fail(err);
 }
 
 // -----------------------------------------------------------------------------
@@ -147,8 +676,12 @@ void HTDownloadRequest::onDownloadProgress(int64_t bytesReceived, int64_t bytesT
 // -----------------------------------------------------------------------------
 void HTDownloadRequest::onDownloadComplete()
 {
+  m_Done = true;
+  QFile::remove(getCheckpointFilePath());
   m_File->close();
   m_File->deleteLater();
+  m_File = nullptr;
 
   emit downloadComplete();
+  finish();
 }
@@ -35,8 +35,12 @@
 
 #include "HTAbstractRequest.h"
 
+#include <vector>
+
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <QtCore/QUrl>
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfo.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
@@ -44,12 +48,24 @@
 /**
  * @class HTDownloadRequest HTDownloadRequest.h HyperThoughtUtilities/HyperThoughtUtilitiesFilters/util/HTDownloadRequest.h
  * @brief The HTDownloadRequest class is used for creating download requests for a specified HyperThought connection.
+ *
+ * Large files are split into byte ranges that are downloaded over several concurrent streams and written
+ * at their offsets into a preallocated target file. The request falls back to a single stream when the
+ * server does not answer a Range request with 206 Partial Content or the file is too small to split.
+ *
+ * In resume mode, the completed byte ranges of a ranged download are checkpointed to a sidecar file next
+ * to the target. The checkpoint is keyed by the HyperThought file ID and modified date. A later request
+ * for the same unchanged file continues the remaining ranges. The partial file is discarded if the
+ * remote file changed.
  */
 class HyperThoughtUtilities_EXPORT HTDownloadRequest : public HTAbstractRequest
 {
   Q_OBJECT
 
 public:
+  static constexpr size_t k_DefaultMaxStreams = 4;
+  static constexpr qint64 k_DefaultMinSegmentSize = 8 * 1024 * 1024;
+
   /**
    * @brief Constructor
    * @param connection
@@ -99,6 +115,50 @@ public:
    */
   void setDownloadDir(const QDir& dir);
 
+  /**
+   * @brief Returns the maximum number of concurrent range streams used for a single file.
+   * @return
+   */
+  size_t getMaxStreams() const;
+
+  /**
+   * @brief Sets the maximum number of concurrent range streams used for a single file.
+   * A value of 1 always downloads the file over a single stream.
+   * @param count
+   */
+  void setMaxStreams(size_t count);
+
+  /**
+   * @brief Returns the smallest byte range assigned to a single stream.
+   * @return
+   */
+  qint64 getMinSegmentSize() const;
+
+  /**
+   * @brief Sets the smallest byte range assigned to a single stream.
+   * Files smaller than twice this size are downloaded over a single stream.
+   * @param size
+   */
+  void setMinSegmentSize(qint64 size);
+
+  /**
+   * @brief Returns true if interrupted downloads are checkpointed and resumed. Returns false otherwise.
+   * @return
+   */
+  bool isResumeEnabled() const;
+
+  /**
+   * @brief Sets whether interrupted downloads are checkpointed and resumed.
+   * @param enabled
+   */
+  void setResumeEnabled(bool enabled);
+
+  /**
+   * @brief Returns the path of the checkpoint file kept next to the target file while a resumable download is incomplete.
+   * @return
+   */
+  QString getCheckpointFilePath() const;
+
   /**
    * @brief Performs the approriate request over the connection.
    * Emits the appropriate signals as the request is completed.
@@ -125,13 +185,113 @@ signals:
    */
   void downloadFailed(QNetworkReply::NetworkError err);
 
+protected:
+  /**
+   * @brief Aborts the streams, keeps the checkpoint, and emits downloadFailed() and requestFailed().
+   */
+  void onCanceled() override;
+
 private:
+  static constexpr qint64 k_CheckpointInterval = 16 * 1024 * 1024;
+
   /**
-   * @brief Load bytes received into the target file and emit the downloadProgress signal.
-   * @param bytesReceived
-   * @param bytesTotal
+   * @brief Byte range downloaded by a single stream. End is inclusive and is -1 for
+   * a single stream without a Range header.
+   */
+  struct Segment
+  {
+    qint64 Begin = 0;
+    qint64 End = -1;
+    qint64 Received = 0;
+    QPointer<QNetworkReply> Reply;
+    bool Finished = false;
+  };
+
+  /**
+   * @brief Returns the path of the local target file.
+   * @return
+   */
+  QString getTargetFilePath() const;
+
+  /**
+   * @brief Restores the segments from the checkpoint file if it matches the requested file ID,
+   * modified date, and the size of the partial target file. Returns true if the download can be resumed.
+   * @return
+   */
+  bool readCheckpoint();
+
+  /**
+   * @brief Flushes the target file and writes the received byte ranges to the checkpoint file.
+   * Does nothing unless a resumable ranged download is in progress.
+   */
+  void writeCheckpoint();
+
+  /**
+   * @brief Requests every segment restored from the checkpoint that has not been fully received.
+   */
+  void resumeSegments();
+
+  /**
+   * @brief Requests the first byte of the file to check if the server supports Range requests
+   * and to find the total file size. Calls onProbeResponse(QNetworkReply*) when completed.
+   */
+  void probeRangeSupport();
+
+  /**
+   * @brief Starts the ranged download if the probe returned 206 Partial Content with the total size.
+   * Falls back to a single stream otherwise.
+   * @param reply
+   */
+  void onProbeResponse(QNetworkReply* reply);
+
+  /**
+   * @brief Preallocates the target file and splits the download into concurrent byte ranges.
+   * @param totalSize
+   */
+  void startRangedDownload(qint64 totalSize);
+
+  /**
+   * @brief Downloads the whole file over a single stream without a Range header.
+   */
+  void startSingleStream();
+
+  /**
+   * @brief Queues the GET request for the segment at the given index on the transfer lane.
+   * @param index
+   */
+  void requestSegment(size_t index);
+
+  /**
+   * @brief Returns the segment downloaded by the given reply or nullptr if the reply is no longer tracked.
+   * @param reply
+   * @return
+   */
+  Segment* findSegment(const QNetworkReply* reply);
+
+  /**
+   * @brief Aborts every segment still in flight and drops the segments still queued.
+   */
+  void abortSegments();
+
+  /**
+   * @brief Writes the bytes received by a segment at its offset in the target file and
+   * emits the downloadProgress signal.
+   * @param reply
+   */
+  void onSegmentReadyRead(QNetworkReply* reply);
+
+  /**
+   * @brief Called when a segment reply finishes. Completes the download once every segment
+   * has been received and fails the download if any segment failed.
+   * @param reply
+   */
+  void onSegmentFinished(QNetworkReply* reply);
+
+  /**
+   * @brief Closes the target file, aborts remaining segments, and emits downloadFailed and requestFailed.
+   * @param err
    */
-  void onDownloadProgress(int64_t bytesReceived, int64_t bytesTotal);
+  void failDownload(QNetworkReply::NetworkError err);
 
   /**
    * @brief Closes and deletes the target file before emitting the downloadComplete signal.
@@ -145,4 +305,13 @@ private:
   QString m_DownloadName;
   QDir m_DownloadDir;
   QFile* m_File = nullptr;
+  QUrl m_DownloadUrl;
+  size_t m_MaxStreams = k_DefaultMaxStreams;
+  qint64 m_MinSegmentSize = k_DefaultMinSegmentSize;
+  std::vector<Segment> m_Segments;
+  qint64 m_TotalSize = -1;
+  int m_Generation = 0;
+  bool m_Done = false;
+  bool m_ResumeEnabled = false;
+  qint64 m_CheckpointedBytes = 0;
 };
@@ -33,6 +33,9 @@
 
 #include "HTFileInfoRequest.h"
 
+#include <algorithm>
+
+#include <QtCore/QMetaMethod>
 #include <QtCore/QUrlQuery>
 
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
@@ -45,7 +48,10 @@ HTFileInfoRequest::HTFileInfoRequest(HTConnection* connection, const HTFilePath&
 }
 
 // -----------------------------------------------------------------------------
-HTFileInfoRequest::~HTFileInfoRequest() = default;
+HTFileInfoRequest::~HTFileInfoRequest()
+{
+  releaseContext();
+}
 
 // -----------------------------------------------------------------------------
 HTFilePath HTFileInfoRequest::getFilePath() const
@@ -60,132 +66,284 @@ void HTFileInfoRequest::setFilePath(const HTFilePath& filePath)
 }
 
 // -----------------------------------------------------------------------------
-void HTFileInfoRequest::exec()
+size_t HTFileInfoRequest::getMaxConcurrentRequests() const
+{
+  return m_MaxConcurrentRequests;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoRequest::setMaxConcurrentRequests(size_t count)
 {
-  m_RecursiveSearch.FileTree.clear();
-  m_RecursiveSearch.FilePath = getFilePath();
+  m_MaxConcurrentRequests = std::max<size_t>(count, 1);
+}
 
-  requestAdditionalFileInfoItems(m_RecursiveSearch.FilePath);
+// -----------------------------------------------------------------------------
+int HTFileInfoRequest::getPageSize() const
+{
+  return m_PageSize;
 }
 
 // -----------------------------------------------------------------------------
-void HTFileInfoRequest::requestAdditionalFileInfoItems(const HTFilePath& filePath)
+void HTFileInfoRequest::setPageSize(int pageSize)
 {
-  m_RecursiveSearch.RemainingItems++;
-  requestFileInfo(getFileListRequest(filePath));
+  m_PageSize = std::max(pageSize, 0);
 }
 
 // -----------------------------------------------------------------------------
-void HTFileInfoRequest::requestFileInfo(const QNetworkRequest& request)
+bool HTFileInfoRequest::isRecursive() const
 {
-  QNetworkReply* reply = getConnection()->get(request);
-  connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &HTFileInfoRequest::requestFailed);
-  connect(reply, &QNetworkReply::finished, this, &HTFileInfoRequest::onFileInfoResponse);
+  return m_Recursive;
+}
 
-  // Required for running during execute.
-  waitForResponse(reply);
+// -----------------------------------------------------------------------------
+void HTFileInfoRequest::setRecursive(bool recursive)
+{
+  m_Recursive = recursive;
 }
 
 // -----------------------------------------------------------------------------
-QNetworkRequest HTFileInfoRequest::getFileListRequest(const HTFilePath& path)
+void HTFileInfoRequest::exec()
 {
-  switch(path.getScopeType())
-  {
-  case HTFilePath::ScopeType::User:
-    return createUserFileInfoRequest(path.getPath());
-    break;
-  case HTFilePath::ScopeType::Group:
-    return createFileInfoRequest(path.getPath(), "group", path.getSourceId());
-    break;
-  case HTFilePath::ScopeType::Project:
-    return createFileInfoRequest(path.getPath(), "project", path.getSourceId());
-  }
+  // The crawl state is only touched on the network thread
+  runOnNetworkThread([this]() {
+    m_RecursiveSearch.FileTree.clear();
+    m_RecursiveSearch.CachedValidators = getConnection()->getFileCacheRef().getListingValidators(getFilePath());
+    m_RecursiveSearch.Validators.clear();
+    m_RecursiveSearch.PendingFolders.clear();
+    m_RecursiveSearch.ActiveRequests = 0;
+    m_RecursiveSearch.Failed = false;
+
+    queueFolder(getFilePath());
+    requestQueuedFolders();
+  });
 
-  // throw std::exception("Invalid HTFilePath: Unrecognized ScopeType");
-  return QNetworkRequest();
+  // Synchronous requests wait for the whole crawl instead of each folder listing.
+  waitForFinished();
 }
 
 // -----------------------------------------------------------------------------
-QNetworkRequest HTFileInfoRequest::createUserFileInfoRequest(const QString& path) const
+void HTFileInfoRequest::queueFolder(const HTFilePath& folderPath)
 {
-  QString filePath = path.isEmpty() ? "," : path;
-  QUrlQuery query;
-  query.addQueryItem("path", filePath.toUtf8());
-  query.addQueryItem("method", "user");
+  m_RecursiveSearch.PendingFolders.push_back(folderPath);
+}
 
-  QUrl fileApiUrl(getFilesApiUrl());
-  fileApiUrl.setQuery(query);
+// -----------------------------------------------------------------------------
+void HTFileInfoRequest::requestQueuedFolders()
+{
+  while(m_RecursiveSearch.ActiveRequests < m_MaxConcurrentRequests && !m_RecursiveSearch.PendingFolders.empty())
+  {
+    HTFilePath folderPath = m_RecursiveSearch.PendingFolders.front();
+    m_RecursiveSearch.PendingFolders.pop_front();
 
-  QNetworkRequest request = getConnection()->createDefaultNetworkRequest();
-  request.setUrl(fileApiUrl);
-  return request;
+    m_RecursiveSearch.ActiveRequests++;
+    requestFileInfo(folderPath);
+  }
 }
 
 // -----------------------------------------------------------------------------
-QNetworkRequest HTFileInfoRequest::createFileInfoRequest(const QString& path, const QString& method, const QString& pk)
+void HTFileInfoRequest::requestFileInfo(const HTFilePath& folderPath, bool conditional)
 {
-  QString filePath = path.isEmpty() ? "," : path;
-  QUrlQuery query;
-  query.addQueryItem(method, pk.toUtf8());
-  query.addQueryItem("path", filePath.toUtf8());
-  query.addQueryItem("method", method);
+  QNetworkRequest request = createFileListRequest(folderPath);
+  if(m_PageSize > 0)
+  {
+    QUrl url = request.url();
+    QUrlQuery query(url);
+    query.addQueryItem("page_size", QString::number(m_PageSize));
+    url.setQuery(query);
+    request.setUrl(url);
+  }
+
+  // The server answers 304 Not Modified if the listing still matches the cached one
+  auto validators = m_RecursiveSearch.CachedValidators.find(request.url().toString());
+  if(conditional && validators != m_RecursiveSearch.CachedValidators.end())
+  {
+    if(!validators->second.eTag.isEmpty())
+    {
+      request.setRawHeader("If-None-Match", validators->second.eTag);
+    }
+    if(!validators->second.lastModified.isEmpty())
+    {
+      request.setRawHeader("If-Modified-Since", validators->second.lastModified);
+    }
+  }
 
-  QUrl fileApiUrl(getFilesApiUrl());
-  fileApiUrl.setQuery(query);
+  // Other requests crawling the same folder at the same time share the listing
+  sendSharedGetRequest(request, [this, folderPath](QNetworkReply* reply) { onFileInfoResponse(reply, folderPath, true); });
+}
 
-  QNetworkRequest request = getConnection()->createDefaultNetworkRequest();
-  request.setUrl(fileApiUrl);
-  return request;
+// -----------------------------------------------------------------------------
+void HTFileInfoRequest::requestNextPage(const HTFilePath& folderPath, const QUrl& pageUrl)
+{
+  QNetworkRequest request = createFileListRequest(folderPath);
+  request.setUrl(pageUrl);
+  sendSharedGetRequest(request, [this, folderPath](QNetworkReply* reply) { onFileInfoResponse(reply, folderPath, false); });
 }
 
 // -----------------------------------------------------------------------------
-void HTFileInfoRequest::onFileInfoResponse()
+void HTFileInfoRequest::onFileInfoResponse(QNetworkReply* reply, const HTFilePath& folderPath, bool firstPage)
 {
-  QNetworkReply* reply = dynamic_cast<QNetworkReply*>(sender());
-  if(nullptr == reply)
+  // Listings still in flight after a failure are discarded
+  if(m_RecursiveSearch.Failed)
   {
-    throw std::runtime_error("Invalid sender. QNetworkReply required");
+    m_RecursiveSearch.ActiveRequests--;
+    return;
   }
 
-  if(reply->error() <= 0)
+  if(reply->error() > 0)
+  {
+    m_RecursiveSearch.ActiveRequests--;
+    m_RecursiveSearch.Failed = true;
+    m_RecursiveSearch.PendingFolders.clear();
+    fail(reply->error());
+    return;
+  }
+
+  const QString url = reply->request().url().toString();
+  std::vector<HTFileInfo> files;
+  QUrl nextPageUrl;
+  if(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
+  {
+    // An unchanged listing reuses the cached children without parsing anything.
+    // The cached tree may not hold the folder anymore, so ask again for the full listing.
+    if(!getConnection()->getFileCacheRef().getFolderContents(folderPath, files))
+    {
+      requestFileInfo(folderPath, false);
+      return;
+    }
+    m_RecursiveSearch.Validators[url] = m_RecursiveSearch.CachedValidators[url];
+  }
+  else
   {
+    // Parsing an encoded body would look like an empty folder
+    if(!IsBodyDecoded(reply))
+    {
+      m_RecursiveSearch.ActiveRequests--;
+      m_RecursiveSearch.Failed = true;
+      m_RecursiveSearch.PendingFolders.clear();
+      fail(QNetworkReply::UnknownContentError);
+      return;
+    }
+
+    // Only one page of a large folder is held in memory at a time
     QByteArray response = reply->readAll();
     QJsonDocument doc = QJsonDocument::fromJson(response);
-    std::vector<HTFileInfo> files = HTFileInfo::FromDocument(doc);
+    response.clear();
+    files = HTFileInfo::FromDocument(doc);
+    nextPageUrl = HTFileInfo::NextPageUrl(doc);
+    if(!nextPageUrl.isEmpty())
+    {
+      nextPageUrl = reply->url().resolved(nextPageUrl);
+    }
 
-    // Copy files into recursive search object and check isTopLevel state.
-    m_RecursiveSearch.FileTree.insert(files);
+    // Page links come from the response, so the access token is not sent to a link to another origin
+    if(!nextPageUrl.isEmpty() && !getConnection()->isServerUrl(nextPageUrl))
+    {
+      m_RecursiveSearch.ActiveRequests--;
+      m_RecursiveSearch.Failed = true;
+      m_RecursiveSearch.PendingFolders.clear();
+      fail(QNetworkReply::InsecureRedirectError);
+      return;
+    }
 
-    // Recursively search folders for additional files
-    for(const auto& file : files)
+    // The validators of a paged listing only describe its first page, so those are not kept
+    HTFileCache::ListingValidators validators;
+    validators.eTag = reply->rawHeader("ETag");
+    validators.lastModified = reply->rawHeader("Last-Modified");
+    if(firstPage && nextPageUrl.isEmpty() && (!validators.eTag.isEmpty() || !validators.lastModified.isEmpty()))
     {
-      if(file.isDir())
-      {
-        QString newPath = file.getContent().path + file.getContent().pk + ",";
-        m_RecursiveSearch.FilePath.setPath(newPath);
-        requestAdditionalFileInfoItems(m_RecursiveSearch.FilePath);
-      }
+      m_RecursiveSearch.Validators[url] = validators;
     }
+  }
 
-    m_RecursiveSearch.RemainingItems--;
+  // Copy files into recursive search object
+  m_RecursiveSearch.FileTree.insert(files);
+  emitPage(folderPath, files);
 
-    // Only emit the fileInfoReceived signal once
-    if(m_RecursiveSearch.RemainingItems == 0)
+  // Queue child folders behind the folders already waiting
+  for(const auto& file : files)
+  {
+    if(m_Recursive && file.isDir())
     {
-      onRequestCompleted();
+      HTFilePath childPath = getFilePath();
+      childPath.setPath(file.getContent().path + file.getContent().pk + ",");
+      queueFolder(childPath);
     }
   }
-  reply->deleteLater();
+
+  // The folder keeps its slot until its last page has been received
+  if(!nextPageUrl.isEmpty())
+  {
+    requestNextPage(folderPath, nextPageUrl);
+  }
+  else
+  {
+    m_RecursiveSearch.ActiveRequests--;
+  }
+
+  // Only emit the infoReceived signal once
+  if(m_RecursiveSearch.ActiveRequests == 0 && m_RecursiveSearch.PendingFolders.empty())
+  {
+    onRequestCompleted();
+    return;
+  }
+
+  requestQueuedFolders();
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoRequest::emitPage(const HTFilePath& folderPath, const std::vector<HTFileInfo>& files)
+{
+  // Building the page's tree is skipped unless someone shows the results progressively
+  static const QMetaMethod pageSignal = QMetaMethod::fromSignal(&HTFileInfoRequest::pageReceived);
+  if(files.empty() || !isSignalConnected(pageSignal))
+  {
+    return;
+  }
+
+  auto page = std::make_shared<HTFileInfoTree>();
+  for(const auto& file : files)
+  {
+    page->insert(file);
+  }
+  page->sort();
+  emit pageReceived(folderPath, page);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileInfoRequest::onCanceled()
+{
+  m_RecursiveSearch.Failed = true;
+  m_RecursiveSearch.PendingFolders.clear();
+  fail(QNetworkReply::OperationCanceledError);
 }
 
 // -----------------------------------------------------------------------------
 void HTFileInfoRequest::onRequestCompleted()
 {
   // Update file info cache
-  HTFileInfoTree infoTree = m_RecursiveSearch.FileTree;
-  infoTree.sort();
-  getConnection()->getFileCacheRef().setFileInfoTree(getFilePath(), infoTree);
+  auto infoTree = std::make_shared<HTFileInfoTree>(std::move(m_RecursiveSearch.FileTree));
+  infoTree->sort();
+
+  // Only the listed folder is replaced in the cached tree. Single folder listings, such as the ones
+  // browsed in the file widgets, update its direct children so preflight can find them.
+  HTFileCache& cache = getConnection()->getFileCacheRef();
+  HTFileInfoTree::ChangeSet changes;
+  if(cache.mergeFolder(getFilePath(), *infoTree, m_RecursiveSearch.Validators, changes, m_Recursive))
+  {
+    // Holding the scope's tree makes the next merge copy it, so it is only taken for someone who listens
+    static const QMetaMethod cacheSignal = QMetaMethod::fromSignal(&HTFileInfoRequest::cacheChanged);
+    if(!changes.isEmpty() && isSignalConnected(cacheSignal))
+    {
+      emit cacheChanged(cache.getFileInfoTree(getFilePath()), changes);
+    }
+  }
+  else if(getFilePath().getPath().split(',', QString::SkipEmptyParts).isEmpty())
+  {
+    cache.setFileInfoTree(getFilePath(), infoTree, m_RecursiveSearch.Validators);
+  }
+  m_RecursiveSearch.CachedValidators.clear();
 
   // Emit the requested information
   emit infoReceived(infoTree);
+  finish();
 }
@@ -35,6 +35,9 @@
 
 #include "HTAbstractRequest.h"
 
+#include <deque>
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFileCache.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
 
@@ -43,6 +46,8 @@ class HyperThoughtUtilities_EXPORT HTFileInfoRequest : public HTAbstractRequest
   Q_OBJECT
 
 public:
+  static constexpr size_t k_DefaultMaxConcurrentRequests = 8;
+
   HTFileInfoRequest(HTConnection* connection, const HTFilePath& path, bool isAsync = false);
   ~HTFileInfoRequest() override;
 
@@ -54,10 +59,57 @@ public:
 
   /**
    * @brief Sets the HyperThought file path to recursively request file info from.
+   * Crawling a folder below the scope root refreshes that folder in the cached tree without
+   * listing the rest of the scope.
    * @param filePath
    */
   void setFilePath(const HTFilePath& filePath);
 
+  /**
+   * @brief Returns the maximum number of folder listings that may be in flight at once.
+   * @return
+   */
+  size_t getMaxConcurrentRequests() const;
+
+  /**
+   * @brief Sets the maximum number of folder listings that may be in flight at once.
+   * Folders are crawled breadth-first and queued until a slot becomes available.
+   * Values less than 1 are treated as 1.
+   * @param count
+   */
+  void setMaxConcurrentRequests(size_t count);
+
+  /**
+   * @brief Returns the number of items requested per page of a folder listing.
+   * Zero leaves the page size to the server.
+   * @return
+   */
+  int getPageSize() const;
+
+  /**
+   * @brief Sets the number of items requested per page of a folder listing. Paged listings are
+   * followed page by page whatever the page size, and each page is added to the tree and emitted
+   * with pageReceived() before the next one is requested. Values less than 1 leave the page size
+   * to the server.
+   * @param pageSize
+   */
+  void setPageSize(int pageSize);
+
+  /**
+   * @brief Returns true if the request crawls every folder below the file path. Returns false if it
+   * only lists the folder at the file path.
+   * @return
+   */
+  bool isRecursive() const;
+
+  /**
+   * @brief Sets whether the request crawls every folder below the file path or only lists the folder
+   * at the file path. Single folder listings are still revalidated against the cached tree, and only
+   * update the folder's direct children in it.
+   * @param recursive
+   */
+  void setRecursive(bool recursive);
+
   /**
    * @brief Performs the approriate request over the connection.
    * Emits the appropriate signals as the request is completed.
@@ -66,55 +118,80 @@ public:
   void exec() override;
 
 signals:
-  void infoReceived(const HTFileInfoTree& fileInfoTree);
+  void infoReceived(HTFileInfoTree::ConstPointer fileInfoTree);
 
-private:
   /**
-   * @brief Uses the given QNetworkRequest to request files from the HyperThought server.
-   * Connects the appropriate signals and slots.
-   * @param request
+   * @brief This signal is emitted for every page of a folder listing as it arrives, so large folders
+   * can be shown before the whole listing has been received. Listings that are not paged are emitted
+   * as a single page. Empty pages are not emitted.
+   * @param folderPath The listed folder.
+   * @param page A tree whose root holds the items of the page.
    */
-  void requestFileInfo(const QNetworkRequest& request);
+  void pageReceived(HTFilePath folderPath, HTFileInfoTree::ConstPointer page);
 
   /**
-   * @brief Recursive helper method for requesting HTFileInfo items from HyperThought.
-   * @param filePath
+   * @brief This signal is emitted before infoReceived() when the listing changed the cached tree of
+   * its scope. Listings of a folder below the scope root are merged into the cached tree, so only
+   * the items of that folder are reported. It is not emitted when the listing creates the cached tree.
+   * @param scopeTree The cached tree after the crawl.
+   * @param changes
    */
-  void requestAdditionalFileInfoItems(const HTFilePath& filePath);
+  void cacheChanged(HTFileInfoTree::ConstPointer scopeTree, HTFileInfoTree::ChangeSet changes);
 
+protected:
   /**
-   * @brief Creates a QNetworkRequest for the specified HTFilePath.
-   * @param path
-   * @return
+   * @brief Discards the folders still waiting to be listed and emits requestFailed().
    */
-  QNetworkRequest getFileListRequest(const HTFilePath& path);
+  void onCanceled() override;
 
+private:
   /**
-   * @brief Creates and returns a QNetworkRequest for the given path and project.
-   * @param path
-   * @return
+   * @brief Requests the listing of the given folder from the HyperThought server.
+   * Conditional requests send the validators cached for the listing, if any.
+   * @param folderPath
+   * @param conditional
    */
-  QNetworkRequest createUserFileInfoRequest(const QString& path) const;
+  void requestFileInfo(const HTFilePath& folderPath, bool conditional = true);
 
   /**
-   * @brief Creates and returns a QNetworkRequest for the given path, method, and pk.
-   * This can be used for both project and group methods.
-   * @param path
-   * @param method
-   * @param pk
+   * @brief Requests the next page of the given folder's listing.
+   * @param folderPath
+   * @param pageUrl
    */
-  QNetworkRequest createFileInfoRequest(const QString& path, const QString& method, const QString& pk);
+  void requestNextPage(const HTFilePath& folderPath, const QUrl& pageUrl);
+
+  /**
+   * @brief Adds the given folder to the back of the breadth-first work queue.
+   * @param folderPath
+   */
+  void queueFolder(const HTFilePath& folderPath);
+
+  /**
+   * @brief Requests queued folders until the concurrency window is full or the queue is empty.
+   */
+  void requestQueuedFolders();
 
   /**
    * @brief Handles responses from any of the recursive requests for file info.
    * Emits infoReceived when the last request has been completed.
+   * @param reply
+   * @param folderPath
+   * @param firstPage
+   */
+  void onFileInfoResponse(QNetworkReply* reply, const HTFilePath& folderPath, bool firstPage);
+
+  /**
+   * @brief Emits pageReceived for the given items of the folder if the signal is connected.
+   * @param folderPath
+   * @param files
    */
-  void onFileInfoResponse();
+  void emitPage(const HTFilePath& folderPath, const std::vector<HTFileInfo>& files);
 
   /**
    * @brief Called when the last recursive response has been received.
-   * Inserts the HTFileInfoTree requested into the HyperThought file info cache
-   * and emits the infoReceived signal.
+   * Merges the HTFileInfoTree requested into the HyperThought file info cache and emits the
+   * cacheChanged and infoReceived signals. A listing of the scope root creates the cached tree if
+   * there is none to merge into. Listings of folders that are not cached yet are only emitted.
    */
   void onRequestCompleted();
 
@@ -123,10 +200,16 @@ private:
   struct FileInfoSearch
   {
     HTFileInfoTree FileTree;
-    HTFilePath FilePath;
-    size_t RemainingItems = 0;
+    HTFileCache::ValidatorMap CachedValidators;
+    HTFileCache::ValidatorMap Validators;
+    std::deque<HTFilePath> PendingFolders;
+    size_t ActiveRequests = 0;
+    bool Failed = false;
   };
 
   HTFilePath m_Path;
+  size_t m_MaxConcurrentRequests = k_DefaultMaxConcurrentRequests;
+  int m_PageSize = 0;
+  bool m_Recursive = true;
   FileInfoSearch m_RecursiveSearch;
 };
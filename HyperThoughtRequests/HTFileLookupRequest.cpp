@@ -0,0 +1,215 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+
+#include "HTFileLookupRequest.h"
+
+#include <algorithm>
+
+#include <QtCore/QJsonDocument>
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+
+// -----------------------------------------------------------------------------
+HTFileLookupRequest::HTFileLookupRequest(HTConnection* connection, const HTFilePath& path, bool isAsync)
+: HTAbstractRequest(connection, isAsync)
+, m_Path(path)
+{
+}
+
+// -----------------------------------------------------------------------------
+HTFileLookupRequest::~HTFileLookupRequest()
+{
+  releaseContext();
+}
+
+// -----------------------------------------------------------------------------
+HTFilePath HTFileLookupRequest::getFilePath() const
+{
+  return m_Path;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileLookupRequest::setFilePath(const HTFilePath& filePath)
+{
+  m_Path = filePath;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfo HTFileLookupRequest::getFileInfo() const
+{
+  return m_FileInfo;
+}
+
+// -----------------------------------------------------------------------------
+void HTFileLookupRequest::exec()
+{
+  // The lookup state is only touched on the network thread
+  runOnNetworkThread([this]() {
+    m_FileInfo = HTFileInfo();
+    m_Lookup.Ids = getFilePath().getPath().split(',', QString::SkipEmptyParts);
+    m_Lookup.Items.assign(static_cast<size_t>(m_Lookup.Ids.size()), HTFileInfo());
+    m_Lookup.ActiveRequests = 0;
+    m_Lookup.Failed = false;
+
+    // Each item on the path is found in the listing of the folder above it
+    HTFileInfoTree::ConstPointer cachedTree = getConnection()->getFileCacheRef().getFileInfoTree(getFilePath());
+    std::vector<HTFilePath> folderPaths;
+    std::vector<int> depths;
+    HTFilePath folderPath = getFilePath();
+    folderPath.setPath(",");
+    for(int depth = 0; depth < m_Lookup.Ids.size(); depth++)
+    {
+      HTFilePath itemPath = folderPath;
+      itemPath.setPath(folderPath.getPath() + m_Lookup.Ids[depth] + ",");
+
+      const HTFileInfoTree::Node* cachedNode = (nullptr != cachedTree) ? cachedTree->findNode(itemPath) : nullptr;
+      if(nullptr != cachedNode)
+      {
+        m_Lookup.Items[depth] = cachedNode->fileInfo;
+      }
+      else
+      {
+        folderPaths.push_back(folderPath);
+        depths.push_back(depth);
+      }
+      folderPath = itemPath;
+    }
+
+    if(folderPaths.empty())
+    {
+      onRequestCompleted();
+      return;
+    }
+
+    m_Lookup.ActiveRequests = folderPaths.size();
+    for(size_t i = 0; i < folderPaths.size(); i++)
+    {
+      const int depth = depths[i];
+      sendSharedGetRequest(createFileListRequest(folderPaths[i]), [this, depth](QNetworkReply* reply) { onListingResponse(reply, depth); });
+    }
+  });
+
+  // Synchronous requests wait for every listing instead of each one.
+  waitForFinished();
+}
+
+// -----------------------------------------------------------------------------
+void HTFileLookupRequest::onListingResponse(QNetworkReply* reply, int depth)
+{
+  m_Lookup.ActiveRequests--;
+
+  // Listings still in flight after a failure are discarded
+  if(m_Lookup.Failed)
+  {
+    return;
+  }
+
+  if(reply->error() > 0)
+  {
+    failLookup(reply->error());
+    return;
+  }
+
+  // Parsing an encoded body would look like an empty folder
+  if(!IsBodyDecoded(reply))
+  {
+    failLookup(QNetworkReply::UnknownContentError);
+    return;
+  }
+
+  const QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+  const std::vector<HTFileInfo> files = HTFileInfo::FromDocument(doc);
+  const QString& id = m_Lookup.Ids[depth];
+  auto iter = std::find_if(files.begin(), files.end(), [&id](const HTFileInfo& file) { return file.getId() == id; });
+  if(iter == files.end())
+  {
+    // Paged listings are searched one page at a time
+    const QUrl nextPageUrl = HTFileInfo::NextPageUrl(doc);
+    if(nextPageUrl.isEmpty())
+    {
+      failLookup(QNetworkReply::ContentNotFoundError);
+      return;
+    }
+
+    // Page links come from the response, so the access token is not sent to a link to another origin
+    const QUrl pageUrl = reply->url().resolved(nextPageUrl);
+    if(!getConnection()->isServerUrl(pageUrl))
+    {
+      failLookup(QNetworkReply::InsecureRedirectError);
+      return;
+    }
+
+    QNetworkRequest request = reply->request();
+    request.setUrl(pageUrl);
+    m_Lookup.ActiveRequests++;
+    sendSharedGetRequest(request, [this, depth](QNetworkReply* pageReply) { onListingResponse(pageReply, depth); });
+    return;
+  }
+  m_Lookup.Items[depth] = *iter;
+
+  if(m_Lookup.ActiveRequests == 0)
+  {
+    onRequestCompleted();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTFileLookupRequest::failLookup(QNetworkReply::NetworkError err)
+{
+  m_Lookup.Failed = true;
+
+  // Synchronous callers wake up on the failure, so the listings still in flight are dropped first
+  getConnection()->getScheduler()->cancel(getContext());
+  fail(err);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileLookupRequest::onCanceled()
+{
+  failLookup(QNetworkReply::OperationCanceledError);
+}
+
+// -----------------------------------------------------------------------------
+void HTFileLookupRequest::onRequestCompleted()
+{
+  // Ancestors come first, so every item is inserted below its parent
+  getConnection()->getFileCacheRef().addFileInfo(getFilePath(), m_Lookup.Items);
+  if(!m_Lookup.Items.empty())
+  {
+    m_FileInfo = m_Lookup.Items.back();
+  }
+
+  emit infoReceived(m_FileInfo);
+  finish();
+}
@@ -0,0 +1,132 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+
+#pragma once
+
+#include "HTAbstractRequest.h"
+
+#include <vector>
+
+#include <QtCore/QStringList>
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfo.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFilePath.h"
+
+/**
+ * @class HTFileLookupRequest HTFileLookupRequest.h HyperThoughtUtilities/HyperThoughtRequests/HTFileLookupRequest.h
+ * @brief The HTFileLookupRequest class looks up the file info of a single item without crawling its scope.
+ * The file path holds the ID of every folder above the item, so the listings of the folders along the
+ * path are requested at once instead of one level at a time. Folders whose child on the path is already
+ * cached are not listed again. Paged listings are followed until the item's page has been received.
+ *
+ * The item and its ancestor folders are added to the HTFileCache, which is enough for filters to validate
+ * a path stored in a pipeline. The request fails with QNetworkReply::ContentNotFoundError if an item on the
+ * path is not in its parent's listing.
+ */
+class HyperThoughtUtilities_EXPORT HTFileLookupRequest : public HTAbstractRequest
+{
+  Q_OBJECT
+
+public:
+  HTFileLookupRequest(HTConnection* connection, const HTFilePath& path, bool isAsync = false);
+  ~HTFileLookupRequest() override;
+
+  /**
+   * @brief Returns the HyperThought file path to look up.
+   * @return
+   */
+  HTFilePath getFilePath() const;
+
+  /**
+   * @brief Sets the HyperThought file path to look up.
+   * @param filePath
+   */
+  void setFilePath(const HTFilePath& filePath);
+
+  /**
+   * @brief Returns the file info found by the last lookup. Only valid once the request has finished.
+   * @return
+   */
+  HTFileInfo getFileInfo() const;
+
+  /**
+   * @brief Performs the approriate request over the connection.
+   * Emits the appropriate signals as the request is completed.
+   * @return
+   */
+  void exec() override;
+
+signals:
+  void infoReceived(HTFileInfo fileInfo);
+
+protected:
+  /**
+   * @brief Discards the listings still in flight and emits requestFailed().
+   */
+  void onCanceled() override;
+
+private:
+  /**
+   * @brief Handles the listing of the folder above the item at the given depth of the path.
+   * @param reply
+   * @param depth
+   */
+  void onListingResponse(QNetworkReply* reply, int depth);
+
+  /**
+   * @brief Cancels the listings still in flight and emits requestFailed().
+   * @param err
+   */
+  void failLookup(QNetworkReply::NetworkError err);
+
+  /**
+   * @brief Called when the last listing has been received.
+   * Adds the items along the path to the HyperThought file info cache and emits infoReceived.
+   */
+  void onRequestCompleted();
+
+  // -----------------------------------------------------------------------------
+  // Variables
+  struct FileInfoLookup
+  {
+    QStringList Ids;
+    std::vector<HTFileInfo> Items;
+    size_t ActiveRequests = 0;
+    bool Failed = false;
+  };
+
+  HTFilePath m_Path;
+  HTFileInfo m_FileInfo;
+  FileInfoLookup m_Lookup;
+};
@@ -43,7 +43,10 @@ HTFileUploadRequest::HTFileUploadRequest(HTConnection* connection, const HTFileP
 }
 
 // -----------------------------------------------------------------------------
-HTFileUploadRequest::~HTFileUploadRequest() = default;
+HTFileUploadRequest::~HTFileUploadRequest()
+{
+  releaseContext();
+}
 
 // -----------------------------------------------------------------------------
 QString HTFileUploadRequest::getUploadName() const
@@ -56,4 +59,8 @@ QString HTFileUploadRequest::getUploadName() const
 void HTFileUploadRequest::exec()
 {
   initFileUpload(getUploadPath(), m_LocalFilePath);
+
+  // Synchronous requests wait for the whole upload chain instead of each reply.
+  // A file that cannot be read has already failed the request.
+  waitForFinished();
 }
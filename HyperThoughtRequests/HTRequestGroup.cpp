@@ -0,0 +1,319 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "HTRequestGroup.h"
+
+#include <algorithm>
+
+#include <QtCore/QMutexLocker>
+
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTAbstractRequest.h"
+
+// -----------------------------------------------------------------------------
+HTRequestGroup::HTRequestGroup(size_t maxConcurrent, QObject* parent)
+: QObject(parent)
+, m_MaxConcurrent(maxConcurrent > 0 ? maxConcurrent : 1)
+{
+}
+
+// -----------------------------------------------------------------------------
+HTRequestGroup::~HTRequestGroup()
+{
+  {
+    QMutexLocker locker(&m_Mutex);
+    m_Destroying = true;
+  }
+  cancel();
+
+  // Running requests still call back into the group until they have stopped
+  {
+    QMutexLocker locker(&m_Mutex);
+    while(m_Started && !m_Settled)
+    {
+      m_WaitCondition.wait(&m_Mutex);
+    }
+  }
+
+  for(HTAbstractRequest* request : m_Requests)
+  {
+    request->deleteLater();
+  }
+}
+
+// -----------------------------------------------------------------------------
+size_t HTRequestGroup::getMaxConcurrent() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_MaxConcurrent;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::setMaxConcurrent(size_t count)
+{
+  QMutexLocker locker(&m_Mutex);
+  m_MaxConcurrent = (count > 0) ? count : 1;
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestGroup::isAsync() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_IsAsync;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::setAsync(bool async)
+{
+  QMutexLocker locker(&m_Mutex);
+  m_IsAsync = async;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::addRequest(HTAbstractRequest* request)
+{
+  // The group waits for its requests, so they never wait for themselves
+  request->setAsync(true);
+  connect(request, &HTAbstractRequest::finished, this, [this, request]() { onRequestFinished(request); }, Qt::DirectConnection);
+  connect(
+      request, &HTAbstractRequest::requestFailed, this, [this, request](QNetworkReply::NetworkError err) { onRequestFailed(request, err); }, Qt::DirectConnection);
+
+  QMutexLocker locker(&m_Mutex);
+  m_Requests.push_back(request);
+  m_Waiting.push_back(request);
+}
+
+// -----------------------------------------------------------------------------
+size_t HTRequestGroup::size() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_Requests.size();
+}
+
+// -----------------------------------------------------------------------------
+size_t HTRequestGroup::getFinishedCount() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_FinishedCount;
+}
+
+// -----------------------------------------------------------------------------
+bool HTRequestGroup::hasFailed() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_Error != QNetworkReply::NoError;
+}
+
+// -----------------------------------------------------------------------------
+QNetworkReply::NetworkError HTRequestGroup::getError() const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_Error;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::exec()
+{
+  {
+    QMutexLocker locker(&m_Mutex);
+    if(m_Started)
+    {
+      return;
+    }
+    m_Started = true;
+  }
+
+  startRequests();
+
+  // Also completes empty groups and groups canceled before they started
+  completeIfDone();
+
+  QMutexLocker locker(&m_Mutex);
+  if(m_IsAsync)
+  {
+    return;
+  }
+  while(!m_Completed)
+  {
+    m_WaitCondition.wait(&m_Mutex);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::cancel()
+{
+  std::vector<HTAbstractRequest*> running;
+  {
+    QMutexLocker locker(&m_Mutex);
+    if(m_Settled || m_Error != QNetworkReply::NoError)
+    {
+      return;
+    }
+    running = failGroup(QNetworkReply::OperationCanceledError);
+  }
+
+  for(HTAbstractRequest* request : running)
+  {
+    request->cancel();
+  }
+  completeIfDone();
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::startRequests()
+{
+  std::vector<HTAbstractRequest*> starting;
+  {
+    QMutexLocker locker(&m_Mutex);
+    while(m_Error == QNetworkReply::NoError && m_Running.size() < m_MaxConcurrent && !m_Waiting.empty())
+    {
+      m_Running.push_back(m_Waiting.front());
+      starting.push_back(m_Waiting.front());
+      m_Waiting.pop_front();
+    }
+  }
+
+  // Requests are started without the lock because they may fail before exec() returns
+  for(HTAbstractRequest* request : starting)
+  {
+    {
+      QMutexLocker locker(&m_Mutex);
+      if(m_Error != QNetworkReply::NoError)
+      {
+        removeRunning(request);
+        continue;
+      }
+    }
+    request->exec();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::onRequestFinished(HTAbstractRequest* request)
+{
+  int finishedCount = 0;
+  int totalCount = 0;
+  {
+    QMutexLocker locker(&m_Mutex);
+    removeRunning(request);
+    m_FinishedCount++;
+    finishedCount = static_cast<int>(m_FinishedCount);
+    totalCount = static_cast<int>(m_Requests.size());
+  }
+
+  emit progress(finishedCount, totalCount);
+  startRequests();
+  completeIfDone();
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::onRequestFailed(HTAbstractRequest* request, QNetworkReply::NetworkError err)
+{
+  std::vector<HTAbstractRequest*> running;
+  {
+    QMutexLocker locker(&m_Mutex);
+    removeRunning(request);
+
+    // Only the first failure is reported. The rest are usually the cancellations it caused.
+    if(m_Error == QNetworkReply::NoError)
+    {
+      running = failGroup(err);
+    }
+  }
+
+  for(HTAbstractRequest* runningRequest : running)
+  {
+    runningRequest->cancel();
+  }
+  completeIfDone();
+}
+
+// -----------------------------------------------------------------------------
+std::vector<HTAbstractRequest*> HTRequestGroup::failGroup(QNetworkReply::NetworkError err)
+{
+  m_Error = err;
+  m_Waiting.clear();
+  return m_Running;
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::removeRunning(HTAbstractRequest* request)
+{
+  m_Running.erase(std::remove(m_Running.begin(), m_Running.end(), request), m_Running.end());
+}
+
+// -----------------------------------------------------------------------------
+void HTRequestGroup::completeIfDone()
+{
+  QNetworkReply::NetworkError err = QNetworkReply::NoError;
+  bool destroying = false;
+  bool wake = false;
+  {
+    QMutexLocker locker(&m_Mutex);
+    if(!m_Started || m_Settled || !m_Running.empty())
+    {
+      return;
+    }
+    if(m_Error == QNetworkReply::NoError && !m_Waiting.empty())
+    {
+      return;
+    }
+    m_Settled = true;
+    err = m_Error;
+    destroying = m_Destroying;
+    wake = !m_IsAsync;
+  }
+
+  if(destroying)
+  {
+    QMutexLocker locker(&m_Mutex);
+    m_WaitCondition.wakeAll();
+    return;
+  }
+
+  // Asynchronous groups may be deleted as soon as the signal is delivered
+  if(err == QNetworkReply::NoError)
+  {
+    emit finished();
+  }
+  else
+  {
+    emit requestFailed(err);
+  }
+
+  if(wake)
+  {
+    QMutexLocker locker(&m_Mutex);
+    m_Completed = true;
+    m_WaitCondition.wakeAll();
+  }
+}
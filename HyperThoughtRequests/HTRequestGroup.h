@@ -0,0 +1,226 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QWaitCondition>
+#include <QtNetwork/QNetworkReply>
+
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesPlugin.h"
+
+class HTAbstractRequest;
+
+/**
+ * @class HTRequestGroup HTRequestGroup.h HyperThoughtUtilities/HyperThoughtRequests/HTRequestGroup.h
+ * @brief The HTRequestGroup class runs a batch of requests with a limit on how many are running at once.
+ * A filter can add every upload or download it needs and call exec() once instead of chaining requests
+ * through their signals:
+ *
+ *   HTRequestGroup group(16);
+ *   for(const QString& filePath : filePaths)
+ *   {
+ *     group.addRequest(new HTFileUploadRequest(connection, uploadPath, filePath));
+ *   }
+ *   group.exec();
+ *
+ * The first request that fails stops the group. Requests that have not started are dropped, the running
+ * ones are canceled, and the group fails with the first error. Canceling the group behaves the same way
+ * with QNetworkReply::OperationCanceledError.
+ *
+ * Requests run asynchronously and their signals arrive on their connection's network thread. The group
+ * owns every request added to it and deletes them when it is destroyed.
+ */
+class HyperThoughtUtilities_EXPORT HTRequestGroup : public QObject
+{
+  Q_OBJECT
+
+public:
+  static constexpr size_t k_DefaultMaxConcurrent = 8;
+
+  /**
+   * @brief Constructor
+   * @param maxConcurrent
+   * @param parent
+   */
+  HTRequestGroup(size_t maxConcurrent = k_DefaultMaxConcurrent, QObject* parent = nullptr);
+
+  /**
+   * @brief Destructor. Cancels any running requests and waits for them before deleting them.
+   */
+  ~HTRequestGroup() override;
+
+  /**
+   * @brief Returns the maximum number of requests running at once.
+   * @return
+   */
+  size_t getMaxConcurrent() const;
+
+  /**
+   * @brief Sets the maximum number of requests running at once.
+   * Takes effect for requests started after the call.
+   * @param count
+   */
+  void setMaxConcurrent(size_t count);
+
+  /**
+   * @brief Checks if exec() returns immediately instead of waiting for the group to complete.
+   * @return
+   */
+  bool isAsync() const;
+
+  /**
+   * @brief Sets the asynchronous behaviour.
+   * @param async
+   */
+  void setAsync(bool async);
+
+  /**
+   * @brief Adds a request to the group and takes ownership of it.
+   * Requests must be added before exec() is called.
+   * @param request
+   */
+  void addRequest(HTAbstractRequest* request);
+
+  /**
+   * @brief Returns the number of requests in the group.
+   * @return
+   */
+  size_t size() const;
+
+  /**
+   * @brief Returns the number of requests that finished successfully.
+   * @return
+   */
+  size_t getFinishedCount() const;
+
+  /**
+   * @brief Returns true if a request failed or the group was canceled. Returns false otherwise.
+   * @return
+   */
+  bool hasFailed() const;
+
+  /**
+   * @brief Returns the error the group failed with or QNetworkReply::NoError.
+   * @return
+   */
+  QNetworkReply::NetworkError getError() const;
+
+  /**
+   * @brief Starts the requests. Synchronous groups block the calling thread until every request has
+   * finished or the group has failed. Must not be called from a connection's network thread.
+   */
+  void exec();
+
+  /**
+   * @brief Stops the group. Requests that have not started are dropped and running requests are canceled.
+   * This method is thread-safe.
+   */
+  void cancel();
+
+signals:
+  /**
+   * @brief This signal is emitted each time a request in the group finishes successfully.
+   * @param finishedCount
+   * @param totalCount
+   */
+  void progress(int finishedCount, int totalCount);
+
+  /**
+   * @brief This signal is emitted when every request has finished successfully.
+   */
+  void finished();
+
+  /**
+   * @brief This signal is emitted once the group has failed and its running requests have stopped.
+   * @param err
+   */
+  void requestFailed(QNetworkReply::NetworkError err);
+
+private:
+  /**
+   * @brief Starts waiting requests until the concurrency limit is reached.
+   */
+  void startRequests();
+
+  /**
+   * @brief Called on the network thread when a request in the group finishes successfully.
+   * @param request
+   */
+  void onRequestFinished(HTAbstractRequest* request);
+
+  /**
+   * @brief Called on the network thread when a request in the group fails or is canceled.
+   * @param request
+   * @param err
+   */
+  void onRequestFailed(HTAbstractRequest* request, QNetworkReply::NetworkError err);
+
+  /**
+   * @brief Marks the group as failed and returns the running requests that should be canceled.
+   * Must be called with the mutex locked.
+   * @param err
+   * @return
+   */
+  std::vector<HTAbstractRequest*> failGroup(QNetworkReply::NetworkError err);
+
+  /**
+   * @brief Emits the final signal and wakes the waiting thread once no requests are running.
+   * Must be called without the mutex locked.
+   */
+  void completeIfDone();
+
+  /**
+   * @brief Removes the request from the running requests. Must be called with the mutex locked.
+   * @param request
+   */
+  void removeRunning(HTAbstractRequest* request);
+
+  mutable QMutex m_Mutex;
+  QWaitCondition m_WaitCondition;
+  std::vector<HTAbstractRequest*> m_Requests;
+  std::deque<HTAbstractRequest*> m_Waiting;
+  std::vector<HTAbstractRequest*> m_Running;
+  size_t m_MaxConcurrent = k_DefaultMaxConcurrent;
+  size_t m_FinishedCount = 0;
+  bool m_IsAsync = false;
+  bool m_Started = false;
+  bool m_Settled = false;
+  bool m_Completed = false;
+  bool m_Destroying = false;
+  QNetworkReply::NetworkError m_Error = QNetworkReply::NoError;
+};
@@ -44,7 +44,10 @@ HTUpdateMetaDataRequest::HTUpdateMetaDataRequest(HTConnection* connection, const
 }
 
 // -----------------------------------------------------------------------------
-HTUpdateMetaDataRequest::~HTUpdateMetaDataRequest() = default;
+HTUpdateMetaDataRequest::~HTUpdateMetaDataRequest()
+{
+  releaseContext();
+}
 
 // -----------------------------------------------------------------------------
 void HTUpdateMetaDataRequest::exec()
@@ -52,13 +55,14 @@ void HTUpdateMetaDataRequest::exec()
   QByteArray json = createPayloadDoc().toJson(QJsonDocument::JsonFormat::Compact);
   auto request = createNetworkRequest();
 
-  qDebug() << json;
-
-  QNetworkReply* reply = getConnection()->patch(request, json);
-  connect(reply, &QNetworkReply::finished, this, &HTUpdateMetaDataRequest::onRequestCompleted);
+  // The patch sets the same values every time
+  HTRequestScheduler::RetryPolicy policy = getRetryPolicy();
+  policy.retryNonIdempotent = true;
+  sendRequest(
+      HTRequestScheduler::Lane::MetaData, policy, [this, request, json]() { return getConnection()->patch(request, json); }, [this](QNetworkReply* reply) { onRequestCompleted(reply); });
 
   // Required for running during execute.
-  waitForResponse(reply);
+  waitForFinished();
 }
 
 // -----------------------------------------------------------------------------
@@ -72,12 +76,18 @@ QNetworkRequest HTUpdateMetaDataRequest::createNetworkRequest() const
 
 // -----------------------------------------------------------------------------
 QJsonDocument HTUpdateMetaDataRequest::createPayloadDoc() const
+{
+  return CreatePayloadDoc(m_FileId, m_MetaData);
+}
+
+// -----------------------------------------------------------------------------
+QJsonDocument HTUpdateMetaDataRequest::CreatePayloadDoc(const QString& fileId, const HTMetaData& metadata)
 {
   QJsonObject metaObj;
-  metaObj["metadata"] = m_MetaData.toJsonDict();
+  metaObj["metadata"] = metadata.toJsonDict();
 
   QJsonObject json;
-  json["file_id"] = m_FileId;
+  json["file_id"] = fileId;
   json["updates"] = metaObj;
 
   QJsonDocument doc;
@@ -86,15 +96,14 @@ QJsonDocument HTUpdateMetaDataRequest::createPayloadDoc() const
 }
 
 // -----------------------------------------------------------------------------
-void HTUpdateMetaDataRequest::onRequestCompleted()
+void HTUpdateMetaDataRequest::onRequestCompleted(QNetworkReply* reply)
 {
-  QNetworkReply* reply = dynamic_cast<QNetworkReply*>(sender());
   if(reply->error() > 0)
   {
-    qDebug() << reply->readAll();
-    requestFailed(reply->error());
+    fail(reply->error());
     return;
   }
 
-  emit finished();
+  emit metaDataUpdated();
+  finish();
 }
@@ -58,6 +58,14 @@ public:
    */
   void exec() override;
 
+  /**
+   * @brief Creates and returns the json payload for updating the metadata of the given HyperThought file.
+   * @param fileId
+   * @param metadata
+   * @return
+   */
+  static QJsonDocument CreatePayloadDoc(const QString& fileId, const HTMetaData& metadata);
+
 signals:
   void metaDataUpdated();
 
@@ -75,11 +83,11 @@ private:
   QJsonDocument createPayloadDoc() const;
 
   /**
-   * @brief Called when the last recursive response has been received.
-   * Inserts the HTFileInfoTree requested into the HyperThought file info cache
-   * and emits the infoReceived signal.
+   * @brief Called when the patch request has finished.
+   * Emits metaDataUpdated and finished if successful. Emits requestFailed otherwise.
+   * @param reply
    */
-  void onRequestCompleted();
+  void onRequestCompleted(QNetworkReply* reply);
 
   // -----------------------------------------------------------------------------
   // Variables
@@ -5,7 +5,9 @@ set(${PLUGIN_NAME}_Requests_HDRS
     ${HyperThoughtRequestsDir}/HTAbstractUploadRequest.h
     ${HyperThoughtRequestsDir}/HTDownloadRequest.h
     ${HyperThoughtRequestsDir}/HTFileInfoRequest.h
+    ${HyperThoughtRequestsDir}/HTFileLookupRequest.h
     ${HyperThoughtRequestsDir}/HTFileUploadRequest.h
+    ${HyperThoughtRequestsDir}/HTRequestGroup.h
     ${HyperThoughtRequestsDir}/HTUpdateMetaDataRequest.h
 )
 
@@ -14,7 +16,9 @@ set(${PLUGIN_NAME}_Requests_SRCS
     ${HyperThoughtRequestsDir}/HTAbstractUploadRequest.cpp
     ${HyperThoughtRequestsDir}/HTDownloadRequest.cpp
     ${HyperThoughtRequestsDir}/HTFileInfoRequest.cpp
+    ${HyperThoughtRequestsDir}/HTFileLookupRequest.cpp
     ${HyperThoughtRequestsDir}/HTFileUploadRequest.cpp
+    ${HyperThoughtRequestsDir}/HTRequestGroup.cpp
     ${HyperThoughtRequestsDir}/HTUpdateMetaDataRequest.cpp
 )
 
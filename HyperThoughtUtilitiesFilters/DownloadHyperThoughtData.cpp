@@ -42,7 +42,9 @@
 
 #include "HyperThoughtUtilities/FilterParameters/HTFilePathFilterParameter.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
 #include "HyperThoughtUtilities/HyperThoughtRequests/HTDownloadRequest.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileLookupRequest.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesFilters/util/HTUtils.h"
 
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesConstants.h"
@@ -111,6 +113,20 @@ void DownloadHyperThoughtData::dataCheck()
     setErrorCondition(-679, ss);
     return;
   }
+  if(!connection->getFileCache().hasFileInfo(m_FilePath) && getErrorCode() >= 0)
+  {
+    // Preflight runs on the GUI thread after every edit, so uncached paths are only looked up when the pipeline runs
+    if(getInPreflight())
+    {
+      QString ss = "The HyperThought file path is not cached yet. It will be looked up when the pipeline runs";
+      setWarningCondition(-682, ss);
+      return;
+    }
+
+    // Pipelines store the exact path, so only the folders along it need to be listed
+    HTFileLookupRequest lookup(connection, m_FilePath);
+    lookup.exec();
+  }
   if(!connection->getFileCache().hasFileInfo(m_FilePath))
   {
     QString ss = "The local HyperThought cache does not contain a value for the specified path";
@@ -144,6 +160,8 @@ void DownloadHyperThoughtData::preflight()
 // -----------------------------------------------------------------------------
 void DownloadHyperThoughtData::execute()
 {
+  HTTraceSpan traceSpan("filter", getHumanLabel());
+
   initialize();
   dataCheck();
   if(getErrorCode() < 0)
@@ -168,11 +186,13 @@ void DownloadHyperThoughtData::downloadFiles()
   HTConnection* connection = HTConnection::GetExistingConnection(this);
   m_DownloadRequest = new HTDownloadRequest(connection, m_FilePath);
   m_DownloadRequest->setDownloadDir(m_DownloadDir);
+  m_DownloadRequest->setResumeEnabled(true);
   auto fileInfo = connection->getFileCache().getFileInfo(m_FilePath);
   m_DownloadRequest->setDownloadName(fileInfo.getFileName());
 
-  connect(m_DownloadRequest, &HTDownloadRequest::downloadProgress, this, &DownloadHyperThoughtData::onDownloadProgress, Qt::UniqueConnection);
-  connect(m_DownloadRequest, &HTDownloadRequest::downloadComplete, this, &DownloadHyperThoughtData::onDownloadComplete, Qt::UniqueConnection);
+  const auto connectionType = static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection);
+  connect(m_DownloadRequest, &HTDownloadRequest::downloadProgress, this, &DownloadHyperThoughtData::onDownloadProgress, connectionType);
+  connect(m_DownloadRequest, &HTDownloadRequest::downloadComplete, this, &DownloadHyperThoughtData::onDownloadComplete, connectionType);
   m_DownloadRequest->exec();
 }
 
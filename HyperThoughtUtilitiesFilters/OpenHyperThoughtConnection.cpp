@@ -44,6 +44,7 @@
 
 #include "HyperThoughtUtilities/FilterParameters/HTConnectionFilterParameter.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
 
 // -----------------------------------------------------------------------------
 //
@@ -56,13 +57,7 @@ OpenHyperThoughtConnection::OpenHyperThoughtConnection()
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-OpenHyperThoughtConnection::~OpenHyperThoughtConnection()
-{
-  if(m_Connection)
-  {
-    m_Connection->deleteLater();
-  }
-}
+OpenHyperThoughtConnection::~OpenHyperThoughtConnection() = default;
 
 // -----------------------------------------------------------------------------
 //
@@ -94,8 +89,8 @@ void OpenHyperThoughtConnection::dataCheck()
   clearErrorCode();
   clearWarningCode();
 
-  // Create a new HTConnection using the current API Access code
-  recreateHTConnection();
+  // Reuse the live HTConnection for the current API Access code
+  updateHTConnection();
 
   // Test HTConnection
   if(getHTConnection())
@@ -136,6 +131,8 @@ void OpenHyperThoughtConnection::preflight()
 // -----------------------------------------------------------------------------
 void OpenHyperThoughtConnection::execute()
 {
+  HTTraceSpan traceSpan("filter", getHumanLabel());
+
   initialize();
   dataCheck();
   if(getErrorCode() < 0)
@@ -179,23 +176,22 @@ void OpenHyperThoughtConnection::setApiAccess(const QString& code)
 // -----------------------------------------------------------------------------
 HTConnection* OpenHyperThoughtConnection::getHTConnection() const
 {
-  return m_Connection;
+  return m_Connection.get();
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void OpenHyperThoughtConnection::recreateHTConnection()
+void OpenHyperThoughtConnection::updateHTConnection()
 {
-  HTConnection* oldConnection = m_Connection;
-  m_Connection = new HTConnection(getApiAccess());
-
-  // Delete old collection
-  if(nullptr != oldConnection)
+  if(nullptr != m_Connection && m_ConnectionApiAccess == getApiAccess())
   {
-    m_Connection->takeFileCache(*oldConnection);
-    oldConnection->deleteLater();
+    return;
   }
+
+  // A new API Access for the same server and user picks up the file cache persisted on disk
+  m_ConnectionApiAccess = getApiAccess();
+  m_Connection = HTConnection::GetConnection(m_ConnectionApiAccess);
 }
 
 // -----------------------------------------------------------------------------
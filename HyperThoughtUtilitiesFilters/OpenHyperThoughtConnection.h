@@ -194,9 +194,10 @@ protected:
   void initialize();
 
   /**
-   * @brief Creates a new HTConnection based on existing values.
+   * @brief Updates the HTConnection to the shared connection for the current API Access.
+   * The existing connection is kept as long as the API Access has not changed.
    */
-  void recreateHTConnection();
+  void updateHTConnection();
 
   /**
    * @brief Handle failure to connect to HyperThought.
@@ -206,7 +207,8 @@ protected:
 
 private:
   QString m_ApiAccess;
-  HTConnection* m_Connection = nullptr;
+  std::shared_ptr<HTConnection> m_Connection;
+  QString m_ConnectionApiAccess;
 
 public:
   OpenHyperThoughtConnection(const OpenHyperThoughtConnection&) = delete;            // Copy Constructor Not Implemented
@@ -40,6 +40,8 @@
 #include "HyperThoughtUtilities/FilterParameters/HTFilePathFilterParameter.h"
 #include "HyperThoughtUtilities/FilterParameters/HTMetaDataFilterParameter.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileLookupRequest.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesConstants.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesVersion.h"
 
@@ -100,6 +102,20 @@ void TagHyperThoughtData::dataCheck()
     setErrorCondition(-678, ss);
   }
 
+  if(!connection->getFileCache().hasFileInfo(m_FilePath) && getErrorCode() >= 0)
+  {
+    // Preflight runs on the GUI thread after every edit, so uncached paths are only looked up when the pipeline runs
+    if(getInPreflight())
+    {
+      QString ss = "The HyperThought file path is not cached yet. It will be looked up when the pipeline runs";
+      setWarningCondition(-680, ss);
+      return;
+    }
+
+    // Pipelines store the exact path, so only the folders along it need to be listed
+    HTFileLookupRequest lookup(connection, m_FilePath);
+    lookup.exec();
+  }
   if(!connection->getFileCache().hasFileInfo(m_FilePath))
   {
     QString ss = "Cannot find cached file info for the current path. Please sync with HyperThought for updated information regarding the current file scope";
@@ -126,6 +142,8 @@ void TagHyperThoughtData::preflight()
 // -----------------------------------------------------------------------------
 void TagHyperThoughtData::execute()
 {
+  HTTraceSpan traceSpan("filter", getHumanLabel());
+
   initialize();
   dataCheck();
   if(getErrorCode() < 0)
@@ -148,8 +166,8 @@ void TagHyperThoughtData::updateFileMetaData()
 {
   HTConnection* connection = HTConnection::GetExistingConnection(this);
   m_UpdateRequest = new HTUpdateMetaDataRequest(connection, getFileInfo().getId(), m_MetaData);
-  connect(m_UpdateRequest, &HTUpdateMetaDataRequest::requestFailed, this, &TagHyperThoughtData::onRequestFailed);
-  connect(m_UpdateRequest, &HTUpdateMetaDataRequest::finished, this, &TagHyperThoughtData::onRequestCompleted);
+  connect(m_UpdateRequest, &HTUpdateMetaDataRequest::requestFailed, this, &TagHyperThoughtData::onRequestFailed, Qt::DirectConnection);
+  connect(m_UpdateRequest, &HTUpdateMetaDataRequest::finished, this, &TagHyperThoughtData::onRequestCompleted, Qt::DirectConnection);
   m_UpdateRequest->exec();
 }
 
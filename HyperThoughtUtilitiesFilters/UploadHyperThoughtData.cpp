@@ -43,6 +43,7 @@
 #include "HyperThoughtUtilities/FilterParameters/HTMetaDataFilterParameter.h"
 #include "HyperThoughtUtilities/FilterParameters/HTUploadPathFilterParameter.h"
 #include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
 #include "HyperThoughtUtilities/HyperThoughtRequests/HTFileUploadRequest.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesConstants.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesVersion.h"
@@ -139,6 +140,8 @@ void UploadHyperThoughtData::preflight()
 // -----------------------------------------------------------------------------
 void UploadHyperThoughtData::execute()
 {
+  HTTraceSpan traceSpan("filter", getHumanLabel());
+
   initialize();
   dataCheck();
   if(getErrorCode() < 0)
@@ -162,8 +165,8 @@ void UploadHyperThoughtData::uploadFile()
   HTConnection* connection = HTConnection::GetExistingConnection(this);
   m_UploadRequest = new HTFileUploadRequest(connection, m_UploadFilePath, m_LocalFilePath);
   m_UploadRequest->setMetaData(m_UpdateMetaData, m_MetaData);
-  connect(m_UploadRequest, &HTFileUploadRequest::uploadComplete, this, &UploadHyperThoughtData::onUploadComplete);
-  connect(m_UploadRequest, &HTFileUploadRequest::requestFailed, this, &UploadHyperThoughtData::onUploadError);
+  connect(m_UploadRequest, &HTFileUploadRequest::uploadComplete, this, &UploadHyperThoughtData::onUploadComplete, Qt::DirectConnection);
+  connect(m_UploadRequest, &HTFileUploadRequest::requestFailed, this, &UploadHyperThoughtData::onUploadError, Qt::DirectConnection);
   m_UploadRequest->exec();
 }
 
@@ -12,6 +12,7 @@
 #include "SIMPLib/Filtering/IFilterFactory.hpp"
 #include "SIMPLib/Filtering/FilterFactory.hpp"
 
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
 #include "HyperThoughtUtilities/HyperThoughtUtilitiesConstants.h"
 
 
@@ -217,6 +218,8 @@ void HyperThoughtUtilitiesPlugin::writeSettings(QSettings& prefs)
 // -----------------------------------------------------------------------------
 void HyperThoughtUtilitiesPlugin::readSettings(QSettings& prefs)
 {
+  // Setting TraceFile to a path records a Chrome trace of HyperThought requests into it
+  HTTrace::SetOutputFile(prefs.value("TraceFile").toString());
 }
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,249 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QTemporaryDir>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTDownloadRequest.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileInfoRequest.h"
+
+#include "HTMockServer.hpp"
+
+/**
+ * Benchmarks for the file info tree and the requests, run against HTMockServer.
+ * They are built with HyperThoughtUtilities_BUILD_BENCHMARKS and are not part of the unit tests.
+ * Every benchmark prints its timings to stdout.
+ */
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+const int k_NumFolders = 1000;
+const int k_FilesPerFolder = 500;
+
+// -----------------------------------------------------------------------------
+void PrintElapsed(const std::string& label, Clock::time_point start)
+{
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+  std::cout << label << ": " << elapsed.count() << " ms" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+void PrintPeakMemory(const std::string& label)
+{
+#ifndef _WIN32
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) == 0)
+  {
+    std::cout << label << " peak RSS: " << usage.ru_maxrss << std::endl;
+  }
+#endif
+}
+
+// -----------------------------------------------------------------------------
+HTFilePath CreateProjectPath(const QString& path)
+{
+  HTFilePath filePath;
+  filePath.setScopeType(HTFilePath::ScopeType::Project);
+  filePath.setSourceId("mock-project");
+  filePath.setPath(path);
+  return filePath;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfo CreateInfo(const QString& parentPath, const QString& pk, bool isDir)
+{
+  HTFileInfo::Content content;
+  content.path = parentPath;
+  content.pk = pk;
+  content.name = pk;
+  content.fileType = isDir ? "Folder" : "File";
+
+  HTFileInfo info;
+  info.setContent(content);
+  return info;
+}
+
+// -----------------------------------------------------------------------------
+HTFileInfoTree::ConstPointer Crawl(HTConnection& connection)
+{
+  HTFileInfoTree::ConstPointer infoTree;
+  HTFileInfoRequest request(&connection, CreateProjectPath(","));
+  QObject::connect(&request, &HTFileInfoRequest::infoReceived, &request, [&infoTree](HTFileInfoTree::ConstPointer tree) { infoTree = tree; }, Qt::DirectConnection);
+  request.exec();
+  return infoTree;
+}
+
+// -----------------------------------------------------------------------------
+void BenchmarkLargeTree()
+{
+  std::vector<HTFileInfo> items;
+  items.reserve(k_NumFolders * (k_FilesPerFolder + 1));
+  for(int i = 0; i < k_NumFolders; i++)
+  {
+    QString folderId = QString("folder-%1").arg(i);
+    items.push_back(CreateInfo(",", folderId, true));
+
+    QString folderPath = QString(",%1,").arg(folderId);
+    for(int j = 0; j < k_FilesPerFolder; j++)
+    {
+      items.push_back(CreateInfo(folderPath, QString("file-%1-%2").arg(i).arg(j), false));
+    }
+  }
+
+  Clock::time_point start = Clock::now();
+  HTFileInfoTree* tree = new HTFileInfoTree();
+  tree->insert(items);
+  PrintElapsed("HTFileInfoTree build", start);
+
+  start = Clock::now();
+  HTFileInfoTree* copy = new HTFileInfoTree(*tree);
+  PrintElapsed("HTFileInfoTree copy", start);
+
+  start = Clock::now();
+  delete tree;
+  PrintElapsed("HTFileInfoTree destroy", start);
+
+  PrintPeakMemory("HTFileInfoTree");
+  delete copy;
+}
+
+// -----------------------------------------------------------------------------
+void BenchmarkCrawl()
+{
+  HTMockServer::Options options;
+  options.folderDepth = 3;
+  options.foldersPerFolder = 4;
+  options.filesPerFolder = 20;
+  options.latencyMs = 20;
+  HTMockServer server(options);
+  if(!server.start())
+  {
+    std::cout << "HTRequest crawl: the mock server did not start" << std::endl;
+    return;
+  }
+
+  HTConnection connection(server.createApiAccess());
+  Clock::time_point start = Clock::now();
+  Crawl(connection);
+  PrintElapsed("HTRequest crawl", start);
+
+  std::cout << connection.getMetrics().toText().toStdString();
+  connection.getFileCacheRef().clear();
+}
+
+// -----------------------------------------------------------------------------
+void BenchmarkCompressedCrawl()
+{
+  // A slow link makes the listing bytes dominate the crawl time
+  for(bool compress : {false, true})
+  {
+    HTMockServer::Options options;
+    options.folderDepth = 3;
+    options.foldersPerFolder = 4;
+    options.filesPerFolder = 20;
+    options.latencyMs = 20;
+    options.bytesPerSecond = 256 * 1024;
+    options.compressListings = compress;
+    HTMockServer server(options);
+    const std::string label = compress ? "HTRequest gzip crawl" : "HTRequest identity crawl";
+    if(!server.start())
+    {
+      std::cout << label << ": the mock server did not start" << std::endl;
+      continue;
+    }
+
+    HTConnection connection(server.createApiAccess());
+    Clock::time_point start = Clock::now();
+    Crawl(connection);
+    PrintElapsed(label, start);
+    std::cout << label << " listing bytes: " << server.getListingBytes() << std::endl;
+
+    connection.getFileCacheRef().clear();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void BenchmarkRangedDownload()
+{
+  HTMockServer::Options options;
+  options.fileSize = 1024 * 1024;
+  options.bytesPerSecond = 8 * 1024 * 1024;
+  HTMockServer server(options);
+  QTemporaryDir downloadDir;
+  if(!server.start() || !downloadDir.isValid())
+  {
+    std::cout << "HTRequest ranged download: the mock server did not start" << std::endl;
+    return;
+  }
+
+  HTConnection connection(server.createApiAccess());
+  Crawl(connection);
+
+  HTDownloadRequest request(&connection, CreateProjectPath(",dir-1,file-1-4,"));
+  request.setDownloadDir(QDir(downloadDir.path()));
+  request.setDownloadName("download.dat");
+  request.setMaxStreams(4);
+  request.setMinSegmentSize(128 * 1024);
+
+  Clock::time_point start = Clock::now();
+  request.exec();
+  PrintElapsed("HTRequest ranged download", start);
+
+  connection.getFileCacheRef().clear();
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  BenchmarkLargeTree();
+  BenchmarkCrawl();
+  BenchmarkCompressedCrawl();
+  BenchmarkRangedDownload();
+  return EXIT_SUCCESS;
+}
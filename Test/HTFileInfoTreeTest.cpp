@@ -0,0 +1,415 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <QtCore/QBuffer>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QTemporaryDir>
+
+#include "SIMPLib/SIMPLib.h"
+
+#include "UnitTestSupport.hpp"
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFileCache.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoTree.h"
+
+class HTFileInfoTreeTest
+{
+
+public:
+  HTFileInfoTreeTest() = default;
+  ~HTFileInfoTreeTest() = default;
+  HTFileInfoTreeTest(const HTFileInfoTreeTest&) = delete;            // Copy Constructor
+  HTFileInfoTreeTest(HTFileInfoTreeTest&&) = delete;                 // Move Constructor
+  HTFileInfoTreeTest& operator=(const HTFileInfoTreeTest&) = delete; // Copy Assignment
+  HTFileInfoTreeTest& operator=(HTFileInfoTreeTest&&) = delete;      // Move Assignment
+
+  static const int k_NumFolders = 20;
+  static const int k_FilesPerFolder = 50;
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  HTFileInfo createInfo(const QString& parentPath, const QString& pk, bool isDir)
+  {
+    HTFileInfo::Content content;
+    content.path = parentPath;
+    content.pk = pk;
+    content.name = pk;
+    content.fileType = isDir ? "Folder" : "File";
+
+    HTFileInfo info;
+    info.setContent(content);
+    return info;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  HTFilePath createPath(const QString& path)
+  {
+    HTFilePath filePath;
+    filePath.setScopeType(HTFilePath::ScopeType::Project);
+    filePath.setSourceId("project");
+    filePath.setPath(path);
+    return filePath;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  std::vector<HTFileInfo> createListing()
+  {
+    std::vector<HTFileInfo> items;
+    items.reserve(k_NumFolders * (k_FilesPerFolder + 1));
+    for(int i = 0; i < k_NumFolders; i++)
+    {
+      QString folderId = QString("folder-%1").arg(i);
+      items.push_back(createInfo(",", folderId, true));
+
+      QString folderPath = QString(",%1,").arg(folderId);
+      for(int j = 0; j < k_FilesPerFolder; j++)
+      {
+        items.push_back(createInfo(folderPath, QString("file-%1-%2").arg(i).arg(j), false));
+      }
+    }
+    return items;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestTreeCopy()
+  {
+    const size_t expectedSize = k_NumFolders * (k_FilesPerFolder + 1);
+    std::vector<HTFileInfo> items = createListing();
+
+    HTFileInfoTree* tree = new HTFileInfoTree();
+    tree->insert(items);
+    DREAM3D_REQUIRE_EQUAL(tree->size(), expectedSize)
+
+    const HTFileInfoTree::Node* node = tree->findNodeById("file-19-49");
+    DREAM3D_REQUIRE(nullptr != node)
+    DREAM3D_REQUIRE(nullptr != node->parent)
+    DREAM3D_REQUIRE_EQUAL(node->parent->fileInfo.getId(), QString("folder-19"))
+
+    // Copies share their nodes until one of them changes
+    HTFileInfoTree* copy = new HTFileInfoTree(*tree);
+    DREAM3D_REQUIRE_EQUAL(copy->size(), expectedSize)
+    DREAM3D_REQUIRE(copy->findNodeById("file-0-0") == tree->findNodeById("file-0-0"))
+
+    delete tree;
+
+    // The copy keeps the shared nodes alive after the tree is destroyed
+    node = copy->findNodeById("file-10-25");
+    DREAM3D_REQUIRE(nullptr != node)
+    DREAM3D_REQUIRE_EQUAL(node->parent->fileInfo.getId(), QString("folder-10"))
+
+    delete copy;
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestStreamRoundTrip()
+  {
+    HTFileInfoTree tree;
+    tree.insert(createInfo(",", "a", true));
+    tree.insert(createInfo(",a,", "b", true));
+    tree.insert(createInfo(",a,b,", "c", false));
+
+    QByteArray bytes;
+    {
+      QDataStream out(&bytes, QIODevice::WriteOnly);
+      out << tree;
+    }
+
+    HTFileInfoTree result;
+    QDataStream in(bytes);
+    in >> result;
+
+    DREAM3D_REQUIRE(result.size() == 3)
+    const HTFileInfoTree::Node* node = result.findNodeById("c");
+    DREAM3D_REQUIRE(nullptr != node)
+    DREAM3D_REQUIRE_EQUAL(node->parent->fileInfo.getId(), QString("b"))
+
+    HTFileInfoTree moved(std::move(result));
+    DREAM3D_REQUIRE(moved.size() == 3)
+    DREAM3D_REQUIRE(result.size() == 0)
+    DREAM3D_REQUIRE(&moved.getRoot() == moved.findNodeById("a")->parent)
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestMergeFolder()
+  {
+    HTFileInfoTree tree;
+    tree.insert(createInfo(",", "a", true));
+    tree.insert(createInfo(",a,", "b", true));
+    tree.insert(createInfo(",a,b,", "c", false));
+    tree.insert(createInfo(",a,", "d", false));
+    tree.insert(createInfo(",", "e", false));
+    const HTFileInfoTree::Node* folderB = tree.findNodeById("b");
+
+    // A fresh crawl of a: c changed, d was deleted, and f is new
+    HTFileInfo changedC = createInfo(",a,b,", "c", false);
+    HTFileInfo::Content content = changedC.getContent();
+    content.modifiedDate = "2020-06-01T00:00:00Z";
+    changedC.setContent(content);
+
+    HTFileInfoTree crawl;
+    crawl.insert(createInfo(",a,", "b", true));
+    crawl.insert(changedC);
+    crawl.insert(createInfo(",a,", "f", false));
+
+    HTFileInfoTree::ChangeSet changes;
+    DREAM3D_REQUIRE(tree.mergeFolder("a", crawl, changes))
+    DREAM3D_REQUIRE_EQUAL(changes.added.size(), 1)
+    DREAM3D_REQUIRE_EQUAL(changes.added[0].getId(), QString("f"))
+    DREAM3D_REQUIRE_EQUAL(changes.updated.size(), 1)
+    DREAM3D_REQUIRE_EQUAL(changes.updated[0].getId(), QString("c"))
+    DREAM3D_REQUIRE_EQUAL(changes.removed.size(), 1)
+    DREAM3D_REQUIRE_EQUAL(changes.removed[0].getId(), QString("d"))
+
+    // Unchanged items keep their nodes and everything outside the folder is untouched
+    DREAM3D_REQUIRE(tree.findNodeById("b") == folderB)
+    DREAM3D_REQUIRE(nullptr == tree.findNodeById("d"))
+    DREAM3D_REQUIRE(nullptr != tree.findNodeById("e"))
+    DREAM3D_REQUIRE_EQUAL(tree.findNodeById("c")->fileInfo.getContent().modifiedDate, content.modifiedDate)
+    DREAM3D_REQUIRE_EQUAL(tree.findNodeById("f")->parent->fileInfo.getId(), QString("a"))
+    DREAM3D_REQUIRE_EQUAL(tree.size(), 5)
+
+    // Merging the same crawl again changes nothing
+    DREAM3D_REQUIRE(tree.folderMatches("a", crawl))
+    DREAM3D_REQUIRE(!tree.folderMatches("", crawl))
+    HTFileInfoTree::ChangeSet noChanges;
+    DREAM3D_REQUIRE(tree.mergeFolder("a", crawl, noChanges))
+    DREAM3D_REQUIRE(noChanges.isEmpty())
+
+    HTFileInfoTree::ChangeSet missing;
+    DREAM3D_REQUIRE(!tree.mergeFolder("missing", crawl, missing))
+    DREAM3D_REQUIRE(missing.isEmpty())
+
+    // e moved from the root into a, so its node moves instead of being added twice
+    const HTFileInfoTree::Node* fileE = tree.findNodeById("e");
+    crawl.insert(createInfo(",a,", "e", false));
+    HTFileInfoTree::ChangeSet moveChanges;
+    DREAM3D_REQUIRE(tree.mergeFolder("a", crawl, moveChanges))
+    DREAM3D_REQUIRE(moveChanges.added.empty())
+    DREAM3D_REQUIRE(moveChanges.removed.empty())
+    DREAM3D_REQUIRE_EQUAL(moveChanges.updated.size(), 1)
+    DREAM3D_REQUIRE(tree.findNodeById("e") == fileE)
+    DREAM3D_REQUIRE_EQUAL(fileE->parent->fileInfo.getId(), QString("a"))
+    DREAM3D_REQUIRE_EQUAL(tree.getRoot().size(), 1)
+    DREAM3D_REQUIRE_EQUAL(tree.size(), 5)
+
+    // b moved from a to the root and keeps its cached contents. Merging a afterwards removes nothing.
+    HTFileInfoTree rootListing;
+    rootListing.insert(createInfo(",", "a", true));
+    rootListing.insert(createInfo(",", "b", true));
+    HTFileInfoTree::ChangeSet rootChanges;
+    DREAM3D_REQUIRE(tree.mergeFolder("", rootListing, rootChanges, false))
+    DREAM3D_REQUIRE(rootChanges.removed.empty())
+    DREAM3D_REQUIRE(tree.findNodeById("b") == folderB)
+    DREAM3D_REQUIRE(tree.contains(createPath(",b,c,")))
+    DREAM3D_REQUIRE(!tree.contains(createPath(",a,b,")))
+
+    HTFileInfoTree folderListing;
+    folderListing.insert(createInfo(",a,", "f", false));
+    folderListing.insert(createInfo(",a,", "e", false));
+    HTFileInfoTree::ChangeSet folderChanges;
+    DREAM3D_REQUIRE(tree.mergeFolder("a", folderListing, folderChanges, false))
+    DREAM3D_REQUIRE(folderChanges.isEmpty())
+    DREAM3D_REQUIRE(nullptr != tree.findNodeById("b"))
+    DREAM3D_REQUIRE_EQUAL(tree.size(), 5)
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestSharedMerge()
+  {
+    HTFileInfoTree tree;
+    tree.insert(createListing());
+    tree.sort();
+    const HTFileInfoTree snapshot(tree);
+
+    // A crawl of folder-3 where file-3-0 changed and file-3-new was added
+    HTFileInfoTree crawl;
+    for(HTFileInfo item : createListing())
+    {
+      if(item.getPath() != ",folder-3,")
+      {
+        continue;
+      }
+      if(item.getId() == "file-3-0")
+      {
+        HTFileInfo::Content content = item.getContent();
+        content.modifiedDate = "2020-06-01T00:00:00Z";
+        item.setContent(content);
+      }
+      crawl.insert(item);
+    }
+    crawl.insert(createInfo(",folder-3,", "file-3-new", false));
+
+    HTFileInfoTree::ChangeSet changes;
+    DREAM3D_REQUIRE(tree.mergeFolder("folder-3", crawl, changes))
+    DREAM3D_REQUIRE_EQUAL(changes.added.size(), 1)
+    DREAM3D_REQUIRE_EQUAL(changes.updated.size(), 1)
+    DREAM3D_REQUIRE(changes.removed.empty())
+
+    // Only the changed folder, the changed file, and the root are copied
+    DREAM3D_REQUIRE(&tree.getRoot() != &snapshot.getRoot())
+    DREAM3D_REQUIRE(tree.findNodeById("folder-3") != snapshot.findNodeById("folder-3"))
+    DREAM3D_REQUIRE(tree.findNodeById("file-3-0") != snapshot.findNodeById("file-3-0"))
+    DREAM3D_REQUIRE(tree.findNodeById("file-3-1") == snapshot.findNodeById("file-3-1"))
+    DREAM3D_REQUIRE(tree.findNodeById("folder-7") == snapshot.findNodeById("folder-7"))
+    DREAM3D_REQUIRE(tree.findNodeById("file-7-7") == snapshot.findNodeById("file-7-7"))
+
+    // Shared nodes find their parent in the tree that is asked
+    const HTFileInfoTree::Node* sharedFile = tree.findNodeById("file-3-1");
+    DREAM3D_REQUIRE(tree.getParent(sharedFile) == tree.findNodeById("folder-3"))
+    DREAM3D_REQUIRE(snapshot.getParent(sharedFile) == snapshot.findNodeById("folder-3"))
+    DREAM3D_REQUIRE(tree.getIndexWithinParent(sharedFile) != static_cast<size_t>(-1))
+    DREAM3D_REQUIRE(tree.contains(createPath(",folder-3,file-3-1,")))
+
+    // The snapshot is unchanged
+    DREAM3D_REQUIRE_EQUAL(snapshot.size(), static_cast<size_t>(k_NumFolders * (k_FilesPerFolder + 1)))
+    DREAM3D_REQUIRE(nullptr == snapshot.findNodeById("file-3-new"))
+    DREAM3D_REQUIRE_EQUAL(snapshot.findNodeById("folder-3")->size(), k_FilesPerFolder)
+    DREAM3D_REQUIRE(snapshot.findNodeById("file-3-0")->fileInfo.getContent().modifiedDate.isEmpty())
+    DREAM3D_REQUIRE_EQUAL(tree.size(), snapshot.size() + 1)
+
+    // Sorting only copies folders that are out of order
+    tree.sort();
+    DREAM3D_REQUIRE(tree.findNodeById("folder-7") == snapshot.findNodeById("folder-7"))
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestCacheMerge()
+  {
+    HTFilePath source = createPath(",a,");
+
+    HTFileInfoTree tree;
+    tree.insert(createInfo(",", "a", true));
+    tree.insert(createInfo(",a,", "b", false));
+
+    HTFileCache cache;
+    cache.setFileInfoTree(source, std::move(tree));
+
+    // A reader's snapshot is copied before the merge changes the cached tree
+    HTFileInfoTree::ConstPointer snapshot = cache.getFileInfoTree(source);
+    HTFileInfoTree crawl;
+    crawl.insert(createInfo(",a,", "b", false));
+    crawl.insert(createInfo(",a,", "c", false));
+    HTFileInfoTree::ChangeSet changes;
+    DREAM3D_REQUIRE(cache.mergeFolder(source, crawl, HTFileCache::ValidatorMap(), changes))
+    DREAM3D_REQUIRE_EQUAL(changes.added.size(), 1)
+    DREAM3D_REQUIRE(nullptr == snapshot->findNodeById("c"))
+    DREAM3D_REQUIRE(cache.getFileInfoTree(source) != snapshot)
+    snapshot.reset();
+
+    // Without readers the tree is merged in place
+    const HTFileInfoTree* cachedTree = cache.getFileInfoTree(source).get();
+    crawl.insert(createInfo(",a,", "d", false));
+    HTFileInfoTree::ChangeSet inPlaceChanges;
+    DREAM3D_REQUIRE(cache.mergeFolder(source, crawl, HTFileCache::ValidatorMap(), inPlaceChanges))
+    DREAM3D_REQUIRE_EQUAL(inPlaceChanges.added.size(), 1)
+    DREAM3D_REQUIRE(cache.getFileInfoTree(source).get() == cachedTree)
+    DREAM3D_REQUIRE(cache.hasFileInfo(createPath(",a,d,")))
+
+    std::vector<HTFileInfo> files;
+    DREAM3D_REQUIRE(cache.getFolderContents(source, files))
+    DREAM3D_REQUIRE_EQUAL(files.size(), 3)
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestCachePersistence()
+  {
+    QTemporaryDir cacheDir;
+    DREAM3D_REQUIRE(cacheDir.isValid())
+
+    HTFilePath source = createPath(",");
+    HTFileInfoTree tree;
+    tree.insert(createListing());
+
+    // Flushing skips the write delay
+    HTFileCache cache;
+    cache.setCacheDirectory(cacheDir.path());
+    cache.setFileInfoTree(source, std::move(tree));
+    cache.flush();
+    DREAM3D_REQUIRE_EQUAL(QDir(cacheDir.path()).entryList(QDir::Files).size(), 1)
+
+    HTFileCache loaded;
+    loaded.setCacheDirectory(cacheDir.path());
+    DREAM3D_REQUIRE_EQUAL(loaded.getFileInfoTree(source)->size(), static_cast<size_t>(k_NumFolders * (k_FilesPerFolder + 1)))
+
+    cache.clear();
+    DREAM3D_REQUIRE(QDir(cacheDir.path()).entryList(QDir::Files).isEmpty())
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  void operator()()
+  {
+    int err = EXIT_SUCCESS;
+
+    DREAM3D_REGISTER_TEST(TestStreamRoundTrip())
+
+    DREAM3D_REGISTER_TEST(TestTreeCopy())
+
+    DREAM3D_REGISTER_TEST(TestMergeFolder())
+
+    DREAM3D_REGISTER_TEST(TestSharedMerge())
+
+    DREAM3D_REGISTER_TEST(TestCacheMerge())
+
+    DREAM3D_REGISTER_TEST(TestCachePersistence())
+  }
+
+private:
+};
@@ -0,0 +1,867 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPointer>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtCore/QUrl>
+#include <QtCore/QUrlQuery>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesFilters/util/HTUtils.h"
+
+/**
+ * @class HTMockServer HTMockServer.hpp HyperThoughtUtilities/Test/HTMockServer.hpp
+ * @brief The HTMockServer class is an in-process stand-in for the HyperThought files API.
+ * It serves a synthetic folder tree over plain HTTP/1.1 on 127.0.0.1 from its own thread, so
+ * synchronous requests can block the test thread while the server keeps answering.
+ *
+ * The server implements the endpoints used by the requests: folder listings with ETag validators,
+ * optional Django REST framework style paging and optional gzip compression,
+ * ranged downloads, generate-upload-url, the upload PUT, temp-to-perm and the metadata PATCH.
+ * Responses can be delayed, throttled, replaced by an error status, or cut off mid-transfer to measure
+ * crawl, transfer and tagging performance offline and reproducibly.
+ */
+class HTMockServer
+{
+public:
+  enum class Endpoint
+  {
+    Listing = 0,
+    Download,
+    GenerateUploadUrl,
+    Upload,
+    TempToPerm,
+    MetaData
+  };
+
+  static constexpr size_t k_EndpointCount = 6;
+
+  /**
+   * @brief Describes the synthetic tree and the injected network conditions.
+   * Options cannot be changed once the server has started.
+   */
+  struct Options
+  {
+    int folderDepth = 2;
+    int foldersPerFolder = 3;
+    int filesPerFolder = 10;
+    qint64 fileSize = 64 * 1024;
+    int latencyMs = 0;
+    qint64 bytesPerSecond = 0;
+    int failEvery = 0;
+    int errorStatus = 503;
+    bool supportRanges = true;
+    bool sendValidators = true;
+    int maxPageSize = 0;
+    QString pageLinkHost;
+    bool compressListings = false;
+  };
+
+  static constexpr int k_ThrottleIntervalMs = 50;
+
+  HTMockServer()
+  : HTMockServer(Options())
+  {
+  }
+
+  explicit HTMockServer(const Options& options)
+  : m_Options(options)
+  {
+    for(std::atomic<int>& count : m_RequestCounts)
+    {
+      count = 0;
+    }
+  }
+
+  ~HTMockServer()
+  {
+    stop();
+  }
+
+  HTMockServer(const HTMockServer&) = delete;            // Copy Constructor
+  HTMockServer(HTMockServer&&) = delete;                 // Move Constructor
+  HTMockServer& operator=(const HTMockServer&) = delete; // Copy Assignment
+  HTMockServer& operator=(HTMockServer&&) = delete;      // Move Assignment
+
+  /**
+   * @brief Starts listening on a free port of 127.0.0.1.
+   * Returns true if the server is listening. Returns false otherwise.
+   * @return
+   */
+  bool start()
+  {
+    if(nullptr != m_Thread)
+    {
+      return m_Port > 0;
+    }
+
+    m_Thread = new QThread();
+    m_Thread->start();
+
+    // The server and its sockets belong to the server thread
+    m_Server = new QTcpServer();
+    m_Server->moveToThread(m_Thread);
+    QMetaObject::invokeMethod(
+        m_Server,
+        [this]() {
+          QObject::connect(m_Server, &QTcpServer::newConnection, m_Server, [this]() { acceptConnections(); });
+          if(m_Server->listen(QHostAddress::LocalHost, 0))
+          {
+            m_Port = m_Server->serverPort();
+          }
+        },
+        Qt::BlockingQueuedConnection);
+    return m_Port > 0;
+  }
+
+  /**
+   * @brief Closes every connection and stops the server thread.
+   */
+  void stop()
+  {
+    if(nullptr == m_Thread)
+    {
+      return;
+    }
+
+    QMetaObject::invokeMethod(
+        m_Server,
+        [this]() {
+          // Sockets are children of the server
+          delete m_Server;
+          m_Server = nullptr;
+        },
+        Qt::BlockingQueuedConnection);
+    m_Thread->quit();
+    m_Thread->wait();
+    delete m_Thread;
+    m_Thread = nullptr;
+    m_Port = 0;
+  }
+
+  /**
+   * @brief Returns the base URL of the server.
+   * @return
+   */
+  QString getBaseUrl() const
+  {
+    return QString("http://127.0.0.1:%1").arg(m_Port);
+  }
+
+  /**
+   * @brief Returns an API Access code that connects an HTConnection to this server.
+   * @return
+   */
+  QString createApiAccess() const
+  {
+    QJsonObject json;
+    json["baseUrl"] = getBaseUrl();
+    json["clientId"] = "mock-client";
+    json["accessToken"] = k_AccessToken;
+    return HTUtils::encode64(QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString());
+  }
+
+  /**
+   * @brief Returns the number of folders in the synthetic tree, not counting the root.
+   * @return
+   */
+  size_t getFolderCount() const
+  {
+    size_t count = 0;
+    size_t levelCount = 1;
+    for(int depth = 0; depth < m_Options.folderDepth; depth++)
+    {
+      levelCount *= static_cast<size_t>(m_Options.foldersPerFolder);
+      count += levelCount;
+    }
+    return count;
+  }
+
+  /**
+   * @brief Returns the number of files in the synthetic tree.
+   * @return
+   */
+  size_t getFileCount() const
+  {
+    return (getFolderCount() + 1) * static_cast<size_t>(m_Options.filesPerFolder);
+  }
+
+  /**
+   * @brief Changes the validators of every listing and the modified date of every item, as if the whole tree had been modified.
+   */
+  void touchTree()
+  {
+    m_Generation++;
+  }
+
+  /**
+   * @brief Replaces the next responses of any endpoint by the error status, in addition to failEvery.
+   * @param count
+   */
+  void failNext(int count)
+  {
+    m_FailNextCount = count;
+  }
+
+  /**
+   * @brief Closes the connection halfway through the body of the next downloads. Range probes of a single byte are
+   * answered in full.
+   * @param count
+   */
+  void dropNextDownloads(int count)
+  {
+    m_DropNextCount = count;
+  }
+
+  /**
+   * @brief Returns the number of requests answered by the given endpoint, including injected errors.
+   * @param endpoint
+   * @return
+   */
+  int getRequestCount(Endpoint endpoint) const
+  {
+    return m_RequestCounts[static_cast<size_t>(endpoint)];
+  }
+
+  /**
+   * @brief Returns the number of TCP connections the server accepted.
+   * @return
+   */
+  int getConnectionCount() const
+  {
+    return m_ConnectionCount;
+  }
+
+  /**
+   * @brief Returns the number of listings answered with 304 Not Modified.
+   * @return
+   */
+  int getNotModifiedCount() const
+  {
+    return m_NotModifiedCount;
+  }
+
+  /**
+   * @brief Returns the number of listings sent with Content-Encoding: gzip.
+   * @return
+   */
+  int getCompressedCount() const
+  {
+    return m_CompressedCount;
+  }
+
+  /**
+   * @brief Returns the number of body bytes sent by the listing endpoint, after compression.
+   * @return
+   */
+  qint64 getListingBytes() const
+  {
+    return m_ListingBytes;
+  }
+
+  /**
+   * @brief Returns the number of responses replaced by the error status.
+   * @return
+   */
+  int getInjectedErrorCount() const
+  {
+    return m_InjectedErrorCount;
+  }
+
+  /**
+   * @brief Returns the number of body bytes sent by the download endpoint, including probes and dropped bodies.
+   * @return
+   */
+  qint64 getDownloadedBytes() const
+  {
+    return m_DownloadedBytes;
+  }
+
+  /**
+   * @brief Returns the number of body bytes received by the upload endpoint.
+   * @return
+   */
+  qint64 getUploadedBytes() const
+  {
+    return m_UploadedBytes;
+  }
+
+  /**
+   * @brief Returns the payload of the last metadata PATCH.
+   * @return
+   */
+  QJsonObject getLastMetaData() const
+  {
+    QMutexLocker locker(&m_Mutex);
+    return m_LastMetaData;
+  }
+
+  /**
+   * @brief Returns the bytes the server sends for the given file and byte range.
+   * @param fileId
+   * @param begin
+   * @param end Last byte, inclusive
+   * @return
+   */
+  static QByteArray FileContents(const QString& fileId, qint64 begin, qint64 end)
+  {
+    const uint seed = qHash(fileId);
+    QByteArray bytes;
+    bytes.resize(static_cast<int>(end - begin + 1));
+    for(qint64 i = begin; i <= end; i++)
+    {
+      bytes[static_cast<int>(i - begin)] = static_cast<char>((i * 131 + seed) & 0xFF);
+    }
+    return bytes;
+  }
+
+private:
+  struct Request
+  {
+    QByteArray method;
+    QUrl url;
+    QHash<QByteArray, QByteArray> headers;
+    QByteArray body;
+  };
+
+  struct Response
+  {
+    int status = 200;
+    QList<QPair<QByteArray, QByteArray>> headers;
+    QByteArray body;
+    bool dropConnection = false;
+  };
+
+  struct ClientState
+  {
+    QByteArray buffer;
+    bool busy = false;
+  };
+
+  static constexpr const char* k_AccessToken = "mock-token";
+  static constexpr qint64 k_ModifiedEpoch = 1577836800;
+
+  // -----------------------------------------------------------------------------
+  void acceptConnections()
+  {
+    while(m_Server->hasPendingConnections())
+    {
+      QTcpSocket* socket = m_Server->nextPendingConnection();
+      m_ConnectionCount++;
+      std::shared_ptr<ClientState> state = std::make_shared<ClientState>();
+      QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, state]() {
+        state->buffer += socket->readAll();
+        processRequests(socket, state);
+      });
+      QObject::connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+    }
+  }
+
+  // -----------------------------------------------------------------------------
+  void processRequests(QTcpSocket* socket, const std::shared_ptr<ClientState>& state)
+  {
+    // Requests on one connection are answered in order
+    Request request;
+    if(state->busy || !takeRequest(state->buffer, request))
+    {
+      return;
+    }
+    state->busy = true;
+
+    Response response = handleRequest(request);
+    QPointer<QTcpSocket> guard(socket);
+    QTimer::singleShot(m_Options.latencyMs, socket, [this, guard, state, response]() { sendResponse(guard, state, response); });
+  }
+
+  // -----------------------------------------------------------------------------
+  static bool takeRequest(QByteArray& buffer, Request& request)
+  {
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if(headerEnd < 0)
+    {
+      return false;
+    }
+
+    QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+    if(requestLine.size() < 2)
+    {
+      buffer.clear();
+      return false;
+    }
+
+    for(const QByteArray& line : lines)
+    {
+      int separator = line.indexOf(':');
+      if(separator > 0)
+      {
+        request.headers.insert(line.left(separator).trimmed().toLower(), line.mid(separator + 1).trimmed());
+      }
+    }
+
+    int contentLength = request.headers.value("content-length", "0").toInt();
+    int bodyStart = headerEnd + 4;
+    if(buffer.size() < bodyStart + contentLength)
+    {
+      return false;
+    }
+
+    request.method = requestLine[0];
+    request.url = QUrl::fromEncoded(requestLine[1]);
+    request.body = buffer.mid(bodyStart, contentLength);
+    buffer.remove(0, bodyStart + contentLength);
+    return true;
+  }
+
+  // -----------------------------------------------------------------------------
+  Response handleRequest(const Request& request)
+  {
+    const QString path = request.url.path();
+    Endpoint endpoint;
+    if(request.method == "GET" && path == "/api/files/")
+    {
+      endpoint = Endpoint::Listing;
+    }
+    else if(request.method == "GET" && path == "/api/files/download/")
+    {
+      endpoint = Endpoint::Download;
+    }
+    else if(request.method == "POST" && path == "/api/files/generate-upload-url/")
+    {
+      endpoint = Endpoint::GenerateUploadUrl;
+    }
+    else if(request.method == "PUT" && path.startsWith("/upload/"))
+    {
+      endpoint = Endpoint::Upload;
+    }
+    else if(request.method == "PATCH" && path == "/api/files/temp-to-perm/")
+    {
+      endpoint = Endpoint::TempToPerm;
+    }
+    else if(request.method == "PATCH" && path == "/api/files/")
+    {
+      endpoint = Endpoint::MetaData;
+    }
+    else
+    {
+      return CreateStatusResponse(404);
+    }
+
+    m_RequestCounts[static_cast<size_t>(endpoint)]++;
+    bool fail = m_Options.failEvery > 0 && ++m_ResponseCount % m_Options.failEvery == 0;
+    int failNextCount = m_FailNextCount;
+    while(!fail && failNextCount > 0)
+    {
+      fail = m_FailNextCount.compare_exchange_weak(failNextCount, failNextCount - 1);
+    }
+    if(fail)
+    {
+      m_InjectedErrorCount++;
+      return CreateStatusResponse(m_Options.errorStatus);
+    }
+
+    // Upload URLs are pre-signed and carry no Authorization header
+    if(endpoint != Endpoint::Upload && request.headers.value("authorization") != QByteArray("Bearer ") + k_AccessToken)
+    {
+      return CreateStatusResponse(401);
+    }
+
+    switch(endpoint)
+    {
+    case Endpoint::Listing:
+      return handleListing(request);
+    case Endpoint::Download:
+      return handleDownload(request);
+    case Endpoint::GenerateUploadUrl:
+      return handleGenerateUploadUrl();
+    case Endpoint::Upload:
+      m_UploadedBytes += request.body.size();
+      return CreateJsonResponse(QJsonObject());
+    case Endpoint::TempToPerm:
+      return CreateJsonResponse(QJsonObject());
+    case Endpoint::MetaData:
+    {
+      QMutexLocker locker(&m_Mutex);
+      m_LastMetaData = QJsonDocument::fromJson(request.body).object();
+      return CreateJsonResponse(QJsonObject());
+    }
+    }
+    return CreateStatusResponse(500);
+  }
+
+  // -----------------------------------------------------------------------------
+  Response handleListing(const Request& request)
+  {
+    // Folder IDs hold the index of every folder on their path, such as "dir-0-2"
+    const QString folderPath = QUrlQuery(request.url).queryItemValue("path", QUrl::FullyDecoded);
+    const QStringList fragments = folderPath.split(',', QString::SkipEmptyParts);
+    QString folderKey;
+    int depth = 0;
+    if(!fragments.isEmpty())
+    {
+      static const QRegularExpression folderExpr("^dir(-\\d+)+$");
+      if(!folderExpr.match(fragments.last()).hasMatch())
+      {
+        return CreateStatusResponse(404);
+      }
+      folderKey = fragments.last().mid(3);
+      depth = folderKey.count('-');
+    }
+    if(depth > m_Options.folderDepth)
+    {
+      return CreateStatusResponse(404);
+    }
+
+    // Every page of a paged listing has its own validator
+    const int page = std::max(QUrlQuery(request.url).queryItemValue("page").toInt(), 1);
+    const QString pageKey = (m_Options.maxPageSize > 0) ? QString("p%1").arg(page) : QString();
+    const QByteArray eTag = QString("\"%1%2%3\"").arg(m_Generation).arg(folderKey).arg(pageKey).toLatin1();
+    if(m_Options.sendValidators && request.headers.value("if-none-match") == eTag)
+    {
+      m_NotModifiedCount++;
+      Response response;
+      response.status = 304;
+      response.headers.append(qMakePair(QByteArray("ETag"), eTag));
+      return response;
+    }
+
+    const QString parentPath = fragments.isEmpty() ? QString(",") : QString(",%1,").arg(fragments.join(','));
+    const QString modified = QDateTime::fromSecsSinceEpoch(k_ModifiedEpoch + m_Generation, Qt::UTC).toString(Qt::ISODate);
+    QJsonArray items;
+    if(depth < m_Options.folderDepth)
+    {
+      for(int i = 0; i < m_Options.foldersPerFolder; i++)
+      {
+        items.append(CreateItem(parentPath, QString("dir%1-%2").arg(folderKey).arg(i), QString("Folder %1").arg(i), true, 0, modified));
+      }
+    }
+    for(int i = 0; i < m_Options.filesPerFolder; i++)
+    {
+      items.append(CreateItem(parentPath, QString("file%1-%2").arg(folderKey).arg(i), QString("File %1.dat").arg(i), false, m_Options.fileSize, modified));
+    }
+
+    Response response = (m_Options.maxPageSize > 0) ? CreateJsonResponse(createPage(request.url, items, page)) : CreateJsonResponse(QJsonDocument(items));
+    if(m_Options.sendValidators)
+    {
+      response.headers.append(qMakePair(QByteArray("ETag"), eTag));
+    }
+    if(m_Options.compressListings && request.headers.value("accept-encoding").contains("gzip"))
+    {
+      response.body = Gzip(response.body);
+      response.headers.append(qMakePair(QByteArray("Content-Encoding"), QByteArray("gzip")));
+      m_CompressedCount++;
+    }
+    m_ListingBytes += response.body.size();
+    return response;
+  }
+
+  // -----------------------------------------------------------------------------
+  QJsonObject createPage(const QUrl& url, const QJsonArray& items, int page) const
+  {
+    // Clients may ask for smaller pages than the server's maximum
+    QUrlQuery query(url);
+    int pageSize = m_Options.maxPageSize;
+    const int requestedSize = query.queryItemValue("page_size").toInt();
+    if(requestedSize > 0)
+    {
+      pageSize = std::min(requestedSize, pageSize);
+    }
+
+    const int first = (page - 1) * pageSize;
+    const int last = std::min(first + pageSize, items.size());
+    QJsonArray results;
+    for(int i = first; i < last; i++)
+    {
+      results.append(items[i]);
+    }
+
+    // Page links are absolute URLs
+    auto pageUrl = [this, &url, &query](int pageNumber) {
+      QUrlQuery pageQuery = query;
+      pageQuery.removeAllQueryItems("page");
+      pageQuery.addQueryItem("page", QString::number(pageNumber));
+      QUrl absoluteUrl(getBaseUrl());
+      if(!m_Options.pageLinkHost.isEmpty())
+      {
+        absoluteUrl.setHost(m_Options.pageLinkHost);
+      }
+      absoluteUrl.setPath(url.path());
+      absoluteUrl.setQuery(pageQuery);
+      return QJsonValue(absoluteUrl.toString());
+    };
+
+    QJsonObject json;
+    json["count"] = items.size();
+    json["next"] = (last < items.size()) ? pageUrl(page + 1) : QJsonValue();
+    json["previous"] = (page > 1) ? pageUrl(page - 1) : QJsonValue();
+    json["results"] = results;
+    return json;
+  }
+
+  // -----------------------------------------------------------------------------
+  Response handleDownload(const Request& request)
+  {
+    const QString fileId = QUrlQuery(request.url).queryItemValue("pk");
+    if(!fileId.startsWith("file"))
+    {
+      return CreateStatusResponse(404);
+    }
+
+    const qint64 size = m_Options.fileSize;
+    qint64 begin = 0;
+    qint64 end = size - 1;
+    Response response;
+
+    static const QRegularExpression rangeExpr("^bytes=(\\d+)-(\\d*)$");
+    QRegularExpressionMatch match = rangeExpr.match(QString::fromLatin1(request.headers.value("range")));
+    if(m_Options.supportRanges && match.hasMatch())
+    {
+      begin = match.captured(1).toLongLong();
+      if(!match.captured(2).isEmpty())
+      {
+        end = std::min(match.captured(2).toLongLong(), size - 1);
+      }
+      if(begin > end)
+      {
+        return CreateStatusResponse(416);
+      }
+      response.status = 206;
+      response.headers.append(qMakePair(QByteArray("Content-Range"), QString("bytes %1-%2/%3").arg(begin).arg(end).arg(size).toLatin1()));
+    }
+
+    response.headers.append(qMakePair(QByteArray("Content-Type"), QByteArray("application/octet-stream")));
+    response.body = FileContents(fileId, begin, end);
+
+    // A dropped body still announces its full length, so the client sees the connection close early
+    int dropNextCount = m_DropNextCount;
+    while(response.body.size() > 1 && !response.dropConnection && dropNextCount > 0)
+    {
+      response.dropConnection = m_DropNextCount.compare_exchange_weak(dropNextCount, dropNextCount - 1);
+    }
+    m_DownloadedBytes += response.dropConnection ? response.body.size() / 2 : response.body.size();
+    return response;
+  }
+
+  // -----------------------------------------------------------------------------
+  Response handleGenerateUploadUrl()
+  {
+    const int uploadId = ++m_UploadCount;
+    QJsonObject json;
+    json["url"] = QString("%1/upload/%2").arg(getBaseUrl()).arg(uploadId);
+    json["fileId"] = QString("upload-%1").arg(uploadId);
+    return CreateJsonResponse(QJsonDocument(json));
+  }
+
+  // -----------------------------------------------------------------------------
+  static QJsonObject CreateItem(const QString& parentPath, const QString& pk, const QString& name, bool isDir, qint64 size, const QString& modified)
+  {
+    QJsonObject content;
+    content["pk"] = pk;
+    content["path"] = parentPath;
+    content["name"] = name;
+    content["ftype"] = isDir ? "Folder" : "File";
+    content["size"] = size;
+    content["path_string"] = parentPath + name;
+    content["modified"] = modified;
+
+    QJsonObject item;
+    item["content"] = content;
+    item["metadata"] = QJsonArray();
+    item["permissions"] = QJsonObject();
+    item["restrictions"] = QJsonObject();
+    return item;
+  }
+
+  // -----------------------------------------------------------------------------
+  static quint32 Crc32(const QByteArray& data)
+  {
+    quint32 crc = 0xFFFFFFFF;
+    for(const char byte : data)
+    {
+      crc ^= static_cast<quint8>(byte);
+      for(int bit = 0; bit < 8; bit++)
+      {
+        crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+      }
+    }
+    return ~crc;
+  }
+
+  // -----------------------------------------------------------------------------
+  static QByteArray Gzip(const QByteArray& data)
+  {
+    // qCompress prefixes a zlib stream with the uncompressed size. Gzip wraps the same deflate
+    // data, without the zlib header and Adler-32 trailer, in its own header and trailer.
+    const QByteArray zlibData = qCompress(data, 9);
+    const QByteArray deflateData = zlibData.mid(6, zlibData.size() - 10);
+
+    QByteArray gzip("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\xff", 10);
+    gzip += deflateData;
+    const quint32 trailer[] = {Crc32(data), static_cast<quint32>(data.size())};
+    for(quint32 value : trailer)
+    {
+      for(int i = 0; i < 4; i++)
+      {
+        gzip += static_cast<char>((value >> (8 * i)) & 0xFF);
+      }
+    }
+    return gzip;
+  }
+
+  // -----------------------------------------------------------------------------
+  static Response CreateJsonResponse(const QJsonDocument& doc)
+  {
+    Response response;
+    response.headers.append(qMakePair(QByteArray("Content-Type"), QByteArray("application/json")));
+    response.body = doc.toJson(QJsonDocument::Compact);
+    return response;
+  }
+
+  // -----------------------------------------------------------------------------
+  static Response CreateJsonResponse(const QJsonObject& json)
+  {
+    return CreateJsonResponse(QJsonDocument(json));
+  }
+
+  // -----------------------------------------------------------------------------
+  static Response CreateStatusResponse(int status)
+  {
+    Response response;
+    response.status = status;
+    response.headers.append(qMakePair(QByteArray("Content-Type"), QByteArray("text/plain")));
+    response.body = QByteArray::number(status);
+    return response;
+  }
+
+  // -----------------------------------------------------------------------------
+  void sendResponse(const QPointer<QTcpSocket>& socket, const std::shared_ptr<ClientState>& state, const Response& response)
+  {
+    if(socket.isNull())
+    {
+      return;
+    }
+
+    QByteArray header = QString("HTTP/1.1 %1 Mock\r\n").arg(response.status).toLatin1();
+    for(const auto& field : response.headers)
+    {
+      header += field.first + ": " + field.second + "\r\n";
+    }
+    if(response.status != 304)
+    {
+      header += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    }
+    header += "Connection: keep-alive\r\n\r\n";
+    socket->write(header);
+
+    if(response.dropConnection)
+    {
+      writeBody(socket, state, response.body.left(response.body.size() / 2), 0, true);
+      return;
+    }
+    writeBody(socket, state, response.body, 0, false);
+  }
+
+  // -----------------------------------------------------------------------------
+  void writeBody(const QPointer<QTcpSocket>& socket, const std::shared_ptr<ClientState>& state, const QByteArray& body, int offset, bool dropConnection)
+  {
+    if(socket.isNull())
+    {
+      return;
+    }
+
+    // Throttled bodies are written a slice at a time
+    const int chunkSize = (m_Options.bytesPerSecond > 0) ? static_cast<int>(std::max<qint64>(m_Options.bytesPerSecond * k_ThrottleIntervalMs / 1000, 1)) : body.size();
+    const int count = std::min(chunkSize, body.size() - offset);
+    if(count > 0)
+    {
+      socket->write(body.constData() + offset, count);
+    }
+
+    if(offset + count < body.size())
+    {
+      QTimer::singleShot(k_ThrottleIntervalMs, socket.data(), [this, socket, state, body, offset, count, dropConnection]() {
+        writeBody(socket, state, body, offset + count, dropConnection);
+      });
+      return;
+    }
+
+    // Pending data is still sent before the connection closes
+    if(dropConnection)
+    {
+      socket->disconnectFromHost();
+      return;
+    }
+
+    state->busy = false;
+    processRequests(socket.data(), state);
+  }
+
+  Options m_Options;
+  QThread* m_Thread = nullptr;
+  QTcpServer* m_Server = nullptr;
+  quint16 m_Port = 0;
+
+  std::array<std::atomic<int>, k_EndpointCount> m_RequestCounts;
+  std::atomic<int> m_Generation{0};
+  std::atomic<int> m_ConnectionCount{0};
+  std::atomic<int> m_ResponseCount{0};
+  std::atomic<int> m_NotModifiedCount{0};
+  std::atomic<int> m_InjectedErrorCount{0};
+  std::atomic<int> m_FailNextCount{0};
+  std::atomic<int> m_DropNextCount{0};
+  std::atomic<int> m_CompressedCount{0};
+  std::atomic<qint64> m_ListingBytes{0};
+  std::atomic<qint64> m_DownloadedBytes{0};
+  std::atomic<int> m_UploadCount{0};
+  std::atomic<qint64> m_UploadedBytes{0};
+
+  mutable QMutex m_Mutex;
+  QJsonObject m_LastMetaData;
+};
@@ -0,0 +1,1072 @@
+/* ============================================================================
+ * Copyright (c) 2020-2020 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-15-D-5231
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <set>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+#include <QtCore/QUrl>
+
+#include "SIMPLib/SIMPLib.h"
+
+#include "UnitTestSupport.hpp"
+
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTFileInfoModel.h"
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTTrace.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTDownloadRequest.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileInfoRequest.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileLookupRequest.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTFileUploadRequest.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTRequestGroup.h"
+#include "HyperThoughtUtilities/HyperThoughtRequests/HTUpdateMetaDataRequest.h"
+
+#include "HTMockServer.hpp"
+
+class HTRequestTest
+{
+
+public:
+  HTRequestTest() = default;
+  ~HTRequestTest() = default;
+  HTRequestTest(const HTRequestTest&) = delete;            // Copy Constructor
+  HTRequestTest(HTRequestTest&&) = delete;                 // Move Constructor
+  HTRequestTest& operator=(const HTRequestTest&) = delete; // Copy Assignment
+  HTRequestTest& operator=(HTRequestTest&&) = delete;      // Move Assignment
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  HTFilePath createProjectPath(const QString& path)
+  {
+    HTFilePath filePath;
+    filePath.setScopeType(HTFilePath::ScopeType::Project);
+    filePath.setSourceId("mock-project");
+    filePath.setPath(path);
+    return filePath;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  HTFileInfoTree::ConstPointer crawl(HTConnection& connection)
+  {
+    HTFileInfoTree::ConstPointer infoTree;
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    QObject::connect(&request, &HTFileInfoRequest::infoReceived, &request, [&infoTree](HTFileInfoTree::ConstPointer tree) { infoTree = tree; }, Qt::DirectConnection);
+    request.exec();
+    return infoTree;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestCrawl()
+  {
+    HTMockServer::Options options;
+    options.folderDepth = 3;
+    options.foldersPerFolder = 4;
+    options.filesPerFolder = 20;
+    options.latencyMs = 20;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoTree::ConstPointer infoTree = crawl(connection);
+
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(infoTree->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), static_cast<int>(server.getFolderCount() + 1))
+    DREAM3D_REQUIRE(nullptr != infoTree->findNodeById("file-3-3-3-19"))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestRevalidation()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+    const int listingCount = static_cast<int>(server.getFolderCount() + 1);
+
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoTree::ConstPointer infoTree = crawl(connection);
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(server.getNotModifiedCount(), 0)
+
+    // Every listing is unchanged, so the tree is rebuilt from the cache
+    infoTree = crawl(connection);
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(infoTree->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE_EQUAL(server.getNotModifiedCount(), listingCount)
+
+    server.touchTree();
+    infoTree = crawl(connection);
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(infoTree->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE_EQUAL(server.getNotModifiedCount(), listingCount)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestSubtreeRefresh()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+    const size_t treeSize = server.getFolderCount() + server.getFileCount();
+
+    HTConnection connection(server.createApiAccess());
+    DREAM3D_REQUIRE(nullptr != crawl(connection))
+    const int crawlCount = server.getRequestCount(HTMockServer::Endpoint::Listing);
+
+    // Refreshing one folder lists that folder and its subfolders only and keeps the rest of the scope cached
+    HTFileInfoRequest request(&connection, createProjectPath(",dir-1,"));
+    request.exec();
+    const int subfolderCount = HTMockServer::Options().foldersPerFolder;
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), crawlCount + 1 + subfolderCount)
+
+    HTFileInfoTree::ConstPointer scopeTree = connection.getFileCache().getFileInfoTree(createProjectPath(","));
+    DREAM3D_REQUIRE_EQUAL(scopeTree->size(), treeSize)
+    DREAM3D_REQUIRE(nullptr != scopeTree->findNodeById("file-0-0"))
+    DREAM3D_REQUIRE_EQUAL(scopeTree->findNodeById("file-1-2")->parent->fileInfo.getId(), QString("dir-1-2"))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestFileLookup()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+    HTConnection connection(server.createApiAccess());
+
+    // Only the folders along the path are listed
+    HTFilePath filePath = createProjectPath(",dir-1,dir-1-2,file-1-2-3,");
+    HTFileLookupRequest request(&connection, filePath);
+    request.exec();
+    DREAM3D_REQUIRE_EQUAL(request.getFileInfo().getId(), QString("file-1-2-3"))
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), 3)
+    DREAM3D_REQUIRE(connection.getFileCache().hasFileInfo(filePath))
+    DREAM3D_REQUIRE(connection.getFileCache().getFileInfoTree(filePath)->size() == 3)
+
+    // Folders that are already cached are not listed again
+    HTFileLookupRequest siblingRequest(&connection, createProjectPath(",dir-1,file-1-4,"));
+    siblingRequest.exec();
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), 4)
+    DREAM3D_REQUIRE(connection.getFileCache().hasFileInfo(createProjectPath(",dir-1,file-1-4,")))
+
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    HTFileLookupRequest missingRequest(&connection, createProjectPath(",dir-1,missing,"));
+    QObject::connect(&missingRequest, &HTFileLookupRequest::requestFailed, &missingRequest, [&error](QNetworkReply::NetworkError err) { error = err; }, Qt::DirectConnection);
+    missingRequest.exec();
+    DREAM3D_REQUIRE(error == QNetworkReply::ContentNotFoundError)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestCompressedListing()
+  {
+    HTMockServer::Options options;
+    options.compressListings = true;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    // Qt decompresses gzip listings but keeps their Content-Encoding header
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoTree::ConstPointer infoTree = crawl(connection);
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(infoTree->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE_EQUAL(server.getCompressedCount(), server.getRequestCount(HTMockServer::Endpoint::Listing))
+    connection.getFileCacheRef().clear();
+
+    HTFileLookupRequest lookup(&connection, createProjectPath(",dir-1,file-1-4,"));
+    lookup.exec();
+    DREAM3D_REQUIRE_EQUAL(lookup.getFileInfo().getId(), QString("file-1-4"))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestSharedListings()
+  {
+    HTMockServer::Options options;
+    options.latencyMs = 50;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    // Two crawls of the same scope running at once cost a single crawl
+    HTConnection connection(server.createApiAccess());
+    HTRequestGroup group;
+    group.addRequest(new HTFileInfoRequest(&connection, createProjectPath(",")));
+    group.addRequest(new HTFileInfoRequest(&connection, createProjectPath(",")));
+    group.exec();
+
+    DREAM3D_REQUIRE(!group.hasFailed())
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), static_cast<int>(server.getFolderCount() + 1))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestGroupFailure()
+  {
+    HTMockServer::Options options;
+    options.fileSize = 4 * 1024 * 1024;
+    options.bytesPerSecond = 1024 * 1024;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    DREAM3D_REQUIRE(nullptr != crawl(connection))
+    QTemporaryDir downloadDir;
+    DREAM3D_REQUIRE(downloadDir.isValid())
+
+    // The download takes seconds and is still running when the listing of a missing folder fails
+    HTRequestGroup group(2);
+    HTDownloadRequest* download = new HTDownloadRequest(&connection, createProjectPath(",dir-1,file-1-4,"));
+    download->setDownloadDir(QDir(downloadDir.path()));
+    download->setDownloadName("download.dat");
+    download->setMaxStreams(1);
+    std::atomic<int> downloadError(QNetworkReply::NoError);
+    QObject::connect(download, &HTDownloadRequest::requestFailed, download, [&downloadError](QNetworkReply::NetworkError err) { downloadError = err; }, Qt::DirectConnection);
+    group.addRequest(download);
+    group.addRequest(new HTFileInfoRequest(&connection, createProjectPath(",missing,")));
+
+    // Requests beyond the concurrency limit are waiting
+    std::atomic<int> waitingSignalCount(0);
+    for(const QString& path : {QString(",dir-0,"), QString(",dir-1,"), QString(",dir-2,")})
+    {
+      HTFileInfoRequest* request = new HTFileInfoRequest(&connection, createProjectPath(path));
+      QObject::connect(request, &HTFileInfoRequest::finished, request, [&waitingSignalCount]() { waitingSignalCount++; }, Qt::DirectConnection);
+      QObject::connect(request, &HTFileInfoRequest::requestFailed, request, [&waitingSignalCount]() { waitingSignalCount++; }, Qt::DirectConnection);
+      group.addRequest(request);
+    }
+
+    const int listingCount = server.getRequestCount(HTMockServer::Endpoint::Listing);
+    QElapsedTimer timer;
+    timer.start();
+    group.exec();
+
+    // The synchronous exec returns long before the download could have finished
+    DREAM3D_REQUIRE(timer.elapsed() < 1000 * options.fileSize / options.bytesPerSecond / 2)
+    DREAM3D_REQUIRE(group.hasFailed())
+    DREAM3D_REQUIRE_EQUAL(group.getError(), QNetworkReply::ContentNotFoundError)
+    DREAM3D_REQUIRE_EQUAL(group.getFinishedCount(), static_cast<size_t>(0))
+    DREAM3D_REQUIRE_EQUAL(downloadError.load(), static_cast<int>(QNetworkReply::OperationCanceledError))
+    DREAM3D_REQUIRE_EQUAL(waitingSignalCount.load(), 0)
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), listingCount + 1)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestDeleteWhileRunning()
+  {
+    HTMockServer::Options options;
+    options.latencyMs = 50;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    // Deleting a running request on this thread stops its callbacks on the network thread
+    HTConnection connection(server.createApiAccess());
+    std::atomic<int> signalCount(0);
+    HTFileInfoRequest* request = new HTFileInfoRequest(&connection, createProjectPath(","), true);
+    QObject::connect(request, &HTFileInfoRequest::finished, [&signalCount]() { signalCount++; });
+    QObject::connect(request, &HTFileInfoRequest::requestFailed, [&signalCount]() { signalCount++; });
+    request->exec();
+
+    DREAM3D_REQUIRE(waitFor([&server]() { return server.getRequestCount(HTMockServer::Endpoint::Listing) > 0; }))
+    delete request;
+
+    QThread::msleep(5 * options.latencyMs);
+    QCoreApplication::processEvents();
+    DREAM3D_REQUIRE_EQUAL(signalCount.load(), 0)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  bool waitFor(const std::function<bool()>& condition)
+  {
+    // Listings reach the model through queued signals, so this thread has to process events
+    QElapsedTimer timer;
+    timer.start();
+    while(!condition() && timer.elapsed() < 10000)
+    {
+      QCoreApplication::processEvents();
+      QThread::msleep(5);
+    }
+    return condition();
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestLazyModel()
+  {
+    HTMockServer::Options options;
+    options.latencyMs = 20;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoModel model;
+    int fetchedCount = 0;
+    QObject::connect(&model, &HTFileInfoModel::folderFetched, [&fetchedCount]() { fetchedCount++; });
+
+    // The source folder is usable after a single listing
+    model.setSource(&connection, createProjectPath(","));
+    DREAM3D_REQUIRE(waitFor([&fetchedCount]() { return fetchedCount > 0; }))
+    DREAM3D_REQUIRE_EQUAL(model.rowCount(), options.foldersPerFolder + options.filesPerFolder)
+    DREAM3D_REQUIRE(!model.canFetchMore(QModelIndex()))
+
+    // Only the folders one level down are prefetched
+    const int prefetchedCount = 1 + options.foldersPerFolder;
+    DREAM3D_REQUIRE(waitFor([&fetchedCount, prefetchedCount]() { return fetchedCount == prefetchedCount; }))
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), prefetchedCount)
+
+    QModelIndex folder = model.index(0, 0);
+    DREAM3D_REQUIRE(model.isDir(folder))
+    DREAM3D_REQUIRE(!model.canFetchMore(folder))
+    DREAM3D_REQUIRE_EQUAL(model.rowCount(folder), options.foldersPerFolder + options.filesPerFolder)
+
+    // Expanding a folder that was not prefetched lists it on demand
+    QModelIndex subFolder = model.index(0, 0, folder);
+    DREAM3D_REQUIRE(model.isDir(subFolder))
+    DREAM3D_REQUIRE(model.hasChildren(subFolder))
+    DREAM3D_REQUIRE(model.canFetchMore(subFolder))
+    DREAM3D_REQUIRE_EQUAL(model.rowCount(subFolder), 0)
+    DREAM3D_REQUIRE(model.parent(subFolder) == folder)
+
+    model.fetchMore(subFolder);
+    DREAM3D_REQUIRE(!model.canFetchMore(subFolder))
+    DREAM3D_REQUIRE(waitFor([&fetchedCount, prefetchedCount]() { return fetchedCount == prefetchedCount + 1; }))
+    DREAM3D_REQUIRE_EQUAL(model.rowCount(subFolder), options.filesPerFolder)
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), prefetchedCount + 1)
+    DREAM3D_REQUIRE(model.parent(model.index(0, 0, subFolder)) == subFolder)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestBrowsedFolders()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+    const HTMockServer::Options options;
+    const size_t folderSize = options.foldersPerFolder + options.filesPerFolder;
+
+    // Listing the scope root creates the cached tree
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoRequest rootRequest(&connection, createProjectPath(","));
+    rootRequest.setRecursive(false);
+    rootRequest.exec();
+    DREAM3D_REQUIRE(connection.getFileCache().hasFileInfo(createProjectPath(",dir-1,")))
+    DREAM3D_REQUIRE_EQUAL(connection.getFileCache().getFileInfoTree(createProjectPath(","))->size(), folderSize)
+
+    // Browsing into a folder adds its items so preflight can find them
+    HTFileInfoRequest folderRequest(&connection, createProjectPath(",dir-1,"));
+    folderRequest.setRecursive(false);
+    folderRequest.exec();
+    DREAM3D_REQUIRE(connection.getFileCache().hasFileInfo(createProjectPath(",dir-1,file-1-4,")))
+    DREAM3D_REQUIRE_EQUAL(connection.getFileCache().getFileInfoTree(createProjectPath(","))->size(), 2 * folderSize)
+
+    // Listing the root again keeps the crawled subfolders
+    DREAM3D_REQUIRE(nullptr != crawl(connection))
+    HTFileInfoRequest refreshRequest(&connection, createProjectPath(","));
+    refreshRequest.setRecursive(false);
+    refreshRequest.exec();
+    DREAM3D_REQUIRE_EQUAL(connection.getFileCache().getFileInfoTree(createProjectPath(","))->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE(connection.getFileCache().hasFileInfo(createProjectPath(",dir-1,dir-1-2,file-1-2-3,")))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestPagedListing()
+  {
+    HTMockServer::Options options;
+    options.maxPageSize = 4;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+    const int itemCount = options.foldersPerFolder + options.filesPerFolder;
+    const int pageCount = (itemCount + options.maxPageSize - 1) / options.maxPageSize;
+
+    // Every page is emitted as it arrives
+    HTConnection connection(server.createApiAccess());
+    std::vector<size_t> pageSizes;
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    request.setRecursive(false);
+    QObject::connect(&request, &HTFileInfoRequest::pageReceived, &request, [&pageSizes](const HTFilePath&, HTFileInfoTree::ConstPointer page) { pageSizes.push_back(page->size()); },
+                     Qt::DirectConnection);
+    request.exec();
+    DREAM3D_REQUIRE(pageSizes.size() == static_cast<size_t>(pageCount))
+    DREAM3D_REQUIRE(pageSizes.front() == static_cast<size_t>(options.maxPageSize))
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), pageCount)
+
+    // Crawls follow every page of every folder
+    HTFileInfoTree::ConstPointer infoTree = crawl(connection);
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(infoTree->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE(nullptr != infoTree->findNodeById("file-1-2-9"))
+    connection.getFileCacheRef().clear();
+
+    // Lookups search the pages of a folder until they find the item
+    HTFileLookupRequest lookup(&connection, createProjectPath(",dir-2,file-2-9,"));
+    lookup.exec();
+    DREAM3D_REQUIRE_EQUAL(lookup.getFileInfo().getId(), QString("file-2-9"))
+
+    // The model inserts every page of a folder
+    HTFileInfoModel model;
+    int fetchedCount = 0;
+    QObject::connect(&model, &HTFileInfoModel::folderFetched, [&fetchedCount]() { fetchedCount++; });
+    model.setSource(&connection, createProjectPath(","));
+    const int prefetchedCount = 1 + options.foldersPerFolder;
+    DREAM3D_REQUIRE(waitFor([&fetchedCount, prefetchedCount]() { return fetchedCount == prefetchedCount; }))
+    DREAM3D_REQUIRE_EQUAL(model.rowCount(), itemCount)
+    DREAM3D_REQUIRE_EQUAL(model.rowCount(model.index(0, 0)), itemCount)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestCrossOriginPages()
+  {
+    // Page links name the same server by another host, which is a different origin
+    HTMockServer::Options options;
+    options.maxPageSize = 4;
+    options.pageLinkHost = "localhost";
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    request.setRecursive(false);
+    QObject::connect(&request, &HTFileInfoRequest::requestFailed, &request, [&error](QNetworkReply::NetworkError err) { error = err; }, Qt::DirectConnection);
+    request.exec();
+    DREAM3D_REQUIRE(error == QNetworkReply::InsecureRedirectError)
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), 1)
+
+    // The lookup finds dir-0 on the first page of the root but not file-0-9 on the first page of dir-0
+    error = QNetworkReply::NoError;
+    HTFileLookupRequest lookup(&connection, createProjectPath(",dir-0,file-0-9,"));
+    QObject::connect(&lookup, &HTFileLookupRequest::requestFailed, &lookup, [&error](QNetworkReply::NetworkError err) { error = err; }, Qt::DirectConnection);
+    lookup.exec();
+    DREAM3D_REQUIRE(error == QNetworkReply::InsecureRedirectError)
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), 3)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestDownload()
+  {
+    HTMockServer::Options options;
+    options.fileSize = 1024 * 1024;
+    options.bytesPerSecond = 8 * 1024 * 1024;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    DREAM3D_REQUIRE(nullptr != crawl(connection))
+
+    QTemporaryDir downloadDir;
+    DREAM3D_REQUIRE(downloadDir.isValid())
+
+    HTDownloadRequest request(&connection, createProjectPath(",dir-1,file-1-4,"));
+    request.setDownloadDir(QDir(downloadDir.path()));
+    request.setDownloadName("download.dat");
+    request.setMaxStreams(4);
+    request.setMinSegmentSize(128 * 1024);
+
+    request.exec();
+
+    // The probe and one request per stream
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Download), 5)
+
+    QFile file(downloadDir.filePath("download.dat"));
+    DREAM3D_REQUIRE(file.open(QIODevice::ReadOnly))
+    DREAM3D_REQUIRE(file.readAll() == HTMockServer::FileContents("file-1-4", 0, options.fileSize - 1))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestDownloadResume()
+  {
+    HTMockServer::Options options;
+    options.fileSize = 1024 * 1024;
+    options.bytesPerSecond = 8 * 1024 * 1024;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    DREAM3D_REQUIRE(nullptr != crawl(connection))
+
+    QTemporaryDir downloadDir;
+    DREAM3D_REQUIRE(downloadDir.isValid())
+    const QString targetPath = downloadDir.filePath("download.dat");
+    const QString checkpointPath = targetPath + ".htdownload";
+    const QByteArray contents = HTMockServer::FileContents("file-1-4", 0, options.fileSize - 1);
+
+    // Interrupted segments are not retried, so the first failure ends the download
+    HTRequestScheduler::RetryPolicy policy;
+    policy.maxAttempts = 1;
+    auto download = [this, &connection, &downloadDir, &policy]() {
+      HTDownloadRequest request(&connection, createProjectPath(",dir-1,file-1-4,"));
+      request.setDownloadDir(QDir(downloadDir.path()));
+      request.setDownloadName("download.dat");
+      request.setMaxStreams(2);
+      request.setMinSegmentSize(128 * 1024);
+      request.setResumeEnabled(true);
+      request.setRetryPolicy(policy);
+      bool failed = false;
+      QObject::connect(&request, &HTDownloadRequest::requestFailed, &request, [&failed]() { failed = true; }, Qt::DirectConnection);
+      request.exec();
+      return !failed;
+    };
+
+    // The connection closes halfway through one of the two segments and leaves a checkpoint
+    server.dropNextDownloads(1);
+    DREAM3D_REQUIRE(!download())
+    DREAM3D_REQUIRE(QFile::exists(checkpointPath))
+
+    // Resuming skips the probe, requests the unfinished segments only and keeps at least the first half of the dropped one
+    int downloadCount = server.getRequestCount(HTMockServer::Endpoint::Download);
+    qint64 downloadedBytes = server.getDownloadedBytes();
+    DREAM3D_REQUIRE(download())
+    const int resumedCount = server.getRequestCount(HTMockServer::Endpoint::Download) - downloadCount;
+    DREAM3D_REQUIRE(resumedCount >= 1 && resumedCount <= 2)
+    DREAM3D_REQUIRE(server.getDownloadedBytes() - downloadedBytes <= options.fileSize - options.fileSize / 4)
+    DREAM3D_REQUIRE(!QFile::exists(checkpointPath))
+    {
+      QFile file(targetPath);
+      DREAM3D_REQUIRE(file.open(QIODevice::ReadOnly))
+      DREAM3D_REQUIRE(file.readAll() == contents)
+    }
+
+    // A partial file of an older revision is discarded and the whole file is downloaded again
+    server.dropNextDownloads(1);
+    DREAM3D_REQUIRE(!download())
+    DREAM3D_REQUIRE(QFile::exists(checkpointPath))
+    server.touchTree();
+    DREAM3D_REQUIRE(nullptr != crawl(connection))
+
+    downloadCount = server.getRequestCount(HTMockServer::Endpoint::Download);
+    downloadedBytes = server.getDownloadedBytes();
+    DREAM3D_REQUIRE(download())
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Download) - downloadCount, 3)
+    DREAM3D_REQUIRE_EQUAL(server.getDownloadedBytes() - downloadedBytes, options.fileSize + 1)
+    DREAM3D_REQUIRE(!QFile::exists(checkpointPath))
+    {
+      QFile file(targetPath);
+      DREAM3D_REQUIRE(file.open(QIODevice::ReadOnly))
+      DREAM3D_REQUIRE(file.readAll() == contents)
+    }
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestUploadWithMetaData()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+
+    QTemporaryDir uploadDir;
+    DREAM3D_REQUIRE(uploadDir.isValid())
+    QFile file(uploadDir.filePath("upload.dat"));
+    DREAM3D_REQUIRE(file.open(QIODevice::WriteOnly))
+    const QByteArray contents = HTMockServer::FileContents("upload", 0, 256 * 1024 - 1);
+    file.write(contents);
+    file.close();
+
+    HTMetaData metaData;
+    metaData.setValue("Sample", "Mock");
+
+    HTConnection connection(server.createApiAccess());
+    HTFileUploadRequest request(&connection, createProjectPath(",dir-0,"), file.fileName());
+    request.setMetaData(true, metaData);
+    request.exec();
+
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::GenerateUploadUrl), 1)
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::TempToPerm), 1)
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::MetaData), 1)
+    DREAM3D_REQUIRE_EQUAL(server.getUploadedBytes(), static_cast<qint64>(contents.size()))
+    DREAM3D_REQUIRE_EQUAL(server.getLastMetaData()["file_id"].toString(), QString("upload-1"))
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestUploadRetries()
+  {
+    QTemporaryDir uploadDir;
+    DREAM3D_REQUIRE(uploadDir.isValid())
+    QFile file(uploadDir.filePath("upload.dat"));
+    DREAM3D_REQUIRE(file.open(QIODevice::WriteOnly))
+    file.write(HTMockServer::FileContents("upload", 0, 64 * 1024 - 1));
+    file.close();
+
+    HTMetaData metaData;
+    metaData.setValue("Sample", "Mock");
+
+    HTRequestScheduler::RetryPolicy policy;
+    policy.baseDelayMs = 10;
+    policy.maxDelayMs = 50;
+
+    // The upload sends POST, PUT, temp-to-perm PATCH and metadata PATCH in that order
+    {
+      HTMockServer::Options options;
+      options.failEvery = 4;
+      HTMockServer server(options);
+      DREAM3D_REQUIRE(server.start())
+
+      // The metadata patch opts in to retries
+      HTConnection connection(server.createApiAccess());
+      HTFileUploadRequest request(&connection, createProjectPath(",dir-0,"), file.fileName());
+      request.setRetryPolicy(policy);
+      request.setMetaData(true, metaData);
+      bool failed = false;
+      QObject::connect(&request, &HTFileUploadRequest::requestFailed, &request, [&failed]() { failed = true; }, Qt::DirectConnection);
+      request.exec();
+
+      DREAM3D_REQUIRE(!failed)
+      DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::MetaData), 2)
+    }
+
+    {
+      HTMockServer::Options options;
+      options.failEvery = 3;
+      HTMockServer server(options);
+      DREAM3D_REQUIRE(server.start())
+
+      // Moving the file to its permanent location is not repeated
+      HTConnection connection(server.createApiAccess());
+      HTFileUploadRequest request(&connection, createProjectPath(",dir-0,"), file.fileName());
+      request.setRetryPolicy(policy);
+      bool failed = false;
+      QObject::connect(&request, &HTFileUploadRequest::requestFailed, &request, [&failed]() { failed = true; }, Qt::DirectConnection);
+      request.exec();
+
+      DREAM3D_REQUIRE(failed)
+      DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::TempToPerm), 1)
+    }
+
+    {
+      HTMockServer server;
+      DREAM3D_REQUIRE(server.start())
+      server.failNext(1);
+
+      // Tagging sends the same patch as the upload and retries it the same way
+      HTConnection connection(server.createApiAccess());
+      HTUpdateMetaDataRequest request(&connection, "file-0-0", metaData);
+      request.setRetryPolicy(policy);
+      bool updated = false;
+      QObject::connect(&request, &HTUpdateMetaDataRequest::metaDataUpdated, &request, [&updated]() { updated = true; }, Qt::DirectConnection);
+      request.exec();
+
+      DREAM3D_REQUIRE(updated)
+      DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::MetaData), 2)
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestTransientErrors()
+  {
+    HTMockServer::Options options;
+    options.failEvery = 3;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTRequestScheduler::RetryPolicy policy;
+    policy.baseDelayMs = 10;
+    policy.maxDelayMs = 50;
+
+    // Every third response is a 503 that the scheduler retries
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoTree::ConstPointer infoTree;
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    request.setRetryPolicy(policy);
+    QObject::connect(&request, &HTFileInfoRequest::infoReceived, &request, [&infoTree](HTFileInfoTree::ConstPointer tree) { infoTree = tree; }, Qt::DirectConnection);
+    request.exec();
+
+    DREAM3D_REQUIRE(nullptr != infoTree)
+    DREAM3D_REQUIRE_EQUAL(infoTree->size(), server.getFolderCount() + server.getFileCount())
+    DREAM3D_REQUIRE(server.getInjectedErrorCount() > 0)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestCanceledProbe()
+  {
+    HTMockServer::Options options;
+    options.latencyMs = 200;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    HTRequestScheduler* scheduler = connection.getScheduler();
+    scheduler->setBreakerCooldown(50);
+    HTRequestScheduler::RetryPolicy policy;
+    policy.maxAttempts = 1;
+
+    // Consecutive 503s open the breaker
+    server.failNext(HTRequestScheduler::k_BreakerThreshold);
+    for(int i = 0; i < HTRequestScheduler::k_BreakerThreshold; i++)
+    {
+      HTFileInfoRequest request(&connection, createProjectPath(","));
+      request.setRecursive(false);
+      request.setRetryPolicy(policy);
+      request.exec();
+    }
+    DREAM3D_REQUIRE(scheduler->isCircuitOpen())
+
+    // The first request after the cooldown is the probe. Cancel it while the server holds the response.
+    const int listingCount = server.getRequestCount(HTMockServer::Endpoint::Listing);
+    HTFileInfoRequest probe(&connection, createProjectPath(","), true);
+    probe.setRecursive(false);
+    probe.exec();
+    DREAM3D_REQUIRE(waitFor([&server, listingCount]() { return server.getRequestCount(HTMockServer::Endpoint::Listing) > listingCount; }))
+    probe.cancel();
+
+    // The next request probes in its place and closes the breaker
+    std::atomic<bool> received(false);
+    HTFileInfoRequest request(&connection, createProjectPath(","), true);
+    request.setRecursive(false);
+    QObject::connect(&request, &HTFileInfoRequest::infoReceived, &request, [&received]() { received = true; }, Qt::DirectConnection);
+    request.exec();
+    DREAM3D_REQUIRE(waitFor([&received]() { return received.load(); }))
+    DREAM3D_REQUIRE(!scheduler->isCircuitOpen())
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestWarmUp()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+
+    // The connection opens a socket to the server before anything is requested
+    HTConnection connection(server.createApiAccess());
+    DREAM3D_REQUIRE(waitFor([&server]() { return server.getConnectionCount() == 1; }))
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), 0)
+
+    // The first request is sent on the warmed-up socket instead of opening another one
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    request.setRecursive(false);
+    request.exec();
+    DREAM3D_REQUIRE_EQUAL(server.getRequestCount(HTMockServer::Endpoint::Listing), 1)
+    DREAM3D_REQUIRE_EQUAL(server.getConnectionCount(), 1)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestHttp2Fallback()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+
+    HTConnection connection(server.createApiAccess());
+    DREAM3D_REQUIRE(connection.isHttp2Enabled())
+    std::atomic<int> fallbackCount(0);
+    QObject::connect(&connection, &HTConnection::http2Disabled, &connection, [&fallbackCount]() { fallbackCount++; }, Qt::DirectConnection);
+
+    // The mock server only speaks HTTP/1.1, so the first reply turns HTTP/2 off
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    request.setRecursive(false);
+    request.exec();
+    DREAM3D_REQUIRE(waitFor([&connection]() { return !connection.isHttp2Enabled(); }))
+    DREAM3D_REQUIRE_EQUAL(fallbackCount.load(), 1)
+    DREAM3D_REQUIRE_EQUAL(connection.getScheduler()->getMaxActive(HTRequestScheduler::Lane::MetaData), HTRequestScheduler::k_DefaultMetaDataLimit)
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestReleasedConnection()
+  {
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+
+    QTemporaryDir metricsDir;
+    DREAM3D_REQUIRE(metricsDir.isValid())
+    QString metricsPath = metricsDir.filePath("metrics.txt");
+    qputenv("HT_METRICS_FILE", metricsPath.toLocal8Bit());
+
+    // The test thread never returns to an event loop, so a deferred deletion would never run
+    std::shared_ptr<HTConnection> connection = HTConnection::GetConnection(server.createApiAccess());
+    DREAM3D_REQUIRE(nullptr != crawl(*connection))
+    connection->getFileCacheRef().clear();
+    connection.reset();
+    qunsetenv("HT_METRICS_FILE");
+
+    DREAM3D_REQUIRE(QFile::exists(metricsPath))
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestMetrics()
+  {
+    HTMockServer::Options options;
+    options.latencyMs = 20;
+    options.failEvery = 4;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    HTRequestScheduler::RetryPolicy policy;
+    policy.baseDelayMs = 10;
+    policy.maxDelayMs = 50;
+
+    HTConnection connection(server.createApiAccess());
+    HTFileInfoRequest request(&connection, createProjectPath(","));
+    request.setRetryPolicy(policy);
+    request.exec();
+
+    // Every attempt is recorded, including the ones that were retried
+    const HTMetrics::EndpointMetrics* listing = connection.getMetrics().getEndpointMetrics("GET /api/files/");
+    DREAM3D_REQUIRE(nullptr != listing)
+    const quint64 injectedErrors = static_cast<quint64>(server.getInjectedErrorCount());
+    DREAM3D_REQUIRE(injectedErrors > 0)
+    DREAM3D_REQUIRE_EQUAL(listing->getRequestCount(), static_cast<quint64>(server.getRequestCount(HTMockServer::Endpoint::Listing)))
+    DREAM3D_REQUIRE_EQUAL(listing->outcomes[static_cast<size_t>(HTMetrics::Outcome::HttpError)].load(), injectedErrors)
+    DREAM3D_REQUIRE_EQUAL(listing->retries.load(), injectedErrors)
+    DREAM3D_REQUIRE_EQUAL(listing->outcomes[static_cast<size_t>(HTMetrics::Outcome::Success)].load(), static_cast<quint64>(server.getFolderCount() + 1))
+    DREAM3D_REQUIRE_EQUAL(listing->firstByte.getCount(), listing->getRequestCount())
+    DREAM3D_REQUIRE(listing->latency.getMax() >= options.latencyMs)
+    DREAM3D_REQUIRE(listing->bytesIn.load() > 0)
+
+    QJsonObject json = connection.getMetrics().toJson();
+    DREAM3D_REQUIRE(json.contains("GET /api/files/"))
+    DREAM3D_REQUIRE(connection.getMetrics().toText().contains("GET /api/files/"))
+
+    DREAM3D_REQUIRE_EQUAL(HTMetrics::EndpointName("PUT", QUrl("https://example.com/upload/3f2a9c/part?sig=1")), QString("PUT /upload/:id/part"))
+
+    connection.getFileCacheRef().clear();
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  int TestTrace()
+  {
+    // The environment variable overrides the output file, so leave a user's trace alone
+    if(!qEnvironmentVariableIsEmpty("HT_TRACE_FILE"))
+    {
+      return EXIT_SUCCESS;
+    }
+
+    HTMockServer::Options options;
+    options.latencyMs = 10;
+    HTMockServer server(options);
+    DREAM3D_REQUIRE(server.start())
+
+    QTemporaryDir traceDir;
+    DREAM3D_REQUIRE(traceDir.isValid())
+    QString tracePath = traceDir.filePath("trace.json");
+    HTTrace::SetOutputFile(tracePath);
+    DREAM3D_REQUIRE(HTTrace::IsEnabled())
+
+    {
+      HTConnection connection(server.createApiAccess());
+      DREAM3D_REQUIRE(nullptr != crawl(connection))
+      connection.getFileCacheRef().clear();
+    }
+
+    DREAM3D_REQUIRE(HTTrace::Flush())
+    HTTrace::SetOutputFile(QString());
+    DREAM3D_REQUIRE(!HTTrace::IsEnabled())
+
+    QFile traceFile(tracePath);
+    DREAM3D_REQUIRE(traceFile.open(QIODevice::ReadOnly))
+    QJsonArray events = QJsonDocument::fromJson(traceFile.readAll()).object()["traceEvents"].toArray();
+
+    // One network span per listing, spread over several tracks, and one async span for the request
+    int networkSpans = 0;
+    int requestSpans = 0;
+    std::set<qint64> networkTracks;
+    for(const QJsonValue& value : events)
+    {
+      QJsonObject event = value.toObject();
+      if(event["cat"].toString() == "network" && event["name"].toString() == "GET /api/files/")
+      {
+        networkSpans++;
+        networkTracks.insert(event["tid"].toVariant().toLongLong());
+        DREAM3D_REQUIRE(event["dur"].toDouble() > 0)
+      }
+      else if(event["cat"].toString() == "request" && event["ph"].toString() == "b")
+      {
+        requestSpans++;
+        DREAM3D_REQUIRE_EQUAL(event["name"].toString(), QString("HTFileInfoRequest"))
+      }
+    }
+    DREAM3D_REQUIRE_EQUAL(networkSpans, server.getRequestCount(HTMockServer::Endpoint::Listing))
+    DREAM3D_REQUIRE(networkTracks.size() > 1)
+    DREAM3D_REQUIRE_EQUAL(requestSpans, 1)
+
+    return EXIT_SUCCESS;
+  }
+
+  // -----------------------------------------------------------------------------
+  //
+  // -----------------------------------------------------------------------------
+  void operator()()
+  {
+    int err = EXIT_SUCCESS;
+
+    DREAM3D_REGISTER_TEST(TestCrawl())
+
+    DREAM3D_REGISTER_TEST(TestRevalidation())
+
+    DREAM3D_REGISTER_TEST(TestSubtreeRefresh())
+
+    DREAM3D_REGISTER_TEST(TestFileLookup())
+
+    DREAM3D_REGISTER_TEST(TestCompressedListing())
+
+    DREAM3D_REGISTER_TEST(TestSharedListings())
+    DREAM3D_REGISTER_TEST(TestGroupFailure())
+
+    DREAM3D_REGISTER_TEST(TestDeleteWhileRunning())
+
+    DREAM3D_REGISTER_TEST(TestLazyModel())
+
+    DREAM3D_REGISTER_TEST(TestBrowsedFolders())
+
+    DREAM3D_REGISTER_TEST(TestPagedListing())
+
+    DREAM3D_REGISTER_TEST(TestCrossOriginPages())
+
+    DREAM3D_REGISTER_TEST(TestDownload())
+    DREAM3D_REGISTER_TEST(TestDownloadResume())
+
+    DREAM3D_REGISTER_TEST(TestUploadWithMetaData())
+
+    DREAM3D_REGISTER_TEST(TestUploadRetries())
+
+    DREAM3D_REGISTER_TEST(TestTransientErrors())
+
+    DREAM3D_REGISTER_TEST(TestCanceledProbe())
+
+    DREAM3D_REGISTER_TEST(TestWarmUp())
+
+    DREAM3D_REGISTER_TEST(TestHttp2Fallback())
+
+    DREAM3D_REGISTER_TEST(TestReleasedConnection())
+
+    DREAM3D_REGISTER_TEST(TestMetrics())
+
+    DREAM3D_REGISTER_TEST(TestTrace())
+  }
+
+private:
+};
@@ -49,6 +49,10 @@
 
 #include "UnitTestSupport.hpp"
 
+#include "HyperThoughtUtilities/HyperThoughtConnection/HTConnection.h"
+#include "HyperThoughtUtilities/HyperThoughtUtilitiesFilters/OpenHyperThoughtConnection.h"
+
+#include "HTMockServer.hpp"
 #include "HyperThoughtUtilitiesTestFileLocations.h"
 
 class OpenHyperThoughtConnectionTest
@@ -96,27 +100,25 @@ public:
   // -----------------------------------------------------------------------------
   int TestOpenHyperThoughtConnectionTest()
   {
-    //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    /* Please write OpenHyperThoughtConnectionTest test code here.
-     *
-     * Your IO test files are:
-     * UnitTest::OpenHyperThoughtConnectionTest::TestFile1
-     * UnitTest::OpenHyperThoughtConnectionTest::TestFile2
-     *
-     * SIMPLib provides some macros that will throw exceptions when a test fails
-     * and thus report that during testing. These macros are located in the
-     * SIMPLib/Utilities/UnitTestSupport.hpp file. Some examples are:
-     *
-     * SIMPLib_REQUIRE_EQUAL(foo, 0)
-     * This means that if the variable foo is NOT equal to Zero then test will fail
-     * and the current test will exit immediately. If there are more tests registered
-     * with the SIMPLib_REGISTER_TEST() macro, the next test will execute. There are
-     * lots of examples in the SIMPLib/Test folder to look at.
-     */
-    //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-
-    int foo = -1;
-    DREAM3D_REQUIRE_EQUAL(foo, 0)
+    HTMockServer server;
+    DREAM3D_REQUIRE(server.start())
+
+    OpenHyperThoughtConnection::Pointer filter = OpenHyperThoughtConnection::New();
+    filter->setApiAccess(server.createApiAccess());
+    filter->preflight();
+    DREAM3D_REQUIRE(filter->getErrorCode() >= 0)
+    DREAM3D_REQUIRE(nullptr != filter->getHTConnection())
+    DREAM3D_REQUIRE(filter->getHTConnection()->isValid())
+    DREAM3D_REQUIRE_EQUAL(filter->getHTConnection()->getBaseUrl(), server.getBaseUrl())
+
+    // Preflighting again keeps the live connection
+    HTConnection* connection = filter->getHTConnection();
+    filter->preflight();
+    DREAM3D_REQUIRE(connection == filter->getHTConnection())
+
+    filter->setApiAccess("invalid");
+    filter->preflight();
+    DREAM3D_REQUIRE_EQUAL(filter->getErrorCode(), -666)
 
     return EXIT_SUCCESS;
   }